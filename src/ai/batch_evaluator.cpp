@@ -0,0 +1,85 @@
+#include "batch_evaluator.h"
+#include <algorithm>
+
+BatchEvaluator::BatchEvaluator(std::shared_ptr<PolicyValueNet> n, size_t batchSize, std::chrono::microseconds t)
+  : net(std::move(n)), maxBatch(std::max<size_t>(1, batchSize)), timeout(t), head(&stub), tail(&stub) {
+  worker = std::thread([this]{ loop(); });
+}
+
+BatchEvaluator::~BatchEvaluator(){
+  quit.store(true);
+  { std::lock_guard<std::mutex> lk(idleMutex); }
+  wake.notify_one();
+  worker.join();
+}
+
+void BatchEvaluator::push(Request* r){
+  r->next.store(nullptr, std::memory_order_relaxed);
+  Request* prev = head.exchange(r, std::memory_order_acq_rel);
+  prev->next.store(r, std::memory_order_release);
+}
+
+BatchEvaluator::Request* BatchEvaluator::pop(){
+  Request* t = tail;
+  Request* next = t->next.load(std::memory_order_acquire);
+  if(t == &stub){
+    if(!next) return nullptr;
+    tail = next; t = next;
+    next = next->next.load(std::memory_order_acquire);
+  }
+  if(next){ tail = next; return t; }
+  // `t` is the last request: a producer may be between its exchange and its link
+  if(t != head.load(std::memory_order_acquire)) return nullptr;
+  push(&stub);
+  next = t->next.load(std::memory_order_acquire);
+  if(next){ tail = next; return t; }
+  return nullptr;
+}
+
+PolicyValueNet::Evaluation BatchEvaluator::evaluate(const Board& b, const std::vector<Board::Move>& legal){
+  Request r;
+  r.board = &b;
+  r.legal = &legal;
+  push(&r);
+  if(idle.load(std::memory_order_acquire)){ std::lock_guard<std::mutex> lk(idleMutex); wake.notify_one(); }
+  while(!r.done.load(std::memory_order_acquire)) std::this_thread::yield();
+  return std::move(r.result);
+}
+
+void BatchEvaluator::loop(){
+  using Clock = std::chrono::steady_clock;
+  std::vector<Request*> batch;
+  std::vector<const Board*> positions;
+  std::vector<const std::vector<Board::Move>*> legal;
+  std::vector<PolicyValueNet::Evaluation> out;
+  batch.reserve(maxBatch);
+  while(true){
+    Request* r = pop();
+    if(!r){
+      if(quit.load()) return;
+      // park; a producer that sees `idle` wakes us, the timeout covers a missed wake-up
+      std::unique_lock<std::mutex> lk(idleMutex);
+      idle.store(true, std::memory_order_release);
+      wake.wait_for(lk, std::chrono::milliseconds(1));
+      idle.store(false, std::memory_order_relaxed);
+      continue;
+    }
+    batch.clear();
+    batch.push_back(r);
+    auto deadline = Clock::now() + timeout;
+    while(batch.size() < maxBatch){
+      if((r = pop())){ batch.push_back(r); continue; }
+      if(Clock::now() >= deadline) break;
+      std::this_thread::yield();
+    }
+    positions.clear(); legal.clear();
+    for(Request* q : batch){ positions.push_back(q->board); legal.push_back(q->legal); }
+    net->evaluateBatch(positions, legal, out);
+    numBatches.fetch_add(1, std::memory_order_relaxed);
+    numPositions.fetch_add(batch.size(), std::memory_order_relaxed);
+    for(size_t i=0;i<batch.size();++i){
+      batch[i]->result = std::move(out[i]);
+      batch[i]->done.store(true, std::memory_order_release);
+    }
+  }
+}
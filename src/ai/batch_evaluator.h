@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "pvn.h"
+
+// Collects leaf evaluations from every search thread and runs them through the network
+// in batches. Callers push a request onto a lock-free MPSC queue and wait for its
+// result; one evaluator thread drains the queue into batches of up to `batchSize`,
+// waiting at most `timeout` after the first request for the batch to fill, and posts
+// each result back to its waiting caller. Virtual loss is what keeps the waiting search
+// threads on distinct leaves, so a batch needs about `batchSize` search threads.
+class BatchEvaluator {
+public:
+  BatchEvaluator(std::shared_ptr<PolicyValueNet> net, size_t batchSize = 16,
+                 std::chrono::microseconds timeout = std::chrono::microseconds(1000));
+  ~BatchEvaluator();
+  BatchEvaluator(const BatchEvaluator&) = delete;
+  BatchEvaluator& operator=(const BatchEvaluator&) = delete;
+
+  // Blocks until the batch holding this position has been evaluated.
+  PolicyValueNet::Evaluation evaluate(const Board& b, const std::vector<Board::Move>& legal);
+
+  size_t batchSize() const { return maxBatch; }
+  uint64_t batches() const { return numBatches.load(); }
+  uint64_t positions() const { return numPositions.load(); }
+  double averageBatch() const { uint64_t n = batches(); return n ? double(positions()) / n : 0.0; }
+
+private:
+  // Lives on the caller's stack until `done` is set.
+  struct Request {
+    const Board* board = nullptr;
+    const std::vector<Board::Move>* legal = nullptr;
+    PolicyValueNet::Evaluation result;
+    std::atomic<Request*> next{nullptr};
+    std::atomic<bool> done{false};
+  };
+
+  // Intrusive MPSC queue (Vyukov): producers exchange `head`, the evaluator pops at `tail`.
+  void push(Request* r);
+  Request* pop();
+  void loop();
+
+  std::shared_ptr<PolicyValueNet> net;
+  size_t maxBatch;
+  std::chrono::microseconds timeout;
+  alignas(64) std::atomic<Request*> head;
+  alignas(64) Request* tail;
+  Request stub;
+  std::atomic<bool> quit{false};
+  std::atomic<bool> idle{false};
+  std::mutex idleMutex;
+  std::condition_variable wake;
+  std::atomic<uint64_t> numBatches{0}, numPositions{0};
+  std::thread worker;
+};
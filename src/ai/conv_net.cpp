@@ -0,0 +1,432 @@
+#include "conv_net.h"
+#include "feature_encoder.h"
+#include "gemm.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <random>
+
+namespace {
+
+const char kMagic[4] = {'G','O','C','N'};
+// version 2 appends the calibrated convolution input ranges
+const uint32_t kVersion = 1;
+const uint32_t kCalibratedVersion = 2;
+// points per forward slice (about 2.4 MB of unfolded 32-channel input)
+const int kChunkPoints = 2048;
+
+struct NetHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t inputPlanes;
+  uint32_t channels;
+  uint32_t blocks;
+  uint32_t valueHidden;
+};
+
+// Floats following a header, for checking them against the file before allocating.
+uint64_t payloadFloats(const NetHeader& h){
+  uint64_t C = h.channels, H = h.valueHidden, B = h.blocks;
+  uint64_t n = C * h.inputPlanes * 9 + C;  // input conv
+  n += 2 * B * (C * C * 9 + C);            // residual convs
+  n += (C + 1) + (C + 1);                  // policy, pass
+  n += H * C + H + H + 1;                  // value head
+  if(h.version == kCalibratedVersion) n += 1 + 2 * B;
+  return n;
+}
+
+// Per-thread activations, reused across forward passes.
+struct Scratch {
+  std::vector<float> planes, act, tmp, sum, cols, row;
+  std::vector<uint8_t> xq, colsQ;
+  std::vector<int32_t> acc;
+};
+
+Scratch& scratch(){
+  thread_local Scratch s;
+  return s;
+}
+
+// Unfold 3x3 neighbourhoods of x [channels][P] into cols [channels*9][P], where
+// P = batch * N * N and points outside the board read as zero.
+void im2col(const float* x, int channels, int batch, int N, float* cols){
+  int NN = N * N;
+  size_t P = static_cast<size_t>(batch) * NN;
+  for(int c=0;c<channels;++c){
+    for(int ky=0;ky<3;++ky) for(int kx=0;kx<3;++kx){
+      float* out = cols + (static_cast<size_t>(c) * 9 + ky * 3 + kx) * P;
+      for(int b=0;b<batch;++b){
+        const float* src = x + c * P + static_cast<size_t>(b) * NN;
+        float* dst = out + static_cast<size_t>(b) * NN;
+        for(int y=0;y<N;++y){
+          int sy = y + ky - 1;
+          if(sy < 0 || sy >= N){ std::memset(dst + y * N, 0, sizeof(float) * N); continue; }
+          for(int x0=0;x0<N;++x0){
+            int sx = x0 + kx - 1;
+            dst[y * N + x0] = sx >= 0 && sx < N ? src[sy * N + sx] : 0.0f;
+          }
+        }
+      }
+    }
+  }
+}
+
+// Like im2col, from 7-bit quantized inputs xq [channels][P], into the transposed layout
+// the int8 product wants: cols [P][kPad], zero padded past channels * 9.
+void im2colQ(const uint8_t* xq, int channels, int batch, int N, int kPad, uint8_t* cols){
+  int NN = N * N, K = channels * 9;
+  size_t P = static_cast<size_t>(batch) * NN;
+  for(int b=0;b<batch;++b){
+    for(int y=0;y<N;++y) for(int x0=0;x0<N;++x0){
+      uint8_t* row = cols + (static_cast<size_t>(b) * NN + y * N + x0) * kPad;
+      for(int ky=0;ky<3;++ky){
+        int sy = y + ky - 1;
+        for(int kx=0;kx<3;++kx){
+          int sx = x0 + kx - 1;
+          bool inside = sy >= 0 && sy < N && sx >= 0 && sx < N;
+          const uint8_t* src = xq + static_cast<size_t>(b) * NN + sy * N + sx;
+          uint8_t* dst = row + ky * 3 + kx;
+          for(int c=0;c<channels;++c) dst[c * 9] = inside ? src[c * P] : 0;
+        }
+      }
+      std::memset(row + K, 0, kPad - K);
+    }
+  }
+}
+
+void addBias(const std::vector<float>& bias, size_t P, float* y, bool relu){
+  for(size_t c=0;c<bias.size();++c){
+    float* row = y + c * P;
+    float b = bias[c];
+    if(relu) for(size_t i=0;i<P;++i) row[i] = std::max(0.0f, row[i] + b);
+    else for(size_t i=0;i<P;++i) row[i] += b;
+  }
+}
+
+inline float sigmoid(float x){ return 1.0f / (1.0f + std::exp(-x)); }
+
+} // namespace
+
+ConvPolicyValueNet::ConvPolicyValueNet() { allocate(); }
+ConvPolicyValueNet::ConvPolicyValueNet(const Shape& s) : dims(s) { allocate(); }
+
+void ConvPolicyValueNet::allocate(){
+  size_t C = dims.channels, H = dims.valueHidden;
+  inputMax.clear();
+  mode = Precision::Float32;
+  input.w.assign(C * dims.inputPlanes * 9, 0.0f);
+  input.b.assign(C, 0.0f);
+  convs.assign(2 * dims.blocks, Conv());
+  for(Conv& c : convs){ c.w.assign(C * C * 9, 0.0f); c.b.assign(C, 0.0f); }
+  policyW.assign(C, 0.0f);
+  passW.assign(C, 0.0f);
+  value1W.assign(H * C, 0.0f);
+  value1B.assign(H, 0.0f);
+  value2W.assign(H, 0.0f);
+  policyB = passB = value2B = 0.0f;
+}
+
+std::vector<std::pair<float*, size_t>> ConvPolicyValueNet::tensors(){
+  std::vector<std::pair<float*, size_t>> t;
+  t.emplace_back(input.w.data(), input.w.size());
+  t.emplace_back(input.b.data(), input.b.size());
+  for(Conv& c : convs){ t.emplace_back(c.w.data(), c.w.size()); t.emplace_back(c.b.data(), c.b.size()); }
+  t.emplace_back(policyW.data(), policyW.size());
+  t.emplace_back(&policyB, 1);
+  t.emplace_back(passW.data(), passW.size());
+  t.emplace_back(&passB, 1);
+  t.emplace_back(value1W.data(), value1W.size());
+  t.emplace_back(value1B.data(), value1B.size());
+  t.emplace_back(value2W.data(), value2W.size());
+  t.emplace_back(&value2B, 1);
+  return t;
+}
+
+bool ConvPolicyValueNet::load(const std::string& path){
+  std::ifstream in(path, std::ios::binary);
+  NetHeader h;
+  if(!in.read(reinterpret_cast<char*>(&h), sizeof(h))) return false;
+  if(std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0) return false;
+  if(h.version != kVersion && h.version != kCalibratedVersion) return false;
+  if(h.inputPlanes != static_cast<uint32_t>(kInputPlanes) && h.inputPlanes != static_cast<uint32_t>(FeatureEncoder::kPlanes)) return false;
+  if(h.channels < 1 || h.channels > 1024 || h.blocks > 256 || h.valueHidden < 1 || h.valueHidden > 4096) return false;
+  // a damaged header must not size the allocation beyond what the file holds
+  std::streamoff start = in.tellg();
+  in.seekg(0, std::ios::end);
+  std::streamoff avail = in.tellg() - start;
+  in.seekg(start);
+  if(!in || static_cast<uint64_t>(avail) < payloadFloats(h) * sizeof(float)) return false;
+  Shape s;
+  s.channels = static_cast<int>(h.channels);
+  s.blocks = static_cast<int>(h.blocks);
+  s.valueHidden = static_cast<int>(h.valueHidden);
+  s.inputPlanes = static_cast<int>(h.inputPlanes);
+  ConvPolicyValueNet loaded(s);
+  for(auto& t : loaded.tensors()){
+    if(!in.read(reinterpret_cast<char*>(t.first), static_cast<std::streamsize>(t.second * sizeof(float)))) return false;
+  }
+  if(h.version == kCalibratedVersion){
+    loaded.inputMax.resize(1 + 2 * s.blocks);
+    if(!in.read(reinterpret_cast<char*>(loaded.inputMax.data()), static_cast<std::streamsize>(loaded.inputMax.size() * sizeof(float)))) return false;
+    loaded.quantize();
+  }
+  *this = std::move(loaded);
+  return true;
+}
+
+bool ConvPolicyValueNet::save(const std::string& path) const {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if(!out) return false;
+  NetHeader h;
+  std::memcpy(h.magic, kMagic, sizeof(kMagic));
+  h.version = calibrated() ? kCalibratedVersion : kVersion;
+  h.inputPlanes = static_cast<uint32_t>(dims.inputPlanes);
+  h.channels = static_cast<uint32_t>(dims.channels);
+  h.blocks = static_cast<uint32_t>(dims.blocks);
+  h.valueHidden = static_cast<uint32_t>(dims.valueHidden);
+  out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+  for(auto& t : const_cast<ConvPolicyValueNet*>(this)->tensors())
+    out.write(reinterpret_cast<const char*>(t.first), static_cast<std::streamsize>(t.second * sizeof(float)));
+  if(calibrated()) out.write(reinterpret_cast<const char*>(inputMax.data()), static_cast<std::streamsize>(inputMax.size() * sizeof(float)));
+  return static_cast<bool>(out);
+}
+
+void ConvPolicyValueNet::randomize(uint64_t seed){
+  std::mt19937_64 rng(seed);
+  auto fill = [&rng](std::vector<float>& w, size_t fanIn){
+    std::normal_distribution<float> d(0.0f, std::sqrt(2.0f / static_cast<float>(fanIn)));
+    for(float& v : w) v = d(rng);
+  };
+  allocate();
+  size_t C = dims.channels;
+  fill(input.w, dims.inputPlanes * 9);
+  for(Conv& c : convs) fill(c.w, C * 9);
+  // keep the residual stream from growing with depth
+  for(size_t i=1;i<convs.size();i+=2) for(float& v : convs[i].w) v *= 0.1f;
+  fill(policyW, C);
+  fill(passW, C);
+  fill(value1W, C);
+  fill(value2W, dims.valueHidden);
+}
+
+void ConvPolicyValueNet::quantize(){
+  for(int l=0;l<1+2*dims.blocks;++l){
+    Conv& c = l == 0 ? input : convs[l - 1];
+    int cout = static_cast<int>(c.b.size());
+    int K = static_cast<int>(c.w.size()) / cout;
+    c.kPad = (K + 31) & ~31;
+    c.q.assign(static_cast<size_t>(cout) * c.kPad, 0);
+    c.scale.assign(cout, 1.0f);
+    for(int m=0;m<cout;++m){
+      const float* w = &c.w[static_cast<size_t>(m) * K];
+      float big = 0.0f;
+      for(int k=0;k<K;++k) big = std::max(big, std::fabs(w[k]));
+      if(big == 0.0f) continue;
+      c.scale[m] = big / 127.0f;
+      for(int k=0;k<K;++k) c.q[static_cast<size_t>(m) * c.kPad + k] = static_cast<int8_t>(std::lrint(w[k] / c.scale[m]));
+    }
+  }
+}
+
+void ConvPolicyValueNet::calibrate(const std::vector<const Board*>& positions){
+  if(positions.empty()) return;
+  std::vector<float> maxima = calibrated() ? inputMax : std::vector<float>(1 + 2 * dims.blocks, 0.0f);
+  std::vector<Stone> toMove;
+  for(const Board* b : positions) toMove.push_back(b->toMove());
+  int NN = positions[0]->size() * positions[0]->size();
+  int chunk = std::max(1, kChunkPoints / NN);
+  std::vector<float> logits(static_cast<size_t>(chunk) * (NN + 1)), values(chunk);
+  for(size_t i=0;i<positions.size();i+=chunk){
+    int n = static_cast<int>(std::min<size_t>(chunk, positions.size() - i));
+    forwardChunk(&positions[i], &toMove[i], n, logits.data(), values.data(), &maxima);
+  }
+  inputMax = maxima;
+  quantize();
+}
+
+bool ConvPolicyValueNet::setPrecision(Precision p){
+  if(p == Precision::Int8 && !calibrated()) return false;
+  mode = p;
+  return true;
+}
+
+void ConvPolicyValueNet::conv(int l, const float* x, int cin, int batch, int N, float* y, bool accumulate,
+                              std::vector<float>* maxima) const {
+  const Conv& c = layer(l);
+  int cout = static_cast<int>(c.b.size());
+  size_t P = static_cast<size_t>(batch) * N * N, n = static_cast<size_t>(cin) * P;
+  Scratch& s = scratch();
+  if(maxima){
+    float big = (*maxima)[l];
+    for(size_t i=0;i<n;++i) big = std::max(big, x[i]);
+    (*maxima)[l] = big;
+  }
+  if(mode == Precision::Int8 && !maxima){
+    // inputs are non-negative (ReLU outputs and 0/1 planes): 7 bits over [0, max]
+    float step = inputMax[l] > 0.0f ? inputMax[l] / 127.0f : 1.0f, inv = 1.0f / step;
+    s.xq.resize(n);
+    for(size_t i=0;i<n;++i) s.xq[i] = static_cast<uint8_t>(std::min(127.0f, x[i] * inv + 0.5f));
+    s.colsQ.resize(P * c.kPad);
+    im2colQ(s.xq.data(), cin, batch, N, c.kPad, s.colsQ.data());
+    s.acc.resize(static_cast<size_t>(cout) * P);
+    igemmU8S8(cout, static_cast<int>(P), c.kPad, c.q.data(), s.colsQ.data(), s.acc.data());
+    for(int m=0;m<cout;++m){
+      float f = c.scale[m] * step;
+      const int32_t* a = &s.acc[m * P];
+      float* out = y + m * P;
+      if(accumulate) for(size_t i=0;i<P;++i) out[i] += a[i] * f;
+      else for(size_t i=0;i<P;++i) out[i] = a[i] * f;
+    }
+    return;
+  }
+  s.cols.resize(static_cast<size_t>(cin) * 9 * P);
+  im2col(x, cin, batch, N, s.cols.data());
+  sgemm(cout, static_cast<int>(P), cin * 9, c.w.data(), s.cols.data(), y, accumulate);
+}
+
+void ConvPolicyValueNet::encode(const Board& b, Stone toMove, float* planes) const {
+  int NN = b.size() * b.size();
+  if(dims.inputPlanes == FeatureEncoder::kPlanes){
+    FeatureEncoder fe;
+    if(fe.reset(b)) fe.write(toMove, planes);
+    else std::fill(planes, planes + FeatureEncoder::kPlanes * NN, 0.0f);
+    return;
+  }
+  Stone them = toMove == BLACK ? WHITE : BLACK;
+  const std::vector<Stone>& cells = b.cells();
+  for(int i=0;i<NN;++i){
+    planes[i] = cells[i] == toMove ? 1.0f : 0.0f;
+    planes[NN + i] = cells[i] == them ? 1.0f : 0.0f;
+    planes[2 * NN + i] = 0.0f;
+    planes[3 * NN + i] = 1.0f;
+  }
+  if(b.koPoint() >= 0) planes[2 * NN + b.koPoint()] = 1.0f;
+}
+
+void ConvPolicyValueNet::forward(const std::vector<const Board*>& positions, const std::vector<Stone>& toMove,
+                                 std::vector<float>& logits, std::vector<float>& values) const {
+  logits.clear(); values.clear();
+  if(positions.empty()) return;
+  int NN = positions[0]->size() * positions[0]->size();
+  logits.resize(positions.size() * (NN + 1));
+  values.resize(positions.size());
+  // large batches run in slices so the unfolded inputs stay in cache
+  int chunk = std::max(1, kChunkPoints / NN);
+  for(size_t i=0;i<positions.size();i+=chunk){
+    int n = static_cast<int>(std::min<size_t>(chunk, positions.size() - i));
+    forwardChunk(&positions[i], &toMove[i], n, &logits[i * (NN + 1)], &values[i]);
+  }
+}
+
+void ConvPolicyValueNet::forwardChunk(const Board* const* positions, const Stone* toMove, int batch,
+                                      float* logits, float* values, std::vector<float>* maxima) const {
+  int N = positions[0]->size(), NN = N * N;
+  size_t P = static_cast<size_t>(batch) * NN;
+  int C = dims.channels, H = dims.valueHidden;
+  Scratch& s = scratch();
+  int F = dims.inputPlanes;
+  s.planes.resize(F * P);
+  s.act.resize(C * P); s.tmp.resize(C * P); s.sum.resize(C * P);
+
+  // gather each position's planes into the batch's [plane][P] layout
+  s.row.resize(F * NN);
+  for(int b=0;b<batch;++b){
+    encode(*positions[b], toMove[b], s.row.data());
+    for(int f=0;f<F;++f) std::memcpy(&s.planes[f * P + static_cast<size_t>(b) * NN], &s.row[f * NN], sizeof(float) * NN);
+  }
+
+  conv(0, s.planes.data(), F, batch, N, s.act.data(), false, maxima);
+  addBias(input.b, P, s.act.data(), true);
+  for(int k=0;k<dims.blocks;++k){
+    const Conv& c1 = convs[2 * k];
+    const Conv& c2 = convs[2 * k + 1];
+    conv(1 + 2 * k, s.act.data(), C, batch, N, s.tmp.data(), false, maxima);
+    addBias(c1.b, P, s.tmp.data(), true);
+    // start from the skip connection and accumulate the second convolution onto it
+    std::memcpy(s.sum.data(), s.act.data(), sizeof(float) * C * P);
+    conv(2 + 2 * k, s.tmp.data(), C, batch, N, s.sum.data(), true, maxima);
+    addBias(c2.b, P, s.sum.data(), true);
+    std::swap(s.act, s.sum);
+  }
+
+  // policy: 1x1 convolution down to one plane
+  s.row.resize(P);
+  sgemm(1, static_cast<int>(P), C, policyW.data(), s.act.data(), s.row.data());
+  std::vector<float> pooled(C);
+  for(int b=0;b<batch;++b){
+    float* l = logits + static_cast<size_t>(b) * (NN + 1);
+    for(int i=0;i<NN;++i) l[i] = s.row[static_cast<size_t>(b) * NN + i] + policyB;
+    for(int c=0;c<C;++c){
+      const float* a = &s.act[c * P + static_cast<size_t>(b) * NN];
+      float t = 0.0f;
+      for(int i=0;i<NN;++i) t += a[i];
+      pooled[c] = t / NN;
+    }
+    float pass = passB;
+    for(int c=0;c<C;++c) pass += passW[c] * pooled[c];
+    l[NN] = pass;
+    float v = value2B;
+    for(int h=0;h<H;++h){
+      float t = value1B[h];
+      for(int c=0;c<C;++c) t += value1W[static_cast<size_t>(h) * C + c] * pooled[c];
+      v += value2W[h] * std::max(0.0f, t);
+    }
+    values[b] = sigmoid(v);
+  }
+}
+
+void ConvPolicyValueNet::evaluateBatch(const std::vector<const Board*>& positions,
+                                       const std::vector<const std::vector<Board::Move>*>& legal,
+                                       std::vector<Evaluation>& out){
+  out.resize(positions.size());
+  // group by board size; a search only ever has one
+  std::map<int, std::vector<size_t>> bySize;
+  for(size_t i=0;i<positions.size();++i) bySize[positions[i]->size()].push_back(i);
+  std::vector<const Board*> group;
+  std::vector<Stone> toMove;
+  std::vector<float> logits, values;
+  for(auto& kv : bySize){
+    int N = kv.first, NN = N * N;
+    group.clear(); toMove.clear();
+    for(size_t i : kv.second){
+      group.push_back(positions[i]);
+      toMove.push_back(legal[i]->empty() ? positions[i]->toMove() : legal[i]->front().s);
+    }
+    forward(group, toMove, logits, values);
+    for(size_t j=0;j<kv.second.size();++j){
+      Evaluation& e = out[kv.second[j]];
+      const std::vector<Board::Move>& moves = *legal[kv.second[j]];
+      const float* l = &logits[j * (NN + 1)];
+      // softmax over the legal moves only
+      e.policy.resize(moves.size());
+      float best = -INFINITY;
+      for(auto& m : moves) best = std::max(best, l[m.pass ? NN : m.y * N + m.x]);
+      double tot = 0.0;
+      for(size_t k=0;k<moves.size();++k){ e.policy[k] = std::exp(l[moves[k].pass ? NN : moves[k].y * N + moves[k].x] - best); tot += e.policy[k]; }
+      for(double& p : e.policy) p /= tot;
+      e.value = toMove[j] == BLACK ? values[j] : 1.0 - values[j];
+    }
+  }
+}
+
+std::vector<double> ConvPolicyValueNet::policy(const Board& b, const std::vector<Board::Move>& legal){
+  std::vector<Evaluation> out;
+  evaluateBatch({&b}, {&legal}, out);
+  return std::move(out[0].policy);
+}
+
+double ConvPolicyValueNet::value(const Board& b){
+  std::vector<Board::Move> none;
+  std::vector<Evaluation> out;
+  evaluateBatch({&b}, {&none}, out);
+  return out[0].value;
+}
+
+std::shared_ptr<PolicyValueNet> loadConvPV(const std::string& path){
+  auto net = std::make_shared<ConvPolicyValueNet>();
+  if(!net->load(path)) return nullptr;
+  return net;
+}
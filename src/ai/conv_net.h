@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "pvn.h"
+
+// Residual convolutional policy/value network evaluated on the CPU: 3x3 convolutions
+// as im2col + sgemm, so batches of positions become wider matrix products.
+//
+//   input  3x3 conv (F input planes -> C) + ReLU
+//   blocks x [3x3 conv + ReLU, 3x3 conv, + skip, ReLU]
+//   policy 1x1 conv (C -> 1) per point; pass logit from the board-averaged features
+//   value  board-averaged features -> FC (C -> H) + ReLU -> FC (H -> 1) -> sigmoid
+//
+// The network is fully convolutional apart from the averaged heads, so one weight file
+// serves every board size. Batch normalisation is expected to be folded into the
+// convolution weights and biases before export.
+//
+// Input planes, from the point of view of the side to move, either the basic
+// F = kInputPlanes: 0 own stones, 1 opponent stones, 2 the ko point, 3 all ones (marks
+// the board inside the zero padding); or F = FeatureEncoder::kPlanes, which adds the
+// encoder's liberty-class planes (boards up to 19x19, encoded afresh for each position).
+// The value output is the side to move's winning probability; value() converts it to
+// BLACK's perspective like every PolicyValueNet.
+//
+// Weight file, little-endian:
+//   char magic[4] = "GOCN"; uint32 version = 1 or 2;
+//   uint32 inputPlanes (F), channels, blocks, valueHidden;
+//   float32 tensors in order, convolutions as [out][in][ky][kx]:
+//     input.w [C][F][3][3], input.b [C]
+//     per block: conv1.w [C][C][3][3], conv1.b [C], conv2.w [C][C][3][3], conv2.b [C]
+//     policy.w [C], policy.b [1], pass.w [C], pass.b [1]
+//     value1.w [H][C], value1.b [H], value2.w [H], value2.b [1]
+//   version 2 only: float32 inputMax [1 + 2 * blocks], the calibrated largest input of
+//     each convolution in the order above
+//
+// Int8 path: convolution weights are quantized symmetrically per output channel and
+// each convolution's (non-negative) input to 7 bits against its calibrated maximum,
+// which keeps the AVX2 u8 x s8 pair sums from saturating. Products accumulate in int32;
+// biases, the residual stream and the heads stay float. Against float32 on calibrated
+// positions, move probabilities and the value stay within 0.01 (absolute).
+class ConvPolicyValueNet : public PolicyValueNet {
+public:
+  static constexpr int kInputPlanes = 4;
+  struct Shape { int channels = 32; int blocks = 4; int valueHidden = 32; int inputPlanes = kInputPlanes; };
+  enum class Precision { Float32, Int8 };
+
+  // Weights are all zero until load() or randomize().
+  ConvPolicyValueNet();
+  explicit ConvPolicyValueNet(const Shape& s);
+
+  bool load(const std::string& path);
+  bool save(const std::string& path) const;
+  // He-initialised random weights, for tests and benchmarks.
+  void randomize(uint64_t seed);
+  const Shape& shape() const { return dims; }
+
+  // Widen the recorded input range of every convolution with a float32 pass over
+  // `positions` (of one board size, each with its side to move). Enables Int8.
+  void calibrate(const std::vector<const Board*>& positions);
+  bool calibrated() const { return !inputMax.empty(); }
+  // Int8 needs calibration (from calibrate() or a version 2 file); returns false without.
+  bool setPrecision(Precision p);
+  Precision precision() const { return mode; }
+
+  std::vector<double> policy(const Board& b, const std::vector<Board::Move>& legal) override;
+  double value(const Board& b) override;
+  // One forward pass per board size present in the batch.
+  void evaluateBatch(const std::vector<const Board*>& positions,
+                     const std::vector<const std::vector<Board::Move>*>& legal,
+                     std::vector<Evaluation>& out) override;
+
+  // Raw outputs for positions of one board size N, toMove[i] to play in positions[i]:
+  // N*N+1 policy logits per position (row-major points, pass last) and the side to
+  // move's value.
+  void forward(const std::vector<const Board*>& positions, const std::vector<Stone>& toMove,
+               std::vector<float>& logits, std::vector<float>& values) const;
+
+  // Input planes for `b` with `toMove` to play, as [shape().inputPlanes][N*N].
+  void encode(const Board& b, Stone toMove, float* planes) const;
+
+private:
+  struct Conv {
+    std::vector<float> w, b;
+    // int8 copy: [out][kPad] with kPad a multiple of 32, and per output channel scales
+    std::vector<int8_t> q;
+    std::vector<float> scale;
+    int kPad = 0;
+  };
+  Shape dims;
+  Precision mode = Precision::Float32;
+  Conv input;
+  std::vector<Conv> convs; // two per block
+  std::vector<float> policyW, passW, value1W, value1B, value2W;
+  float policyB = 0.0f, passB = 0.0f, value2B = 0.0f;
+  std::vector<float> inputMax; // per convolution; empty until calibrated
+
+  void allocate();
+  const Conv& layer(int l) const { return l == 0 ? input : convs[l - 1]; }
+  void quantize();
+  // y (+)= convolution `l` of x [cin][P], without bias. Records the largest input in
+  // (*maxima)[l] when given.
+  void conv(int l, const float* x, int cin, int batch, int N, float* y, bool accumulate, std::vector<float>* maxima) const;
+  void forwardChunk(const Board* const* positions, const Stone* toMove, int batch, float* logits, float* values,
+                    std::vector<float>* maxima = nullptr) const;
+  // every tensor in file order, for load/save/randomize
+  std::vector<std::pair<float*, size_t>> tensors();
+};
+
+// Loads a ConvPolicyValueNet weight file, or returns nullptr when it cannot be read.
+std::shared_ptr<PolicyValueNet> loadConvPV(const std::string& path);
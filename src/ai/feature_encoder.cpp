@@ -0,0 +1,197 @@
+#include "feature_encoder.h"
+#include "bitops.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+template <int W>
+void shiftUp(const uint64_t* in, int k, uint64_t* out){
+  int words = k >> 6, bits = k & 63;
+  for(int i=W-1;i>=0;--i){
+    uint64_t v = i - words >= 0 ? in[i - words] << bits : 0;
+    if(bits && i - words - 1 >= 0) v |= in[i - words - 1] >> (64 - bits);
+    out[i] = v;
+  }
+}
+
+template <int W>
+void shiftDown(const uint64_t* in, int k, uint64_t* out){
+  int words = k >> 6, bits = k & 63;
+  for(int i=0;i<W;++i){
+    uint64_t v = i + words < W ? in[i + words] >> bits : 0;
+    if(bits && i + words + 1 < W) v |= in[i + words + 1] << (64 - bits);
+    out[i] = v;
+  }
+}
+
+} // namespace
+
+int FeatureEncoder::Bits::count() const {
+  int n = 0;
+  for(uint64_t v : w) n += popCount(v);
+  return n;
+}
+
+int FeatureEncoder::Bits::lowest() const {
+  for(int i=0;i<kWords;++i) if(w[i]) return i * 64 + lowestBit(w[i]);
+  return -1;
+}
+
+int FeatureEncoder::transformPoint(int x, int y, int N, int sym){
+  if(sym & 1) x = N - 1 - x;
+  if(sym & 2) y = N - 1 - y;
+  if(sym & 4) std::swap(x, y);
+  return y * N + x;
+}
+
+FeatureEncoder::Bits FeatureEncoder::dilate(const Bits& b) const {
+  Bits r = b, t;
+  shiftUp<kWords>(b.w, N, t.w);   r = r | t;
+  shiftDown<kWords>(b.w, N, t.w); r = r | t;
+  shiftUp<kWords>(b.w, 1, t.w);   r = r | (t & notFirstCol);
+  shiftDown<kWords>(b.w, 1, t.w); r = r | (t & notLastCol);
+  return r & onBoard;
+}
+
+FeatureEncoder::Bits FeatureEncoder::group(const Bits& own, int point) const {
+  Bits g;
+  g.set(point);
+  while(true){
+    Bits next = dilate(g) & own;
+    if(next == g) return g;
+    g = next;
+  }
+}
+
+void FeatureEncoder::relabel(const Bits& area){
+  Bits empty = onBoard & ~(stones[0] | stones[1]);
+  for(int c=0;c<2;++c){
+    Bits todo = area & stones[c];
+    while(todo.any()){
+      Bits g = group(stones[c], todo.lowest());
+      int n = (dilate(g) & empty).count();
+      Bits keep = ~g;
+      for(auto& l : libs[c]) l = l & keep;
+      Bits& cls = libs[c][std::max(0, std::min(n, 3) - 1)];
+      cls = cls | g;
+      todo = todo & keep;
+    }
+  }
+}
+
+bool FeatureEncoder::reset(const Board& b){
+  int n = b.size();
+  if(n < 1 || n > kMaxSize) return false;
+  N = n;
+  onBoard = notFirstCol = notLastCol = Bits();
+  for(int y=0;y<N;++y) for(int x=0;x<N;++x){
+    int i = y * N + x;
+    onBoard.set(i);
+    if(x != 0) notFirstCol.set(i);
+    if(x != N - 1) notLastCol.set(i);
+  }
+  stones[0] = stones[1] = Bits();
+  for(auto& c : libs) for(auto& l : c) l = Bits();
+  const std::vector<Stone>& cells = b.cells();
+  for(int i=0;i<N*N;++i){
+    if(cells[i] == BLACK) stones[0].set(i);
+    else if(cells[i] == WHITE) stones[1].set(i);
+  }
+  relabel(onBoard);
+  ko = b.koPoint();
+  perm.resize(8 * N * N);
+  for(int s=0;s<8;++s) for(int y=0;y<N;++y) for(int x=0;x<N;++x) perm[s * N * N + y * N + x] = static_cast<uint16_t>(transformPoint(x, y, N, s));
+  return true;
+}
+
+void FeatureEncoder::play(const Board& after, const Board::Move& m){
+  ko = after.koPoint();
+  if(m.pass) return;
+  int c = colour(m.s), p = m.y * N + m.x;
+  Bits touched;
+  touched.set(p);
+  stones[c].set(p);
+  // opponent neighbours that vanished were captured with their whole group
+  Bits captured;
+  for(int q : {p - N, p + N, m.x > 0 ? p - 1 : -1, m.x < N - 1 ? p + 1 : -1}){
+    if(q < 0 || q >= N * N || !stones[1 - c].test(q) || captured.test(q)) continue;
+    if(after.cells()[q] == EMPTY) captured = captured | group(stones[1 - c], q);
+  }
+  if(captured.any()){
+    Bits keep = ~captured;
+    stones[1 - c] = stones[1 - c] & keep;
+    for(auto& l : libs[1 - c]) l = l & keep;
+    touched = touched | captured;
+  }
+  // the move's group, the groups it took liberties from, and those next to captures
+  relabel(dilate(touched));
+}
+
+void FeatureEncoder::unpack(const Bits& b, float* out, const uint16_t* map) const {
+  int NN = N * N;
+  if(!map){
+    // word at a time: a straight copy the compiler vectorizes
+    for(int w=0;w*64<NN;++w){
+      uint64_t v = b.w[w];
+      int n = std::min(64, NN - w * 64);
+      float* o = out + w * 64;
+      for(int j=0;j<n;++j) o[j] = static_cast<float>((v >> j) & 1);
+    }
+    return;
+  }
+  for(int i=0;i<NN;++i) out[map[i]] = static_cast<float>((b.w[i >> 6] >> (i & 63)) & 1);
+}
+
+void FeatureEncoder::write(Stone toMove, float* out, int sym) const {
+  int NN = N * N;
+  int me = colour(toMove), them = 1 - me;
+  const uint16_t* map = sym ? &perm[sym * NN] : nullptr;
+  unpack(stones[me], out, map);
+  unpack(stones[them], out + NN, map);
+  float* p = out + 2 * NN;
+  for(int k=0;k<3;++k){
+    unpack(libs[me][k], p + k * NN, map);
+    unpack(libs[them][k], p + (3 + k) * NN, map);
+  }
+  p += 6 * NN;
+  std::memset(p, 0, sizeof(float) * NN);
+  if(ko >= 0) p[map ? map[ko] : ko] = 1.0f;
+  std::fill(p + NN, p + 2 * NN, 1.0f);
+}
+
+int FeatureEncoder::canonicalSymmetry() const {
+  int NN = N * N;
+  int best = 0;
+  Bits bestImage[2] = {stones[0], stones[1]};
+  for(int s=1;s<8;++s){
+    Bits image[2];
+    for(int c=0;c<2;++c){
+      Bits src = stones[c];
+      while(src.any()){
+        int i = src.lowest();
+        src.w[i >> 6] &= src.w[i >> 6] - 1;
+        image[c].set(perm[s * NN + i]);
+      }
+    }
+    bool smaller = false;
+    for(int c=0;c<2 && !smaller;++c){
+      int i = kWords - 1;
+      while(i > 0 && image[c].w[i] == bestImage[c].w[i]) --i;
+      if(image[c].w[i] != bestImage[c].w[i]){ smaller = image[c].w[i] < bestImage[c].w[i]; break; }
+    }
+    if(smaller){ best = s; bestImage[0] = image[0]; bestImage[1] = image[1]; }
+  }
+  return best;
+}
+
+bool FeatureEncoder::matches(const Board& b) const {
+  if(b.size() != N) return false;
+  const std::vector<Stone>& cells = b.cells();
+  for(int i=0;i<N*N;++i){
+    Stone s = stones[0].test(i) ? BLACK : stones[1].test(i) ? WHITE : EMPTY;
+    if(cells[i] != s) return false;
+  }
+  return true;
+}
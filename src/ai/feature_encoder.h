@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "board.h"
+
+// Network input planes of one position. Stones and liberty classes are held as bit-packed
+// boards; reset() builds them from a Board, play() updates them for one move by
+// re-examining only the groups next to it and its captures, and write() unpacks the
+// planes into a float tensor.
+//
+// Planes of write(), from the point of view of `toMove`:
+//   0        own stones
+//   1        opponent stones
+//   2 .. 4   own stones in groups with 1, 2, 3+ liberties
+//   5 .. 7   opponent stones in groups with 1, 2, 3+ liberties
+//   8        the ko point
+//   9        all ones
+class FeatureEncoder {
+public:
+  static constexpr int kPlanes = 10;
+  static constexpr int kMaxSize = 19;
+
+  // Load `b`. Fails for boards larger than kMaxSize.
+  bool reset(const Board& b);
+  // Advance by `m`, just played to reach `after`.
+  void play(const Board& after, const Board::Move& m);
+  // [kPlanes][N*N] floats under board symmetry `sym` (bit 0 mirrors x, bit 1 mirrors y,
+  // bit 2 transposes); 0 is the identity.
+  void write(Stone toMove, float* out, int sym = 0) const;
+  // The symmetry whose image of the current stones compares smallest, so positions that
+  // are symmetric images of each other write identical canonical planes.
+  int canonicalSymmetry() const;
+  // Index of point (x, y) under `sym`.
+  static int transformPoint(int x, int y, int N, int sym);
+
+  int size() const { return N; }
+  // Whether the current stones are exactly `b`'s, for checking incremental updates.
+  bool matches(const Board& b) const;
+
+private:
+  static constexpr int kWords = (kMaxSize * kMaxSize + 63) / 64;
+  struct Bits {
+    uint64_t w[kWords] = {};
+    bool test(int i) const { return (w[i >> 6] >> (i & 63)) & 1; }
+    void set(int i){ w[i >> 6] |= uint64_t(1) << (i & 63); }
+    bool any() const { for(uint64_t v : w) if(v) return true; return false; }
+    int count() const;
+    int lowest() const;
+    Bits operator|(const Bits& o) const { Bits r; for(int i=0;i<kWords;++i) r.w[i] = w[i] | o.w[i]; return r; }
+    Bits operator&(const Bits& o) const { Bits r; for(int i=0;i<kWords;++i) r.w[i] = w[i] & o.w[i]; return r; }
+    Bits operator~() const { Bits r; for(int i=0;i<kWords;++i) r.w[i] = ~w[i]; return r; }
+    bool operator==(const Bits& o) const { for(int i=0;i<kWords;++i) if(w[i] != o.w[i]) return false; return true; }
+  };
+
+  int N = 0;
+  Bits onBoard, notFirstCol, notLastCol;
+  Bits stones[2];    // BLACK, WHITE
+  Bits libs[2][3];   // per colour: groups with 1, 2, 3+ liberties
+  int ko = -1;
+  std::vector<uint16_t> perm; // [sym][point] -> transformed point
+
+  static int colour(Stone s){ return s == WHITE ? 1 : 0; }
+  Bits dilate(const Bits& b) const;
+  Bits group(const Bits& own, int point) const;
+  // Recompute the liberty class of every group with a stone in `area`.
+  void relabel(const Bits& area);
+  void unpack(const Bits& b, float* out, const uint16_t* map) const;
+};
@@ -0,0 +1,201 @@
+#include "gemm.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define GO_GEMM_AVX2 1
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define GO_IGEMM_AVX2 1
+#if defined(__AVXVNNI__)
+#define GO_IGEMM_VNNI 1
+#define GO_DPBUSD _mm256_dpbusd_avx_epi32
+#elif defined(__AVX512VNNI__) && defined(__AVX512VL__)
+#define GO_IGEMM_VNNI 1
+#define GO_DPBUSD _mm256_dpbusd_epi32
+#endif
+#endif
+
+namespace {
+
+// K is processed in slices so the active rows of B stay in cache.
+constexpr int kKBlock = 256;
+
+void clearIfNeeded(int M, int N, float* C, bool accumulate){
+  if(!accumulate) std::memset(C, 0, sizeof(float) * static_cast<size_t>(M) * N);
+}
+
+#ifdef GO_GEMM_AVX2
+// Columns per panel: a K-slice of B this wide stays in L2 while every row of A passes.
+constexpr int kNBlock = 256;
+
+// MR rows x 16 columns of C held in registers across one K slice. `ld` is the row
+// stride of B and C.
+template <int MR>
+inline void kernel16(int ld, int K, int k0, int k1, const float* A, const float* B, float* C){
+  __m256 c[MR][2];
+  for(int r=0;r<MR;++r){ c[r][0] = _mm256_loadu_ps(C + r * ld); c[r][1] = _mm256_loadu_ps(C + r * ld + 8); }
+  for(int k=k0;k<k1;++k){
+    __m256 b0 = _mm256_loadu_ps(B + static_cast<size_t>(k) * ld);
+    __m256 b1 = _mm256_loadu_ps(B + static_cast<size_t>(k) * ld + 8);
+    for(int r=0;r<MR;++r){
+      __m256 a = _mm256_broadcast_ss(A + r * K + k);
+      c[r][0] = _mm256_fmadd_ps(a, b0, c[r][0]);
+      c[r][1] = _mm256_fmadd_ps(a, b1, c[r][1]);
+    }
+  }
+  for(int r=0;r<MR;++r){ _mm256_storeu_ps(C + r * ld, c[r][0]); _mm256_storeu_ps(C + r * ld + 8, c[r][1]); }
+}
+
+// MR rows of C over columns [0, width) of a panel starting at B and C.
+template <int MR>
+void rowPanel(int ld, int width, int K, const float* A, const float* B, float* C){
+  int full = width & ~15;
+  for(int k0=0;k0<K;k0+=kKBlock){
+    int k1 = std::min(K, k0 + kKBlock);
+    for(int j=0;j<full;j+=16) kernel16<MR>(ld, K, k0, k1, A, B + j, C + j);
+    // ragged right edge
+    for(int r=0;r<MR;++r){
+      for(int k=k0;k<k1;++k){
+        float a = A[r * K + k];
+        const float* b = B + static_cast<size_t>(k) * ld;
+        for(int j=full;j<width;++j) C[r * ld + j] += a * b[j];
+      }
+    }
+  }
+}
+#endif
+
+#ifdef GO_IGEMM_AVX2
+// acc += per-lane int32 sums of 4 adjacent u8 x s8 products
+inline __m256i dot4(__m256i acc, __m256i u, __m256i s){
+#ifdef GO_IGEMM_VNNI
+  return GO_DPBUSD(acc, u, s);
+#else
+  __m256i pairs = _mm256_maddubs_epi16(u, s);
+  return _mm256_add_epi32(acc, _mm256_madd_epi16(pairs, _mm256_set1_epi16(1)));
+#endif
+}
+
+inline int32_t hsum(__m256i v){
+  __m128i x = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+  x = _mm_add_epi32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2)));
+  x = _mm_add_epi32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(x);
+}
+
+// MR rows of A against two columns of B; `ldc` is the row stride of C.
+template <int MR>
+inline void idot(int K, int ldc, const int8_t* A, const uint8_t* B0, const uint8_t* B1, int32_t* C){
+  __m256i c0[MR], c1[MR];
+  for(int r=0;r<MR;++r){ c0[r] = _mm256_setzero_si256(); c1[r] = _mm256_setzero_si256(); }
+  for(int k=0;k<K;k+=32){
+    __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(B0 + k));
+    __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(B1 + k));
+    for(int r=0;r<MR;++r){
+      __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(A + static_cast<size_t>(r) * K + k));
+      c0[r] = dot4(c0[r], b0, a);
+      c1[r] = dot4(c1[r], b1, a);
+    }
+  }
+  for(int r=0;r<MR;++r){ C[static_cast<size_t>(r) * ldc] = hsum(c0[r]); C[static_cast<size_t>(r) * ldc + 1] = hsum(c1[r]); }
+}
+
+// MR rows of C over `width` columns starting at B and C.
+template <int MR>
+void irowPanel(int ldc, int width, int K, const int8_t* A, const uint8_t* B, int32_t* C){
+  int j = 0;
+  for(;j+2<=width;j+=2) idot<MR>(K, ldc, A, B + static_cast<size_t>(j) * K, B + static_cast<size_t>(j + 1) * K, C + j);
+  // odd column: pair it with itself and keep the first result
+  if(j < width){
+    int32_t tmp[2 * MR];
+    idot<MR>(K, 2, A, B + static_cast<size_t>(j) * K, B + static_cast<size_t>(j) * K, tmp);
+    for(int r=0;r<MR;++r) C[static_cast<size_t>(r) * ldc + j] = tmp[2 * r];
+  }
+}
+#endif
+
+} // namespace
+
+void igemmU8S8Scalar(int M, int N, int K, const int8_t* A, const uint8_t* B, int32_t* C){
+  for(int i=0;i<M;++i){
+    const int8_t* a = A + static_cast<size_t>(i) * K;
+    for(int j=0;j<N;++j){
+      const uint8_t* b = B + static_cast<size_t>(j) * K;
+      int32_t t = 0;
+      for(int k=0;k<K;++k) t += static_cast<int32_t>(a[k]) * b[k];
+      C[static_cast<size_t>(i) * N + j] = t;
+    }
+  }
+}
+
+void igemmU8S8(int M, int N, int K, const int8_t* A, const uint8_t* B, int32_t* C){
+#ifdef GO_IGEMM_AVX2
+  // column panels keep a slice of B in cache while every row of A passes over it
+  constexpr int kCols = 64;
+  for(int j0=0;j0<N;j0+=kCols){
+    int w = std::min(kCols, N - j0);
+    const uint8_t* B0 = B + static_cast<size_t>(j0) * K;
+    int i = 0;
+    for(;i+4<=M;i+=4) irowPanel<4>(N, w, K, A + static_cast<size_t>(i) * K, B0, C + static_cast<size_t>(i) * N + j0);
+    for(;i<M;++i) irowPanel<1>(N, w, K, A + static_cast<size_t>(i) * K, B0, C + static_cast<size_t>(i) * N + j0);
+  }
+#else
+  igemmU8S8Scalar(M, N, K, A, B, C);
+#endif
+}
+
+const char* igemmKernel(){
+#if defined(GO_IGEMM_VNNI)
+  return "vnni";
+#elif defined(GO_IGEMM_AVX2)
+  return "avx2";
+#else
+  return "scalar";
+#endif
+}
+
+void sgemmScalar(int M, int N, int K, const float* A, const float* B, float* C, bool accumulate){
+  clearIfNeeded(M, N, C, accumulate);
+  for(int i=0;i<M;++i){
+    float* c = C + static_cast<size_t>(i) * N;
+    for(int k=0;k<K;++k){
+      float a = A[static_cast<size_t>(i) * K + k];
+      if(a == 0.0f) continue;
+      const float* b = B + static_cast<size_t>(k) * N;
+      for(int j=0;j<N;++j) c[j] += a * b[j];
+    }
+  }
+}
+
+void sgemm(int M, int N, int K, const float* A, const float* B, float* C, bool accumulate){
+#ifdef GO_GEMM_AVX2
+  clearIfNeeded(M, N, C, accumulate);
+  for(int j0=0;j0<N;j0+=kNBlock){
+    int w = std::min(kNBlock, N - j0);
+    const float* B0 = B + j0;
+    float* C0 = C + j0;
+    int i = 0;
+    for(;i+4<=M;i+=4) rowPanel<4>(N, w, K, A + static_cast<size_t>(i) * K, B0, C0 + static_cast<size_t>(i) * N);
+    switch(M - i){
+      case 3: rowPanel<3>(N, w, K, A + static_cast<size_t>(i) * K, B0, C0 + static_cast<size_t>(i) * N); break;
+      case 2: rowPanel<2>(N, w, K, A + static_cast<size_t>(i) * K, B0, C0 + static_cast<size_t>(i) * N); break;
+      case 1: rowPanel<1>(N, w, K, A + static_cast<size_t>(i) * K, B0, C0 + static_cast<size_t>(i) * N); break;
+      default: break;
+    }
+  }
+#else
+  sgemmScalar(M, N, K, A, B, C, accumulate);
+#endif
+}
+
+bool sgemmUsesAvx2(){
+#ifdef GO_GEMM_AVX2
+  return true;
+#else
+  return false;
+#endif
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+// Single-precision matrix multiply for the network backends:
+// C[M x N] = A[M x K] * B[K x N], or C += A * B when `accumulate`. All matrices are
+// row-major and densely packed. Uses an AVX2/FMA kernel when the build targets it
+// (GO_NATIVE_ARCH) and a portable scalar loop otherwise.
+void sgemm(int M, int N, int K, const float* A, const float* B, float* C, bool accumulate = false);
+// The portable kernel, regardless of build flags.
+void sgemmScalar(int M, int N, int K, const float* A, const float* B, float* C, bool accumulate = false);
+// Whether sgemm() runs the AVX2 kernel.
+bool sgemmUsesAvx2();
+
+// 8-bit product for quantized layers: C[M x N] = A[M x K] * B[N x K]^T in int32, with A
+// signed and B unsigned in 0..127 (so AVX2 pair sums cannot saturate). K must be a
+// multiple of 32. Uses AVX-VNNI dot products when the build targets them, AVX2 maddubs
+// otherwise, and a scalar loop without AVX2.
+void igemmU8S8(int M, int N, int K, const int8_t* A, const uint8_t* B, int32_t* C);
+void igemmU8S8Scalar(int M, int N, int K, const int8_t* A, const uint8_t* B, int32_t* C);
+// "vnni", "avx2" or "scalar"
+const char* igemmKernel();
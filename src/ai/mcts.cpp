@@ -1,11 +1,13 @@
 #include "mcts.h"
 #include "pvn.h"
 #include "rules.h"
-#include "thread_pool.h"
+#include "bitops.h"
+#include "playout.h"
 #include <cmath>
 #include <algorithm>
 #include <mutex>
 #include <atomic>
+#include <limits>
 
 // Simple heuristic prior: prefer center and moves adjacent to existing stones
 static double move_prior_score(const Board& b, const Board::Move& mv){
@@ -26,7 +28,9 @@ static double move_prior_score(const Board& b, const Board::Move& mv){
   return center_score + 2.0*adj_score;
 }
 
-MCTS::MCTS(const MCTSConfig& cfg): cfg(cfg), rng(0xC0FFEE), pv(makeSimpleHeuristicPV()) {}
+MCTS::MCTS(const MCTSConfig& cfg): cfg(cfg), rng(0xC0FFEE), tt(cfg.tt_size_mb) {}
+
+MCTS::~MCTS(){ stopPondering(); }
 
 std::vector<Board::Move> MCTS::legalMoves(const Board& b, Stone toPlay){
   std::vector<Board::Move> moves;
@@ -39,8 +43,22 @@ std::vector<Board::Move> MCTS::legalMoves(const Board& b, Stone toPlay){
   return moves;
 }
 
-double MCTS::rollout(Board state, Stone player, std::mt19937_64 &rng){
+double MCTS::rollout(const Board& start, Stone player, std::mt19937_64 &rng, std::vector<NodeMove>* played, int* engineRuns){
+  // Without a policy net the playout engine does the weighted walk below (or a uniform one)
+  // without allocating
+  thread_local PlayoutEngine engine;
+  if(!pv && engine.reset(start, cfg.uniform_playouts ? PlayoutEngine::Sampling::Uniform : PlayoutEngine::Sampling::Weighted)){
+    if(engineRuns) ++*engineRuns;
+    Xoshiro256 fast(rng());
+    double z = engine.run(player, fast, cfg.playout_depth);
+    if(played){
+      for(int i=0;i<engine.movesPlayed();++i)
+        played->push_back({static_cast<int16_t>(engine.playedPoint(i)), static_cast<uint8_t>(engine.playedColour(i)), 0});
+    }
+    return z;
+  }
   // play random moves until both pass consecutively or depth
+  Board state = start;
   Stone cur = player;
   int passes = 0;
   for(int d=0; d<cfg.playout_depth; ++d){
@@ -55,7 +73,7 @@ double MCTS::rollout(Board state, Stone player, std::mt19937_64 &rng){
     if(idx>=moves.size()) idx = moves.size()-1;
     auto m = moves[idx];
     if(m.pass){ state.pass(cur); passes++; }
-    else { state.place(m.x,m.y,cur); passes = 0; }
+    else { if(state.place(m.x,m.y,cur) && played) played->push_back(NodeMove::from(m, state.size())); passes = 0; }
     if(passes>=2) break;
     cur = (cur==BLACK?WHITE:BLACK);
   }
@@ -64,72 +82,368 @@ double MCTS::rollout(Board state, Stone player, std::mt19937_64 &rng){
   return sc.first > sc.second ? 1.0 : 0.0;
 }
 
-MCTS::Node* MCTS::select(Node* node){
+bool MCTS::applyMove(Board& b, const NodeMove& m){
+  if(m.pass) return b.pass(static_cast<Stone>(m.color));
+  return b.place(m.point % b.size(), m.point / b.size(), static_cast<Stone>(m.color));
+}
+
+MCTS::EdgeColumns MCTS::columns(const Node* n, int seg){
+  size_t cap = segmentCapacity(seg);
+  char* base = n->edges[seg];
+  EdgeColumns c;
+  c.stats = reinterpret_cast<std::atomic<uint64_t>*>(base);
+  c.value = reinterpret_cast<std::atomic<int64_t>*>(c.stats + cap);
+  c.amaf = reinterpret_cast<std::atomic<uint64_t>*>(c.value + cap);
+  c.child = reinterpret_cast<Node**>(c.amaf + cap);
+  return c;
+}
+
+int MCTS::segmentOf(int i, int& slot){
+  if(i < 8){ slot = i; return 0; }
+  int seg = highestBit(static_cast<uint64_t>(i)) - 2;
+  slot = i - (4 << seg);
+  return seg;
+}
+
+bool MCTS::generateMoves(Node* node, const Board& board, NodeArena::Cursor& cursor, const std::vector<double>* policy){
+  if(node->movesGenerated.load(std::memory_order_acquire)) return true;
+  int N = board.size();
+  auto legal = legalMoves(board, node->playerToMove);
+  NodeMove* moves = cursor.allocateArray<NodeMove>(legal.size());
+  float* priors = moves ? cursor.allocateArray<float>(legal.size()) : nullptr;
+  if(!priors){ arena.recycle(moves, legal.size() * sizeof(NodeMove)); return false; }
+  std::vector<double> p;
+  if(policy) p = *policy;
+  else if(pv) p = pv->policy(board, legal);
+  if(p.size() != legal.size()){
+    p.resize(legal.size());
+    for(size_t i=0;i<legal.size();++i) p[i] = move_prior_score(board, legal[i]) + 1.0;
+  }
+  double tot = 0.0;
+  for(double v : p) tot += v;
+  for(size_t i=0;i<legal.size();++i){
+    moves[i] = NodeMove::from(legal[i], N);
+    priors[i] = static_cast<float>(tot > 0 ? p[i] / tot : 1.0 / legal.size());
+  }
+  node->moves = moves;
+  node->priors = priors;
+  node->nextPrior.store(legal.empty() ? 0.0f : *std::max_element(priors, priors + legal.size()), std::memory_order_relaxed);
+  node->movesCapacity = static_cast<uint16_t>(legal.size());
+  node->numMoves.store(node->movesCapacity, std::memory_order_relaxed);
+  node->movesGenerated.store(true, std::memory_order_release);
+  return true;
+}
+
+void MCTS::resetRoot(const Board& root, Stone toPlay){
+  rootState = root;
+  rootPlayer = toPlay;
+  // dropping the previous tree is O(1): forget every arena allocation
+  tt.clear();
+  arena.reset();
+  arena.setBudget(cfg.memory_budget_mb << 20);
+  mainCursor = NodeArena::Cursor(arena);
+  rootNode = mainCursor.create<Node>(toPlay, NodeMove{-1, static_cast<uint8_t>(toPlay), 1}, root.situationHash(toPlay));
+  rootVisits.store(0);
+  rootValue.store(0);
+  rootNoised = false;
+  if(rootNode) tt.insert(rootNode->hash, static_cast<void*>(rootNode), LockFreeTT::kMaxPriority);
+}
+
+bool MCTS::prepareRoot(const Board& root, Stone toPlay){
+  stopPondering();
+  // moves played since the tree's root (ours, the opponent's reply) descend into the kept subtree
+  const auto& played = root.moves();
+  size_t since = rootState.moves().size();
+  if(rootNode && rootState.size() == root.size() && played.size() > since && played.size() - since <= kMaxDescend
+     && std::equal(played.begin(), played.begin() + since, rootState.moves().begin(),
+                   [](const Board::Move& a, const Board::Move& b){ return a.x==b.x && a.y==b.y && a.s==b.s && a.pass==b.pass; })){
+    for(size_t i=since; i<played.size() && rootNode; ++i) if(!moveToChild(played[i])) break;
+  }
+  if(rootNode && rootPlayer == toPlay && rootState.size() == root.size() && rootNode->hash == root.situationHash(toPlay)) rootState = root;
+  else resetRoot(root, toPlay);
+  stats = SearchStats{};
+  if(!rootNode) return false;
+  stats.inheritedVisits = rootVisits.load();
+  if(cfg.dirichlet_epsilon > 0 && !rootNoised) addRootNoise();
+  return true;
+}
+
+void MCTS::startPondering(const Board& board, Stone toMove, int nThreads){
+  if(!prepareRoot(board, toMove)) return;
+  ponderThread = std::thread([this, nThreads]{ search(std::numeric_limits<int>::max(), std::chrono::steady_clock::time_point::max(), nThreads); });
+}
+
+void MCTS::stopPondering(){
+  if(!ponderThread.joinable()) return;
+  stopRequested.store(true);
+  ponderThread.join();
+  stopRequested.store(false);
+}
+
+int MCTS::selectEdge(const Node* node, int visits, double q) const {
+  int n = node->numChildren.load(std::memory_order_acquire);
+  if(n == 0) return cfg.puct && node->hasUntried() ? kExpandEdge : -1;
+  Stone p = node->playerToMove;
+  const float* prior = node->priors;
+  double best = -1e100; int bi = 0;
+  if(cfg.puct){
+    double c = cfg.c_puct * std::sqrt(std::max(1.0, static_cast<double>(visits)));
+    double visitedPrior = 0.0;
+    for(int seg=0, base=0; base<n; base += static_cast<int>(segmentCapacity(seg)), ++seg){
+      EdgeColumns e = columns(node, seg);
+      int m = std::min<int>(static_cast<int>(segmentCapacity(seg)), n - base);
+      for(int j=0;j<m;++j){
+        uint64_t st = e.stats[j].load(std::memory_order_relaxed);
+        int v = visitsOf(st), vl = virtualLossOf(st);
+        int64_t sum = e.value[j].load(std::memory_order_relaxed);
+        if(cfg.dag){ const Node* ch = e.child[j]; v = ch->visits.load(std::memory_order_relaxed); sum = ch->value.load(std::memory_order_relaxed); }
+        // simulations in flight count as losses
+        double mean = valueFor(p, sum, v, 0.0);
+        if(cfg.rave) mean = raveBlend(mean, v, e.amaf[j].load(std::memory_order_relaxed), p);
+        double Q = v + vl == 0 ? q : mean * v / (v + vl);
+        double P = prior[base + j];
+        visitedPrior += P;
+        double score = Q + c * P / (1.0 + v + vl);
+        if(score > best){ best = score; bi = base + j; }
+      }
+    }
+    if(node->hasUntried()){
+      double fpu = q - cfg.fpu_reduction * std::sqrt(visitedPrior);
+      if(fpu + c * node->nextPrior.load(std::memory_order_relaxed) > best) return kExpandEdge;
+    }
+    return bi;
+  }
+  // everything that does not depend on the edge is hoisted out of the scan
+  double c = cfg.exploration * std::sqrt(std::log1p(static_cast<double>(visits)));
+  // priors are normalized; scale them so the average edge keeps weight prior_weight
+  double pw = cfg.prior_weight * node->movesCapacity;
+  for(int seg=0, base=0; base<n; base += static_cast<int>(segmentCapacity(seg)), ++seg){
+    EdgeColumns e = columns(node, seg);
+    int m = std::min<int>(static_cast<int>(segmentCapacity(seg)), n - base);
+    for(int j=0;j<m;++j){
+      uint64_t st = e.stats[j].load(std::memory_order_relaxed);
+      int v = visitsOf(st);
+      double Q = cfg.dag ? valueFor(p, e.child[j]->value.load(std::memory_order_relaxed), e.child[j]->visits.load(std::memory_order_relaxed), 0.0)
+                         : valueFor(p, e.value[j].load(std::memory_order_relaxed), v, 0.0);
+      if(cfg.rave) Q = raveBlend(Q, v, e.amaf[j].load(std::memory_order_relaxed), p);
+      double score = Q + c / std::sqrt(v + virtualLossOf(st) + 1.0) + pw * prior[base + j] / (1.0 + v);
+      if(score > best){ best = score; bi = base + j; }
+    }
+  }
+  return bi;
+}
+
+int MCTS::selectRootEdge() const {
+  if(!rootNode) return -1;
+  int visits = rootVisits.load();
+  return selectEdge(rootNode, visits, valueFor(rootPlayer, rootValue.load(), visits, 0.5));
+}
+
+MCTS::Node* MCTS::select(Node* node, Board& board, std::vector<PathStep>& path, NodeArena::Cursor& cursor){
+  (void)cursor; // moves are generated by expand()
+  int visits = 0;
+  double q = 0.5;
+  if(node == rootNode){
+    visits = rootVisits.load(std::memory_order_relaxed);
+    q = valueFor(node->playerToMove, rootValue.load(std::memory_order_relaxed), visits, 0.5);
+  }
   while(true){
-    // If this node still has untried moves, return it for expansion
-    if(!node->untriedMoves.empty()) return node;
-    // If there are no children to descend into, return this node
-    if(node->children.empty()) return node;
-    // UCT selection (account for virtual loss)
-    double best = -1e100; size_t bi = 0;
-    for(size_t i=0;i<node->children.size();++i){
-      Node* c = node->children[i].get();
-      int cvis = c->visits.load();
-      int cvl = c->virtual_loss.load();
-      double Q = (cvis==0)?0.0:(c->value / static_cast<double>(cvis));
-        double denom = static_cast<double>(cvis + cvl + 1);
-        double U = cfg.exploration * std::sqrt(std::log1p(static_cast<double>(node->visits.load())) / denom);
-        double p = move_prior_score(node->state, c->moveFromParent);
-        double prior_term = cfg.prior_weight * p / (1.0 + static_cast<double>(cvis));
-        double score = Q + U + prior_term;
-      if(score > best){ best = score; bi = i; }
+    path.push_back({node, -1});
+    // first visit: the edges do not exist yet, expand() generates them
+    if(!node->movesGenerated.load(std::memory_order_acquire)) return node;
+    // DAG mode: passes can lead back to an earlier situation without a superko failure
+    if(path.size() > kMaxPathLength) return node;
+    // progressive widening: allow expansion only if children < threshold
+    if(!cfg.puct){
+      size_t max_children = std::max<size_t>(1, (size_t)(cfg.pw_k * std::pow(visits+1.0, cfg.pw_alpha)));
+      if(node->hasUntried() && node->numChildren.load(std::memory_order_acquire) < max_children) return node;
+    }
+    // If there are no children to descend into (or PUCT prefers a new one), return this node
+    int bi = selectEdge(node, visits, q);
+    if(bi < 0) return node;
+    EdgeRef e = edge(node, bi);
+    Node* chosen = e.cols.child[e.slot];
+    // its evaluation is still in flight: widen here rather than queue behind it
+    if(evaluator && node->hasUntried() && !chosen->movesGenerated.load(std::memory_order_acquire)) return node;
+    prefetchRead(chosen);
+    // reserve virtual loss on chosen edge and move down
+    uint64_t st = e.cols.stats[e.slot].fetch_add(kVirtualLossUnit, std::memory_order_relaxed);
+    path.back().edge = bi;
+    if(!applyMove(board, node->moves[bi])){
+      // a transposition reached with a different history: the move repeats a position here,
+      // so this node is the leaf whatever expand() would make of it
+      path.back().edge = -1;
+      e.cols.stats[e.slot].fetch_sub(kVirtualLossUnit, std::memory_order_relaxed);
+      return nullptr;
+    }
+    node = chosen;
+    if(cfg.dag){
+      visits = node->visits.load(std::memory_order_relaxed);
+      q = valueFor(node->playerToMove, node->value.load(std::memory_order_relaxed), visits, q);
+    } else {
+      visits = visitsOf(st);
+      q = valueFor(node->playerToMove, e.cols.value[e.slot].load(std::memory_order_relaxed), visits, q);
     }
-    node = node->children[bi].get();
   }
 }
 
-MCTS::Node* MCTS::expand(Node* node){
-  // Progressive widening: limit number of children allowed based on node visits
-  double visits = static_cast<double>(node->visits.load());
-  size_t max_children = std::max<size_t>(1, (size_t)(cfg.pw_k * std::pow(visits+1.0, cfg.pw_alpha)));
-  if(node->untriedMoves.empty() || node->children.size() >= max_children) return node;
+MCTS::Node* MCTS::expand(std::vector<PathStep>& path, Board& board, std::mt19937_64& rng, NodeArena::Cursor& cursor){
+  Node* node = path.back().node;
+  if(evaluator && !node->movesGenerated.load(std::memory_order_acquire)){
+    // the priors arrive with the node's evaluation, which is requested outside the lock
+    bool idle = false;
+    return node->evaluating.compare_exchange_strong(idle, true) ? node : nullptr;
+  }
+  std::lock_guard<SpinLock> lk(node->lock);
+  if(!generateMoves(node, board, cursor)) return node;
+  int N = board.size();
+  // another thread took the last untried move: descend instead of evaluating this node twice
+  auto exhausted = [&]{
+    return evaluator && node->numChildren.load(std::memory_order_relaxed) > 0 && path.size() <= kMaxPathLength ? nullptr : node;
+  };
+  if(!node->hasUntried()) return exhausted();
+  int numChildren = node->numChildren.load(std::memory_order_relaxed);
+  // allocate before touching the board so a full arena never leaves it half-updated
+  int slot, seg = segmentOf(numChildren, slot);
+  if(!node->edges[seg]){
+    char* block = static_cast<char*>(cursor.allocate(segmentBytes(seg)));
+    if(!block) return node;
+    node->edges[seg] = block;
+    EdgeColumns e = columns(node, seg);
+    for(size_t j=0;j<segmentCapacity(seg);++j){ new(&e.stats[j]) std::atomic<uint64_t>(0); new(&e.value[j]) std::atomic<int64_t>(0); new(&e.amaf[j]) std::atomic<uint64_t>(0); }
+  }
+  void* mem = cursor.allocate(sizeof(Node));
+  if(!mem) return node;
+  while(node->hasUntried()){
+    size_t end = node->numMoves.load(std::memory_order_relaxed);
+    size_t idx = pickUntried(node, numChildren, end, rng);
+    NodeMove mv = node->moves[idx];
+    // suicide/superko: the board is unchanged, drop the move and try another
+    if(!mv.pass && !board.place(mv.point % N, mv.point / N, static_cast<Stone>(mv.color))){
+      node->moves[idx] = node->moves[end-1];
+      node->priors[idx] = node->priors[end-1];
+      node->numMoves.store(static_cast<uint16_t>(end-1), std::memory_order_relaxed);
+      continue;
+    }
+    if(mv.pass) board.pass(static_cast<Stone>(mv.color));
+    Stone next = (mv.color==BLACK?WHITE:BLACK);
+    uint64_t h = board.situationHash(next);
+    Node* child = nullptr;
+    if(cfg.dag){
+      // share the node of an equal situation, unless that would close a cycle
+      Node* t = static_cast<Node*>(tt.get(h));
+      if(t && std::none_of(path.begin(), path.end(), [t](const PathStep& s){ return s.node == t; })){
+        child = t;
+        arena.recycle(mem, sizeof(Node));
+      }
+    }
+    if(!child){
+      child = new(mem) Node(next, mv, h);
+      child->parent = node;
+      // claimed for this simulation's evaluation before anyone can reach it
+      if(evaluator) child->evaluating.store(true, std::memory_order_relaxed);
+      // register in transposition table
+      tt.insert(child->hash, static_cast<void*>(child), LockFreeTT::kMaxPriority - std::min<unsigned>(path.size(), LockFreeTT::kMaxPriority));
+    }
+    // expanded edges stay in [0, numChildren)
+    int ei = numChildren;
+    std::swap(node->moves[idx], node->moves[ei]);
+    std::swap(node->priors[idx], node->priors[ei]);
+    EdgeColumns e = columns(node, seg);
+    e.value[slot].store(0, std::memory_order_relaxed);
+    e.amaf[slot].store(0, std::memory_order_relaxed);
+    e.stats[slot].store(kVirtualLossUnit, std::memory_order_relaxed); // reserved for this simulation
+    e.child[slot] = child;
+    if(cfg.puct){
+      float next = 0.0f;
+      for(size_t i=ei+1;i<end;++i) next = std::max(next, node->priors[i]);
+      node->nextPrior.store(next, std::memory_order_relaxed);
+    }
+    // publish: selection reads the slot only after seeing the new count
+    node->numChildren.store(static_cast<uint16_t>(ei + 1), std::memory_order_release);
+    path.back().edge = ei;
+    path.push_back({child, -1});
+    return child;
+  }
+  arena.recycle(mem, sizeof(Node));
+  return exhausted();
+}
+
+size_t MCTS::pickUntried(const Node* node, size_t first, size_t end, std::mt19937_64& rng) const {
+  const float* prior = node->priors;
+  // PUCT expands the move selection asked for: the highest prior
+  if(cfg.puct) return static_cast<size_t>(std::max_element(prior + first, prior + end) - prior);
   // choose untried move weighted by prior
-  std::vector<double> weights(node->untriedMoves.size()); double tot=0.0;
-  for(size_t i=0;i<node->untriedMoves.size();++i){ weights[i]=move_prior_score(node->state, node->untriedMoves[i])+1.0; tot+=weights[i]; }
+  double tot = 0.0;
+  for(size_t i=first;i<end;++i) tot += prior[i];
   std::uniform_real_distribution<double> ud(0.0, tot);
-  double r = ud(rng); size_t idx=0; double acc=0.0; for(; idx<weights.size(); ++idx){ acc+=weights[idx]; if(r<=acc) break; }
-  if(idx>=node->untriedMoves.size()) idx = node->untriedMoves.size()-1;
-  auto mv = node->untriedMoves[idx];
-  // remove move from untried
-  node->untriedMoves.erase(node->untriedMoves.begin()+idx);
-  // create child state
-  Board childState = node->state;
-  if(mv.pass) childState.pass(mv.s);
-  else childState.place(mv.x,mv.y,mv.s);
-  Stone next = (mv.s==BLACK?WHITE:BLACK);
-  auto child = std::make_unique<Node>(childState, next, mv);
-  child->untriedMoves = legalMoves(childState, next);
-  child->parent = node;
-  Node* ptr = child.get();
-  node->children.push_back(std::move(child));
-  // register in transposition table
-  tt.insert(ptr->state.zobrist(), static_cast<void*>(ptr));
-  return ptr;
+  double r = ud(rng); size_t idx=first; double acc=0.0; for(; idx<end; ++idx){ acc+=prior[idx]; if(r<=acc) break; }
+  return idx>=end ? end-1 : idx;
+}
+
+void MCTS::releasePath(const std::vector<PathStep>& path){
+  for(const auto &step : path){
+    if(step.edge < 0) continue;
+    EdgeRef e = edge(step.node, step.edge);
+    e.cols.stats[e.slot].fetch_sub(kVirtualLossUnit, std::memory_order_relaxed);
+  }
 }
 
-void MCTS::backpropagate(Node* node, double result){
+void MCTS::backpropagate(const std::vector<PathStep>& path, double result, const std::vector<NodeMove>* playout){
   // result is from BLACK perspective
-  while(node!=nullptr){
-    // remove any virtual loss reserved on this node (if any)
-    int vl = node->virtual_loss.load();
-    if(vl > 0) node->virtual_loss.fetch_sub(1);
-    node->visits.fetch_add(1);
-    {
-      std::lock_guard<std::mutex> lk(node->node_mutex);
-      node->value += result;
+  int64_t fixed = static_cast<int64_t>(std::llround(result * kValueScale));
+  rootVisits.fetch_add(1, std::memory_order_relaxed);
+  rootValue.fetch_add(fixed, std::memory_order_relaxed);
+  for(const auto &step : path){
+    if(step.edge < 0) continue;
+    EdgeRef e = edge(step.node, step.edge);
+    // one add counts the visit and removes the virtual loss reserved on the way down
+    e.cols.stats[e.slot].fetch_add(1 - kVirtualLossUnit, std::memory_order_relaxed);
+    e.cols.value[e.slot].fetch_add(fixed, std::memory_order_relaxed);
+    if(cfg.dag){
+      Node* child = e.cols.child[e.slot];
+      child->visits.fetch_add(1, std::memory_order_relaxed);
+      child->value.fetch_add(fixed, std::memory_order_relaxed);
     }
-    node = node->parent;
   }
+  if(!cfg.rave) return;
+  // AMAF: walking up, `played` holds every move made after the current node, by colour
+  int NN = rootState.size() * rootState.size();
+  static thread_local std::vector<uint8_t> played;
+  played.assign(2 * NN, 0);
+  auto mark = [&](const NodeMove& m){ if(!m.pass) played[(m.color == WHITE ? NN : 0) + m.point] = 1; };
+  if(playout) for(const NodeMove& m : *playout) mark(m);
+  uint64_t amafAdd = 1 | (static_cast<uint64_t>(std::llround(result * kAmafScale)) << 32);
+  for(size_t i = path.size(); i-- > 0;){
+    const PathStep& step = path[i];
+    if(step.edge >= 0) mark(step.node->moves[step.edge]);
+    const Node* n = step.node;
+    const uint8_t* mine = played.data() + (n->playerToMove == WHITE ? NN : 0);
+    int c = n->numChildren.load(std::memory_order_acquire);
+    for(int seg=0, base=0; base<c; base += static_cast<int>(segmentCapacity(seg)), ++seg){
+      EdgeColumns e = columns(n, seg);
+      int m = std::min<int>(static_cast<int>(segmentCapacity(seg)), c - base);
+      for(int j=0;j<m;++j){
+        const NodeMove& mv = n->moves[base + j];
+        if(!mv.pass && mine[mv.point]) e.amaf[j].fetch_add(amafAdd, std::memory_order_relaxed);
+      }
+    }
+  }
+}
+
+void MCTS::addRootNoise(){
+  if(!generateMoves(rootNode, rootState, mainCursor)) return;
+  size_t n = rootNode->numMoves.load(std::memory_order_relaxed);
+  if(n == 0) return;
+  std::gamma_distribution<double> gamma(cfg.dirichlet_alpha, 1.0);
+  std::vector<double> eta(n); double tot = 0.0;
+  for(double& x : eta){ x = gamma(rng); tot += x; }
+  if(tot <= 0) return;
+  float* prior = rootNode->priors;
+  for(size_t i=0;i<n;++i)
+    prior[i] = static_cast<float>((1.0 - cfg.dirichlet_epsilon) * prior[i] + cfg.dirichlet_epsilon * eta[i] / tot);
+  rootNode->nextPrior.store(*std::max_element(prior + rootNode->numChildren.load(), prior + n), std::memory_order_relaxed);
+  rootNoised = true;
 }
 
 Board::Move MCTS::run(const Board& root, Stone toPlay){
@@ -138,123 +452,170 @@ Board::Move MCTS::run(const Board& root, Stone toPlay){
 }
 
 Board::Move MCTS::runParallel(const Board& root, Stone toPlay, int iterations, int nThreads){
-  rootNode = std::make_unique<Node>(root, toPlay, Board::Move{-1,-1,toPlay,true,std::string()});
-  rootNode->untriedMoves = legalMoves(root, toPlay);
-  // clear transposition table and register root
-  tt.clear();
-  tt.insert(rootNode->state.zobrist(), static_cast<void*>(rootNode.get()));
+  if(!prepareRoot(root, toPlay)) return Board::Move{-1,-1,toPlay,true,std::string()};
+  search(iterations, std::chrono::steady_clock::time_point::max(), nThreads);
+  return bestRootMove();
+}
 
-  std::atomic<int> remaining(iterations);
-  ThreadPool pool((size_t)std::max(1, nThreads));
+Board::Move MCTS::runFor(const Board& root, Stone toPlay, std::chrono::steady_clock::time_point deadline, int nThreads){
+  if(!prepareRoot(root, toPlay)) return Board::Move{-1,-1,toPlay,true,std::string()};
+  search(std::numeric_limits<int>::max(), deadline, nThreads);
+  return bestRootMove();
+}
 
-  auto worker = [this, &remaining]() {
+Board::Move MCTS::runTimed(const Board& root, Stone toPlay, const TimeManager& tm, int moveNumber, int nThreads){
+  using Clock = std::chrono::steady_clock;
+  auto start = Clock::now();
+  auto at = [start](double seconds){ return start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds)); };
+  TimeManager::Budget b = tm.budget(moveNumber, root.size());
+  if(!prepareRoot(root, toPlay)) return Board::Move{-1,-1,toPlay,true,std::string()};
+  const int kUnlimited = std::numeric_limits<int>::max();
+  // the choice at half time is compared with the one at the target
+  search(kUnlimited, at(0.5 * b.target), nThreads, at(b.target));
+  int previous = bestRootIndex();
+  if(!stats.stoppedEarly) search(kUnlimited, at(b.target), nThreads, at(b.target));
+  // extend in slices while the best move changes or leads by too little
+  double slice = std::max(0.25 * b.target, 0.01);
+  while(!stats.stoppedEarly && Clock::now() < at(b.maximum)){
+    int second = 0;
+    int best = bestRootIndex(&second);
+    if(best == previous && childVisits(best) >= 1.5 * second) break;
+    previous = best;
+    search(kUnlimited, std::min(at(b.maximum), Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(slice))), nThreads, at(b.maximum));
+  }
+  // the unused time stays on the clock, where later budgets pick it up
+  if(stats.stoppedEarly) stats.secondsSaved = std::max(0.0, std::chrono::duration<double>(at(b.target) - Clock::now()).count());
+  return bestRootMove();
+}
+
+void MCTS::search(int iterations, std::chrono::steady_clock::time_point deadline, int nThreads,
+                  std::chrono::steady_clock::time_point horizon){
+  using Clock = std::chrono::steady_clock;
+  // shared by every worker; kept off the cache lines the workers write to
+  alignas(64) std::atomic<int> remaining(iterations);
+  alignas(64) std::atomic<bool> decided{false};
+  std::atomic<int> playouts(0);
+  bool timed = deadline != Clock::time_point::max();
+  if(horizon == Clock::time_point::max()) horizon = deadline;
+  int visitsBefore = rootVisits.load();
+  auto start = Clock::now();
+  int interval = std::max(1, cfg.early_stop_interval);
+  rootHistory = rootState.history();
+  std::sort(rootHistory.begin(), rootHistory.end());
+
+  // iterations the rest of this search would still run
+  auto left = [&](int it) -> double {
+    if(!timed) return std::max(0, it - 1);
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    double rate = (rootVisits.load(std::memory_order_relaxed) - visitsBefore) / std::max(elapsed, 1e-6);
+    return rate * std::max(0.0, std::chrono::duration<double>(horizon - Clock::now()).count());
+  };
+
+  auto worker = [&, timed, deadline](int) {
     // seed a thread-local RNG from global rng once
     static thread_local bool seeded = false;
     static thread_local std::mt19937_64 local_rng;
     if(!seeded){ uint64_t s; { std::lock_guard<std::mutex> rlk(this->rng_mutex); s = this->rng(); } local_rng.seed(s); seeded = true; }
 
+    // scratch position and path reused across iterations; nodes come from a private arena cursor
+    Board board(rootState.size());
+    NodeArena::Cursor cursor(arena);
+    std::vector<PathStep> path;
+    std::vector<NodeMove> playout;
+    int engineRuns = 0;
     while (true) {
       int it = remaining.fetch_sub(1, std::memory_order_relaxed);
-      if (it <= 0) break;
-
-      // Selection with virtual loss reservation
-      Node* node = rootNode.get();
-      std::vector<Node*> path;
-      path.push_back(node);
-
-      while (true) {
-        // lock node to read children/untriedMoves consistently
-        std::unique_lock<std::mutex> lk(node->node_mutex);
-        // progressive widening: allow expansion only if children < threshold
-        double visits_local = static_cast<double>(node->visits.load());
-        size_t max_children_local = std::max<size_t>(1, (size_t)(cfg.pw_k * std::pow(visits_local+1.0, cfg.pw_alpha)));
-        if (!node->untriedMoves.empty() && node->children.size() < max_children_local) { lk.unlock(); break; }
-        // If there are no children to descend into, expand here
-        if (node->children.empty()) { lk.unlock(); break; }
-        double best = -1e100; size_t bi = 0;
-        for (size_t i = 0; i < node->children.size(); ++i) {
-          Node* c = node->children[i].get();
-          int cvis = c->visits.load();
-          int cvl = c->virtual_loss.load();
-          double Q = (cvis==0) ? 0.0 : (c->value / static_cast<double>(cvis));
-          double denom = static_cast<double>(cvis + cvl + 1);
-          double U = cfg.exploration * std::sqrt(std::log1p(static_cast<double>(node->visits.load())) / denom);
-          double p = move_prior_score(node->state, c->moveFromParent);
-          double prior_term = cfg.prior_weight * p / (1.0 + static_cast<double>(cvis));
-          double score = Q + U + prior_term;
-          if (score > best) { best = score; bi = i; }
-        }
-        Node* chosen = node->children[bi].get();
-        // reserve virtual loss on chosen and move down
-        chosen->virtual_loss.fetch_add(1);
-        lk.unlock();
-        node = chosen;
-        path.push_back(node);
-      }
+      if (it <= 0 || stopRequested.load(std::memory_order_relaxed)) break;
 
-      // Expansion
-      Node* leaf = node;
-      {
-        std::unique_lock<std::mutex> lk(leaf->node_mutex);
-        if (!leaf->untriedMoves.empty()) {
-          // pick random untried move weighted by prior
-          std::vector<double> weights(leaf->untriedMoves.size()); double tot=0.0;
-          for(size_t i=0;i<leaf->untriedMoves.size();++i){ weights[i]=move_prior_score(leaf->state, leaf->untriedMoves[i])+1.0; tot+=weights[i]; }
-          std::uniform_real_distribution<double> ud(0.0, tot);
-          double rr = ud(local_rng); size_t idx=0; double acc=0.0; for(; idx<weights.size(); ++idx){ acc+=weights[idx]; if(rr<=acc) break; }
-          if(idx>=leaf->untriedMoves.size()) idx = leaf->untriedMoves.size()-1;
-          auto mv = leaf->untriedMoves[idx];
-          leaf->untriedMoves.erase(leaf->untriedMoves.begin() + idx);
-          Board childState = leaf->state;
-          if (mv.pass) childState.pass(mv.s);
-          else childState.place(mv.x, mv.y, mv.s);
-          Stone next = (mv.s == BLACK ? WHITE : BLACK);
-          auto child = std::make_unique<Node>(childState, next, mv);
-          child->untriedMoves = legalMoves(childState, next);
-          child->parent = leaf;
-          Node* ptr = child.get();
-          leaf->children.push_back(std::move(child));
-          // register in transposition table
-          {
-            tt.insert(ptr->state.zobrist(), static_cast<void*>(ptr));
-          }
-          // reserve virtual loss on new child
-          ptr->virtual_loss.fetch_add(1);
-          leaf = ptr;
-          path.push_back(leaf);
-        }
+      board.restore(rootState, &rootHistory);
+      path.clear();
+      Node* leaf = select(rootNode, board, path, cursor) ? expand(path, board, local_rng, cursor) : path.back().node;
+      if(!leaf){
+        // the leaf awaits another thread's evaluation: hand the iteration back and retry
+        releasePath(path);
+        remaining.fetch_add(1, std::memory_order_relaxed);
+        if(timed && Clock::now() >= deadline) break;
+        std::this_thread::yield();
+        continue;
       }
 
       // Simulation: prefer PV value if available, otherwise rollout using local RNG
       double z;
-      if(this->pv){ z = this->pv->value(leaf->state); }
-      else { z = rollout(leaf->state, leaf->playerToMove, local_rng); }
+      if(this->evaluator){
+        // one request yields both the value and the leaf's priors; the thread waits for
+        // its batch while virtual loss steers the others to different leaves
+        auto legal = legalMoves(board, leaf->playerToMove);
+        PolicyValueNet::Evaluation ev = this->evaluator->evaluate(board, legal);
+        z = ev.value;
+        if(!leaf->movesGenerated.load(std::memory_order_acquire)){
+          std::lock_guard<SpinLock> lk(leaf->lock);
+          // a full arena leaves the node unexpanded; let a later visit claim it again
+          if(!generateMoves(leaf, board, cursor, &ev.policy)) leaf->evaluating.store(false, std::memory_order_release);
+        }
+      }
+      else if(this->pv){ z = this->pv->value(board); }
+      else { playout.clear(); z = rollout(board, leaf->playerToMove, local_rng, cfg.rave ? &playout : nullptr, &engineRuns); }
 
       // Backpropagate and remove virtual losses
-      for (auto itn = path.rbegin(); itn != path.rend(); ++itn) {
-        Node* n = *itn;
-        // remove virtual loss
-        n->virtual_loss.fetch_sub(1);
-        // update stats (protect value)
-        {
-          std::lock_guard<std::mutex> lk(n->node_mutex);
-          n->visits.fetch_add(1);
-          n->value += z;
-        }
+      backpropagate(path, z, cfg.rave && !this->pv && !this->evaluator ? &playout : nullptr);
+      if(cfg.early_stop && it % interval == 0 && rootDecided(left(it))){
+        // the other workers see an exhausted budget and finish their current simulation
+        if(!decided.exchange(true)) stats.iterationsSaved += static_cast<int>(left(it));
+        remaining.store(0, std::memory_order_relaxed);
+        break;
       }
+      if(timed && Clock::now() >= deadline) break;
     }
+    playouts.fetch_add(engineRuns, std::memory_order_relaxed);
   };
 
-  // start workers
-  for (int i = 0; i < nThreads; ++i) pool.enqueue(worker);
-  // destructor of pool will join when leaving scope; ensure all tasks are enqueued
-  // wait until tasks finish by letting pool go out of scope
-  // (pool will be destroyed at end of function)
+  // returns once every worker has finished, so every iteration is counted before the
+  // move is picked
+  pool.run(nThreads, worker);
+  stats.iterations += rootVisits.load() - visitsBefore;
+  stats.playouts += playouts.load();
+  if(decided.load()) stats.stoppedEarly = true;
+}
+
+bool MCTS::rootDecided(double remaining) const {
+  int second = 0;
+  int leader = bestRootIndex(&second);
+  if(leader < 0) return false;
+  double lead = childVisits(leader);
+  // an untried move starts from zero visits
+  if(rootNode->hasUntried() && remaining >= lead) return false;
+  if(second + remaining < lead) return true;
+  if(cfg.early_stop_confidence <= 0) return false;
+  // value bound: a move that could still catch up by visits must also be able to catch up by value
+  auto bounds = [this](int i, double sign){
+    auto e = edge(rootNode, i);
+    int v = visitsOf(e.cols.stats[e.slot].load(std::memory_order_relaxed));
+    double q = valueFor(rootPlayer, e.cols.value[e.slot].load(std::memory_order_relaxed), v, 0.5);
+    return q + sign * cfg.early_stop_confidence * std::sqrt(std::max(q * (1.0 - q), 0.01) / std::max(v, 1));
+  };
+  double floor = bounds(leader, -1.0);
+  int n = rootNode->numChildren.load(std::memory_order_acquire);
+  for(int i=0;i<n;++i){
+    if(i == leader || childVisits(i) + remaining < lead) continue;
+    if(bounds(i, 1.0) >= floor) return false;
+  }
+  return true;
+}
 
-  // give pool destructor a chance by doing a small idle wait; not strictly necessary
+int MCTS::bestRootIndex(int* second) const {
+  int best = -1, bestVisits = -1, runnerUp = 0;
+  for (int i = 0; i < rootNode->numChildren; ++i) {
+    int v = childVisits(i);
+    if (v > bestVisits) { runnerUp = std::max(runnerUp, bestVisits); bestVisits = v; best = i; }
+    else runnerUp = std::max(runnerUp, v);
+  }
+  if (second) *second = runnerUp;
+  return best;
+}
+
+Board::Move MCTS::bestRootMove() const {
   // choose best by visits
-  Node* best = nullptr; int bestVisits = -1;
-  for (auto &c : rootNode->children) { int v = c->visits.load(); if (v > bestVisits) { bestVisits = v; best = c.get(); } }
-  if (best) return best->moveFromParent;
-  return Board::Move{-1,-1,toPlay,true,std::string()};
-}
\ No newline at end of file
+  int best = bestRootIndex();
+  if (best >= 0) return rootNode->moves[best].toMove(rootState.size());
+  return Board::Move{-1,-1,rootPlayer,true,std::string()};
+}
@@ -5,24 +5,96 @@
 #include <random>
 #include <unordered_map>
 #include <mutex>
+#include <thread>
 #include <atomic>
+#include <chrono>
+#include <cmath>
+#include <type_traits>
 #include "board.h"
-#include "tt_sharded.h"
+#include "node_arena.h"
+#include "search_pool.h"
+#include "spin_lock.h"
+#include "tt_lockfree.h"
 #include "pvn.h"
+#include "batch_evaluator.h"
+#include "time_manager.h"
 
 struct MCTSConfig {
   int iterations = 1000;
   int playout_depth = 200; // safety
+  // PlayoutEngine rollouts draw moves uniformly instead of by the prior heuristic: faster,
+  // weaker playouts
+  bool uniform_playouts = false;
   double exploration = 1.4;
   // Heuristics
   double prior_weight = 0.5; // weight of move prior in selection
   double pw_alpha = 0.5; // progressive widening exponent
   double pw_k = 1.0; // progressive widening multiplier
+  // PUCT selection (AlphaZero style): Q + c_puct * P * sqrt(N) / (1 + n), with the
+  // network's normalized priors. Untried moves compete through first-play urgency
+  // instead of progressive widening and are expanded in prior order.
+  bool puct = false;
+  double c_puct = 1.5;
+  double fpu_reduction = 0.25; // unvisited Q = parent Q - fpu_reduction * sqrt(sum of visited priors)
+  // Root Dirichlet noise mixed into the root priors at the start of a search (0 = off)
+  double dirichlet_epsilon = 0.0;
+  double dirichlet_alpha = 0.03;
+  // Tree memory cap in MB; when reached the search keeps evaluating leaves but stops
+  // adding nodes (0 = unlimited)
+  size_t memory_budget_mb = 0;
+  // Stop a search once no other root move can overtake the most visited one with the
+  // iterations (or, for timed searches, the time) left. Checked every
+  // early_stop_interval iterations.
+  bool early_stop = false;
+  int early_stop_interval = 64;
+  // Also count a move as beaten once its value's upper confidence bound (this many
+  // standard errors) is below the leader's lower bound (0 = visits only).
+  double early_stop_confidence = 0.0;
+  // Search a DAG: expansion links to an existing node for the same situation (stones,
+  // player to move, ko) instead of growing a duplicate subtree. Q is then read from the
+  // shared child node; visit counts and virtual loss stay on the edges.
+  bool dag = false;
+  // RAVE: blend each edge's Q with all-moves-as-first statistics gathered from the moves
+  // played below it (tree and rollout), weighted by sqrt(k / (3n + k)) for n visits and
+  // k = rave_equivalence.
+  bool rave = false;
+  double rave_equivalence = 1000.0;
+  // Transposition table size; entries are 16 bytes, shallow nodes win replacement
+  size_t tt_size_mb = 16;
+};
+
+// What the last search did.
+struct SearchStats {
+  int iterations = 0;        // simulations run
+  int iterationsSaved = 0;   // budget left unused by an early stop (estimated when timed)
+  double secondsSaved = 0.0; // timed searches: time to the target left on the clock
+  int inheritedVisits = 0;   // root visits kept from earlier searches and pondering
+  bool stoppedEarly = false;
+  int playouts = 0;          // simulations valued by a PlayoutEngine rollout
+};
+
+// Compact move stored in tree nodes: point index (y*N+x), colour and pass flag.
+struct NodeMove {
+  int16_t point = -1;
+  uint8_t color = EMPTY;
+  uint8_t pass = 1;
+
+  static NodeMove from(const Board::Move& m, int N){
+    NodeMove n; n.color = static_cast<uint8_t>(m.s); n.pass = m.pass ? 1 : 0;
+    n.point = m.pass ? int16_t(-1) : static_cast<int16_t>(m.y*N + m.x);
+    return n;
+  }
+  Board::Move toMove(int N) const {
+    if(pass) return Board::Move{-1,-1,static_cast<Stone>(color),true,std::string()};
+    return Board::Move{point % N, point / N, static_cast<Stone>(color), false, std::string()};
+  }
+  bool operator==(const NodeMove& o) const { return point==o.point && color==o.color && pass==o.pass; }
 };
 
 class MCTS {
 public:
   explicit MCTS(const MCTSConfig& cfg = MCTSConfig());
+  ~MCTS();
   // returns best move as (x,y), with x=-1,y=-1 meaning pass
   Board::Move run(const Board& root, Stone toPlay);
 private:
@@ -30,51 +102,222 @@ private:
   std::mt19937_64 rng;
   std::mutex rng_mutex; // used to seed per-worker RNGs safely
 
+  // Nodes carry no position: the board for a node is rebuilt by replaying the moves on
+  // the path from `rootState`. Nodes and their edge arrays live in `arena`, so they are
+  // trivially destructible and a whole tree is dropped by resetting the arena.
+  //
+  // Edge i of a node is moves[i]; once expanded (i < numChildren) its statistics live
+  // column-wise in `edges`: segments of 8, 8, 16, 32, ... slots that never move after
+  // allocation, so selection scans contiguous arrays instead of chasing child pointers.
+  //
+  // Statistics are updated without locks: each edge packs visits (low 32 bits) and
+  // virtual loss (high 32 bits) into one atomic word so readers never see a torn pair,
+  // and value sums are fixed-point integers. A node's own visit count is its parent
+  // edge's; the root's lives in `rootVisits`. The node lock only serializes expansion.
+  //
+  // In DAG mode a node may have several parent edges. Each simulation also updates the
+  // node totals of every node on its path (the path is a simple path), so a node's
+  // value covers all its transpositions; edges keep the visits taken through them.
+  static constexpr int kEdgeSegments = 8; // 1024 edges, enough for 25x25 + pass
+  static constexpr double kValueScale = double(1 << 24); // fixed-point value units
+  static constexpr uint64_t kVirtualLossUnit = uint64_t(1) << 32;
+  static constexpr int kExpandEdge = -2; // selectEdge(): expand the best untried move
+  static constexpr size_t kMaxDescend = 8; // moves prepareRoot() follows into the old tree
+  static constexpr size_t kMaxPathLength = 2048; // selection depth cap
   struct Node {
-    Board state;
+    NodeMove moveFromParent; // move that led to this node
     Stone playerToMove; // player who will play at this node
-    Board::Move moveFromParent; // move that led to this node
-    Node* parent = nullptr;
-    std::vector<std::unique_ptr<Node>> children;
-    std::atomic<int> visits{0};
-    double value = 0.0; // total value from perspective of root player
-    std::atomic<int> virtual_loss{0}; // for multi-threading
-    std::vector<Board::Move> untriedMoves;
-    std::mutex node_mutex; // protects `value` and children modification
-
-    Node(const Board& s, Stone p, const Board::Move& mv) : state(s), playerToMove(p), moveFromParent(mv) {}
+    std::atomic<bool> movesGenerated{false}; // edges are generated on the node's first visit
+    std::atomic<bool> evaluating{false};     // evaluator mode: one worker is fetching value and priors
+    std::atomic<uint16_t> numMoves{0};       // moves[0, numChildren) are expanded, the rest untried
+    uint16_t movesCapacity = 0;
+    std::atomic<uint16_t> numChildren{0};    // published after the edge slot is filled
+    std::atomic<float> nextPrior{0.0f};      // PUCT: highest prior among the untried moves
+    uint64_t hash = 0; // Board::situationHash of the node's position
+    Node* parent = nullptr; // the parent it was first expanded from
+    std::atomic<int> visits{0};      // DAG mode: simulations through this node over all parents
+    std::atomic<int64_t> value{0};   // DAG mode: their sum, BLACK's perspective, x kValueScale
+    NodeMove* moves = nullptr;
+    float* priors = nullptr; // normalized policy for moves[i], computed once on the first visit
+    char* edges[kEdgeSegments] = {};
+    SpinLock lock; // held only while expanding
+
+    Node(Stone p, const NodeMove& mv, uint64_t h) : moveFromParent(mv), playerToMove(p), hash(h) {}
+    bool hasUntried() const { return numChildren.load(std::memory_order_acquire) < numMoves.load(std::memory_order_relaxed); }
   };
+  static_assert(std::is_trivially_destructible<Node>::value, "arena nodes are never destroyed");
+
+  // Column view of one edge segment. The edge's prior is node->priors[i].
+  struct EdgeColumns {
+    std::atomic<uint64_t>* stats; // visits | virtual loss << 32
+    std::atomic<int64_t>* value;  // sum of results from BLACK's perspective, x kValueScale
+    std::atomic<uint64_t>* amaf;  // RAVE: visits | BLACK's result sum x kAmafScale << 32
+    Node** child;
+  };
+  static constexpr double kAmafScale = 256.0; // 2^24 AMAF visits per edge before overflow
+  static int visitsOf(uint64_t stats){ return static_cast<int>(static_cast<uint32_t>(stats)); }
+  static int virtualLossOf(uint64_t stats){ return static_cast<int>(stats >> 32); }
+  static size_t segmentCapacity(int seg){ return seg == 0 ? 8 : size_t(4) << seg; }
+  static size_t segmentBytes(int seg){ return segmentCapacity(seg) * (sizeof(uint64_t) + sizeof(int64_t) + sizeof(uint64_t) + sizeof(Node*)); }
+  static EdgeColumns columns(const Node* n, int seg);
+  // Segment and slot holding edge `i`.
+  static int segmentOf(int i, int& slot);
+  struct EdgeRef { EdgeColumns cols; int slot; };
+  static EdgeRef edge(const Node* n, int i){ EdgeRef r; int s = segmentOf(i, r.slot); r.cols = columns(n, s); return r; }
+  Node* rootChild(int i) const { auto e = edge(rootNode, i); return e.cols.child[e.slot]; }
+
+  // Simulations through the root and their value sum (BLACK's perspective, fixed-point),
+  // on their own cache line: every worker bumps them.
+  alignas(64) std::atomic<int> rootVisits{0};
+  std::atomic<int64_t> rootValue{0};
+  char rootVisitsPad[64 - sizeof(std::atomic<int>) - sizeof(std::atomic<int64_t>)];
+
+  // One step of a selection path: the node and the edge taken from it (-1 at the leaf).
+  struct PathStep { Node* node; int edge; };
+
+  // Position and player at `rootNode`.
+  Board rootState{9};
+  Stone rootPlayer = BLACK;
+  // rootState's earlier positions, sorted; workers restore from rootState without its
+  // history and check superko here instead
+  std::vector<uint64_t> rootHistory;
+  NodeArena arena;
+  NodeArena::Cursor mainCursor{arena}; // allocations made outside the workers
+  SearchPool pool; // parked between searches
+  std::atomic<bool> stopRequested{false}; // ends the current search (pondering)
+  std::thread ponderThread;
+  bool rootNoised = false; // Dirichlet noise already mixed into this root's priors
+
+  void resetRoot(const Board& root, Stone toPlay);
+  // Start a search from `root`: keep the current tree when it is already rooted at this
+  // position and player (tree reuse, pondering), first descending through any moves
+  // `root` has played since the tree's root; otherwise start a fresh one. Returns false
+  // when no root node could be allocated.
+  bool prepareRoot(const Board& root, Stone toPlay);
+  // Generate `node`'s edges and their priors (from `policy` when given, else `pv`, or the
+  // built-in heuristic) for `board` on its first visit (caller holds node->lock). Fails
+  // only when the memory budget is exhausted.
+  bool generateMoves(Node* node, const Board& board, NodeArena::Cursor& cursor,
+                     const std::vector<double>* policy = nullptr);
+  // Argmax over `node`'s expanded edges (UCT or PUCT), or -1 when it has none. `visits`
+  // and `q` are the node's own count and value for its player to move. In PUCT mode
+  // returns kExpandEdge when the best untried move outscores every expanded edge.
+  int selectEdge(const Node* node, int visits, double q) const;
+  // Q blended with the edge's AMAF statistics for player `p` (cfg.rave).
+  double raveBlend(double Q, int visits, uint64_t amaf, Stone p) const {
+    int n = visitsOf(amaf);
+    if(n == 0) return Q;
+    double qa = static_cast<double>(amaf >> 32) / (kAmafScale * n);
+    if(p != BLACK) qa = 1.0 - qa;
+    double beta = std::sqrt(cfg.rave_equivalence / (3.0 * visits + cfg.rave_equivalence));
+    return (1.0 - beta) * Q + beta * qa;
+  }
+  // Mean value of `visits` results summing to `sum` (BLACK's perspective, fixed-point)
+  // for player `p`; `fallback` when there are none.
+  static double valueFor(Stone p, int64_t sum, int visits, double fallback){
+    if(visits <= 0) return fallback;
+    double q = static_cast<double>(sum) / (kValueScale * visits);
+    return p == BLACK ? q : 1.0 - q;
+  }
+  // Run simulations from the current root until `iterations` are done or `deadline`
+  // passes (checked after each simulation, so every worker completes at least one).
+  // With cfg.early_stop, the iterations still to come are the rest of `iterations`, or
+  // when timed, the current rate extrapolated to `horizon`. Accumulates into `stats`.
+  void search(int iterations, std::chrono::steady_clock::time_point deadline, int nThreads,
+              std::chrono::steady_clock::time_point horizon = std::chrono::steady_clock::time_point::max());
+  // True when no other root move can overtake the most visited one within `remaining`
+  // more simulations.
+  bool rootDecided(double remaining) const;
+  SearchStats stats;
+  // Most visited root edge (-1 without children); `second` receives the runner-up's visits.
+  int bestRootIndex(int* second = nullptr) const;
+  Board::Move bestRootMove() const;
+  // Mix Dirichlet noise into the root priors (cfg.dirichlet_epsilon > 0).
+  void addRootNoise();
+  // Expansion order among the untried moves [first, end) of `node`.
+  size_t pickUntried(const Node* node, size_t first, size_t end, std::mt19937_64& rng) const;
+  // Return a subtree's memory to the arena and drop its TT entries. In DAG mode nodes
+  // reachable from `live` are kept and shared nodes are recycled once.
+  void recycleSubtree(Node* node, Node* live = nullptr);
+  // Returns false when the board rejects the move (superko in a transposed history).
+  static bool applyMove(Board& b, const NodeMove& m);
 
 public:
   // choose child index at root using UCT (for testing/selection heuristics)
   int chooseChildIndexAtRoot() const;
-  std::unique_ptr<Node> rootNode;
-  // sharded transposition table (stores void* to Node)
-  ShardedTT tt{64};
+  Node* rootNode = nullptr;
+  // lock-free transposition table (stores void* to Node), cfg.tt_size_mb large
+  LockFreeTT tt;
 
   // Parallel search API
   Board::Move runParallel(const Board& root, Stone toPlay, int iterations, int nThreads);
+  // Search until `deadline` instead of for a number of iterations.
+  Board::Move runFor(const Board& root, Stone toPlay, std::chrono::steady_clock::time_point deadline, int nThreads = 1);
+  // Think for the time `tm` budgets for move `moveNumber`: at least the target, and up to
+  // the maximum while the most visited move keeps changing or is not clearly ahead. The
+  // caller charges the time actually used with tm.moveDone().
+  Board::Move runTimed(const Board& root, Stone toPlay, const TimeManager& tm, int moveNumber, int nThreads = 1);
+  const SearchStats& lastSearchStats() const { return stats; }
+  // Worker threads spawned so far; they are reused by every later search
+  [[maybe_unused]] int workerThreads() const { return pool.size(); }
 
   static std::vector<Board::Move> legalMoves(const Board& b, Stone toPlay);
-  double rollout(Board state, Stone player, std::mt19937_64 &rng);
-  [[maybe_unused]] Node* select(Node* node);
-  [[maybe_unused]] Node* expand(Node* node);
-  [[maybe_unused]] static void backpropagate(Node* node, double result);
+  // Random playout to the end from `start`; BLACK's result (1 win, 0 loss). Appends the
+  // moves played to `played` when given. Without a policy net this runs on a thread's
+  // PlayoutEngine (simple ko instead of superko, plain area scoring).
+  // Counts the rollout in `engineRuns` when the PlayoutEngine ran it.
+  double rollout(const Board& start, Stone player, std::mt19937_64 &rng, std::vector<NodeMove>* played = nullptr, int* engineRuns = nullptr);
+  // Descend from `node` by UCT, replaying each chosen move onto `board` (which must hold
+  // `node`'s position) and reserving virtual loss; returns the node to expand, or nullptr
+  // when the chosen move repeats a position on this path and path.back() must be valued
+  // as it is.
+  [[maybe_unused]] Node* select(Node* node, Board& board, std::vector<PathStep>& path, NodeArena::Cursor& cursor);
+  // Add one child for an untried move of the path's leaf, playing it on `board`; returns
+  // the new child (appended to `path`, virtual loss reserved) or the leaf. With an
+  // evaluator, a leaf without moves is returned to the one worker that claims its
+  // evaluation; nullptr tells the others to back off (release the path and select again).
+  [[maybe_unused]] Node* expand(std::vector<PathStep>& path, Board& board, std::mt19937_64& rng, NodeArena::Cursor& cursor);
+  // Undo the virtual loss select() reserved along `path` without counting a visit.
+  [[maybe_unused]] void releasePath(const std::vector<PathStep>& path);
+  // Add `result` along `path`; with cfg.rave also credit AMAF statistics for the path's
+  // and `playout`'s moves.
+  [[maybe_unused]] void backpropagate(const std::vector<PathStep>& path, double result, const std::vector<NodeMove>* playout = nullptr);
+  // Index of the edge UCT selection would take at the root (no side effects), or -1.
+  [[maybe_unused]] int selectRootEdge() const;
 
 
   // New features
 public:
   // After applying a move on the external board, call this to move root to the corresponding child (reuse tree)
   bool moveToChild(const Board::Move &mv);
+  // Search `board` with `toMove` (normally the opponent, after our move) in the
+  // background until stopPondering() or the next search. Play the opponent's reply with
+  // moveToChild(): its subtree and visits carry over to our next search.
+  void startPondering(const Board& board, Stone toMove, int nThreads = 1);
+  void stopPondering();
+  bool pondering() const { return ponderThread.joinable(); }
   // Apply virtual loss to a child at root (for multi-threading); returns false if index invalid
   bool applyVirtualLossToChildIndex(size_t idx, int loss=1);
   bool revertVirtualLossFromChildIndex(size_t idx, int loss=1);
   // Debug helpers
-  uint64_t rootHash() const { return rootNode ? rootNode->state.zobrist() : 0; }
-  int rootChildrenCount() const { return rootNode ? (int)rootNode->children.size() : 0; }
-  [[maybe_unused]] int childVirtualLoss(size_t idx) const { return rootNode && idx<rootNode->children.size() ? rootNode->children[idx]->virtual_loss.load() : -1; }
-  [[maybe_unused]] int childVisits(size_t idx) const { return rootNode && idx<rootNode->children.size() ? rootNode->children[idx]->visits.load() : -1; }
-  // Policy/Value network (optional). Defaults to a simple heuristic PV.
+  uint64_t rootHash() const { return rootNode ? rootState.zobrist() : 0; }
+  int rootChildrenCount() const { return rootNode ? (int)rootNode->numChildren : 0; }
+  int rootVisitCount() const { return rootVisits.load(); }
+  [[maybe_unused]] Board::Move rootMove(size_t idx) const { return rootNode->moves[idx].toMove(rootState.size()); }
+  [[maybe_unused]] int childVirtualLoss(size_t idx) const { if(!rootNode || idx>=rootNode->numChildren) return -1; auto e = edge(rootNode, (int)idx); return virtualLossOf(e.cols.stats[e.slot].load()); }
+  [[maybe_unused]] int childVisits(size_t idx) const { if(!rootNode || idx>=rootNode->numChildren) return -1; auto e = edge(rootNode, (int)idx); return visitsOf(e.cols.stats[e.slot].load()); }
+  [[maybe_unused]] int childAmafVisits(size_t idx) const { if(!rootNode || idx>=rootNode->numChildren) return -1; auto e = edge(rootNode, (int)idx); return visitsOf(e.cols.amaf[e.slot].load()); }
+  [[maybe_unused]] double childPrior(size_t idx) const { if(!rootNode || idx>=rootNode->numChildren) return -1.0; return rootNode->priors[idx]; }
+  // Distinct nodes reachable from the root (a DAG counts shared nodes once)
+  [[maybe_unused]] size_t treeNodes() const;
+  // Arena memory held by the current tree
+  [[maybe_unused]] size_t treeBytes() const { return arena.bytesInUse(); }
+  // Policy/Value network (optional). Without one, priors come from the built-in heuristic
+  // and leaves are valued by PlayoutEngine rollouts.
   std::shared_ptr<PolicyValueNet> pv;
   [[maybe_unused]] void setPV(std::shared_ptr<PolicyValueNet> p) { pv = std::move(p); }
+  // Batched evaluation (optional): leaves are evaluated through `evaluator` instead of
+  // `pv`, so concurrent search threads share network batches.
+  std::shared_ptr<BatchEvaluator> evaluator;
+  [[maybe_unused]] void setEvaluator(std::shared_ptr<BatchEvaluator> e) { evaluator = std::move(e); }
 };
\ No newline at end of file
@@ -1,92 +1,134 @@
 #include "ai/mcts.h"
 #include <algorithm>
+#include <unordered_set>
+
+void MCTS::recycleSubtree(Node* node, Node* live){
+  // a DAG shares nodes: recycle each once, and never one still reachable from `live`
+  std::unordered_set<Node*> seen;
+  if(cfg.dag && live){
+    std::vector<Node*> stack{live};
+    seen.insert(live);
+    while(!stack.empty()){
+      Node* n = stack.back(); stack.pop_back();
+      for(int i=0;i<n->numChildren;++i){ auto e = edge(n, i); if(seen.insert(e.cols.child[e.slot]).second) stack.push_back(e.cols.child[e.slot]); }
+    }
+  }
+  if(cfg.dag && !seen.insert(node).second) return;
+  std::vector<Node*> stack{node};
+  while(!stack.empty()){
+    Node* n = stack.back(); stack.pop_back();
+    for(int i=0;i<n->numChildren;++i){
+      auto e = edge(n, i);
+      if(!cfg.dag || seen.insert(e.cols.child[e.slot]).second) stack.push_back(e.cols.child[e.slot]);
+    }
+    if(tt.get(n->hash) == n) tt.erase(n->hash);
+    arena.recycle(n->moves, n->movesCapacity * sizeof(NodeMove));
+    arena.recycle(n->priors, n->movesCapacity * sizeof(float));
+    for(int seg=0;seg<kEdgeSegments;++seg) arena.recycle(n->edges[seg], segmentBytes(seg));
+    arena.recycle(n, sizeof(Node));
+  }
+}
+
+size_t MCTS::treeNodes() const {
+  if(!rootNode) return 0;
+  std::unordered_set<const Node*> seen{rootNode};
+  std::vector<const Node*> stack{rootNode};
+  while(!stack.empty()){
+    const Node* n = stack.back(); stack.pop_back();
+    for(int i=0;i<n->numChildren;++i){ auto e = edge(n, i); if(seen.insert(e.cols.child[e.slot]).second) stack.push_back(e.cols.child[e.slot]); }
+  }
+  return seen.size();
+}
 
 bool MCTS::moveToChild(const Board::Move &mv){
+  // the tree is about to change under any background search
+  stopPondering();
   if(!rootNode) return false;
   // Try transposition table lookup first: apply move to a temp board and look up its zobrist hash
-  Board tmp = rootNode->state;
+  Board tmp = rootState;
   if(mv.pass) tmp.pass(mv.s);
-  else tmp.place(mv.x, mv.y, mv.s);
+  else if(!tmp.place(mv.x, mv.y, mv.s)) return false;
+  NodeMove key = NodeMove::from(mv, rootState.size());
+  Stone next = mv.s==BLACK ? WHITE : BLACK;
+  // the new root; everything else in the old tree is handed back to the arena
+  Node* keep = nullptr;
+  int keepVisits = 0;
+  int64_t keepValue = 0;
+  int n = rootNode->numChildren.load();
+  auto take = [&](int i){
+    auto e = edge(rootNode, i);
+    keep = e.cols.child[e.slot];
+    // a DAG node's totals include the visits that reached it through transpositions
+    keepVisits = cfg.dag ? keep->visits.load() : visitsOf(e.cols.stats[e.slot].load());
+    keepValue = cfg.dag ? keep->value.load() : e.cols.value[e.slot].load();
+  };
   {
-    uint64_t h = tmp.zobrist();
-    void* v = tt.get(h);
+    void* v = tt.get(tmp.situationHash(next));
     if(v){
-      const Node* found = static_cast<Node*>(v);
       // ensure found is a direct child of rootNode
-      for(size_t i=0;i<rootNode->children.size();++i){
-        if(rootNode->children[i].get() == found){
-          auto newRoot = std::move(rootNode->children[i]);
-          rootNode->children.erase(rootNode->children.begin()+i);
-          newRoot->parent = nullptr;
-          rootNode = std::move(newRoot);
-          return true;
-        }
-      }
+      for(int i=0;i<n;++i) if(rootChild(i) == v) take(i);
     }
   }
 
   // Fallback: match by move fields (older behavior)
-  for(size_t i=0;i<rootNode->children.size();++i){
-    const auto &cptr = rootNode->children[i];
-    if(cptr->moveFromParent.x==mv.x && cptr->moveFromParent.y==mv.y && cptr->moveFromParent.pass==mv.pass && cptr->moveFromParent.s==mv.s){
-      auto newRoot = std::move(rootNode->children[i]);
-      rootNode->children.erase(rootNode->children.begin()+i);
-      newRoot->parent = nullptr;
-      rootNode = std::move(newRoot);
-      return true;
-    }
+  for(int i=0;!keep && i<n;++i){
+    if(rootNode->moves[i] == key) take(i);
   }
-  // If move was not found among expanded children, check untriedMoves at root and expand that move into a new root
-  for(size_t i=0;i<rootNode->untriedMoves.size();++i){
-    auto um = rootNode->untriedMoves[i];
-    if(um.x==mv.x && um.y==mv.y && um.pass==mv.pass && um.s==mv.s){
-      // create new child node for this move
-      Board childState = rootNode->state;
-      if(um.pass) childState.pass(um.s);
-      else childState.place(um.x, um.y, um.s);
-      Stone next = (um.s==BLACK?WHITE:BLACK);
-      auto child = std::make_unique<Node>(childState, next, um);
-      child->untriedMoves = legalMoves(childState, next);
-      child->parent = nullptr;
-      // remove untried move from root
-      rootNode->untriedMoves.erase(rootNode->untriedMoves.begin()+i);
-      rootNode = std::move(child);
-      // register new root in transposition table
-      tt.insert(rootNode->state.zobrist(), static_cast<void*>(rootNode.get()));
-      return true;
-    }
+  Node* old = rootNode;
+  // in a DAG the kept node may be shared with other subtrees of the old root
+  if(cfg.dag) recycleSubtree(old, keep);
+  else {
+    for(int i=0;i<old->numChildren;++i) if(rootChild(i) != keep) recycleSubtree(rootChild(i));
+    old->numChildren = 0;
+    recycleSubtree(old);
   }
-  return false;
+  // Not expanded yet: any move accepted by the board becomes a fresh root (its moves are
+  // generated on first visit)
+  if(!keep) keep = mainCursor.create<Node>(next, key, tmp.situationHash(next));
+  if(!keep){ rootNode = nullptr; return false; }
+  keep->parent = nullptr;
+  rootNode = keep;
+  rootState = std::move(tmp);
+  rootPlayer = rootNode->playerToMove;
+  rootVisits.store(keepVisits);
+  rootValue.store(keepValue);
+  rootNoised = false;
+  // register new root in transposition table
+  tt.insert(rootNode->hash, static_cast<void*>(rootNode), LockFreeTT::kMaxPriority);
+  return true;
 }
 
 bool MCTS::applyVirtualLossToChildIndex(size_t idx, int loss){
-  if(!rootNode || idx>=rootNode->children.size()) return false;
-  rootNode->children[idx]->virtual_loss.fetch_add(loss);
+  if(!rootNode || idx>=rootNode->numChildren) return false;
+  auto e = edge(rootNode, (int)idx);
+  e.cols.stats[e.slot].fetch_add(uint64_t(loss) * kVirtualLossUnit);
   return true;
 }
 
 bool MCTS::revertVirtualLossFromChildIndex(size_t idx, int loss){
-  if(!rootNode || idx>=rootNode->children.size()) return false;
-  int prev = rootNode->children[idx]->virtual_loss.fetch_sub(loss);
-  if(prev - loss < 0) rootNode->children[idx]->virtual_loss.store(0);
+  if(!rootNode || idx>=rootNode->numChildren) return false;
+  auto e = edge(rootNode, (int)idx);
+  uint64_t cur = e.cols.stats[e.slot].load();
+  // clamp at zero virtual loss, keeping the visit count
+  while(!e.cols.stats[e.slot].compare_exchange_weak(cur, cur - uint64_t(std::min(loss, virtualLossOf(cur))) * kVirtualLossUnit)){}
   return true;
 }
 
 int MCTS::chooseChildIndexAtRoot() const{
   if(!rootNode) return -1;
   double best = -1e100; int bi = -1;
-  for(size_t i=0;i<rootNode->children.size();++i){
-    auto c = rootNode->children[i].get();
-    int cvis = c->visits.load();
-    int cvl = c->virtual_loss.load();
-    double Q = (cvis==0)?0.0:(c->value / static_cast<double>(cvis));
+  for(int i=0;i<rootNode->numChildren;++i){
+    auto e = edge(rootNode, i);
+    uint64_t st = e.cols.stats[e.slot].load();
+    int cvis = visitsOf(st);
+    int cvl = virtualLossOf(st);
+    double Q = valueFor(rootPlayer, e.cols.value[e.slot].load(), cvis, 0.0);
     // Amplify virtual-loss effect so it meaningfully penalizes selection at root
     double denom = static_cast<double>(cvis + 1 + cvl * 10);
-    double U = cfg.exploration * std::sqrt(std::log1p(static_cast<double>(rootNode->visits.load())) / denom);
+    double U = cfg.exploration * std::sqrt(std::log1p(static_cast<double>(rootVisits.load())) / denom);
     // penalize by virtual loss to bias selection away from nodes under simulation
     double score = Q + U - static_cast<double>(cvl) * 1.0;
-    (void)0;
-    if(score > best){ best = score; bi = (int)i; }
+    if(score > best){ best = score; bi = i; }
   }
   return bi;
-}
\ No newline at end of file
+}
@@ -0,0 +1,84 @@
+#include "node_arena.h"
+
+#include <cstdlib>
+
+NodeArena::~NodeArena(){ release(); }
+
+int NodeArena::classOf(size_t bytes){
+  if(bytes <= 256) return bytes == 0 ? 0 : static_cast<int>((bytes + 15) / 16 - 1);
+  int c = 16;
+  while(classBytes(c) < bytes) ++c;
+  return c;
+}
+
+size_t NodeArena::bytesReserved() const {
+  std::lock_guard<std::mutex> lk(mutex);
+  return chunks.size() * kChunkBytes;
+}
+
+char* NodeArena::grabChunk(){
+  std::lock_guard<std::mutex> lk(mutex);
+  size_t used = chunksInUse.load(std::memory_order_relaxed);
+  if(budget && (used + 1) * kChunkBytes > budget) return nullptr;
+  if(used == chunks.size()){
+    void* p = ::operator new(kChunkBytes, std::align_val_t(kAlign), std::nothrow);
+    if(!p) return nullptr;
+    chunks.push_back(static_cast<char*>(p));
+  }
+  chunksInUse.store(used + 1, std::memory_order_relaxed);
+  return chunks[used];
+}
+
+void* NodeArena::stealFreeList(int c){
+  if(!haveShared[c].load(std::memory_order_relaxed)) return nullptr;
+  std::lock_guard<std::mutex> lk(mutex);
+  void* head = sharedFree[c];
+  sharedFree[c] = nullptr;
+  haveShared[c].store(false, std::memory_order_relaxed);
+  return head;
+}
+
+void NodeArena::recycle(void* p, size_t bytes){
+  if(!p) return;
+  int c = classOf(bytes);
+  std::lock_guard<std::mutex> lk(mutex);
+  *static_cast<void**>(p) = sharedFree[c];
+  sharedFree[c] = p;
+  haveShared[c].store(true, std::memory_order_relaxed);
+}
+
+void NodeArena::reset(){
+  std::lock_guard<std::mutex> lk(mutex);
+  chunksInUse.store(0, std::memory_order_relaxed);
+  for(int c=0;c<kClasses;++c){ sharedFree[c] = nullptr; haveShared[c].store(false, std::memory_order_relaxed); }
+}
+
+void NodeArena::release(){
+  reset();
+  std::lock_guard<std::mutex> lk(mutex);
+  for(char* c : chunks) ::operator delete(c, std::align_val_t(kAlign));
+  chunks.clear();
+}
+
+void* NodeArena::Cursor::allocate(size_t bytes){
+  int c = classOf(bytes);
+  size_t size = classBytes(c);
+  if(size > kChunkBytes) return nullptr;
+  if(!freeLists[c]) freeLists[c] = arena->stealFreeList(c);
+  if(void* p = freeLists[c]){ freeLists[c] = *static_cast<void**>(p); return p; }
+  if(static_cast<size_t>(end - bump) < size){
+    // the chunk tail is too small for this class; recycle it in the largest fitting pieces
+    while(static_cast<size_t>(end - bump) >= 16){
+      int t = classOf(static_cast<size_t>(end - bump));
+      if(classBytes(t) > static_cast<size_t>(end - bump)) --t;
+      *reinterpret_cast<void**>(bump) = freeLists[t]; freeLists[t] = bump;
+      bump += classBytes(t);
+    }
+    char* chunk = arena->grabChunk();
+    if(!chunk) return nullptr;
+    bump = chunk; end = chunk + kChunkBytes;
+  }
+  void* p = bump;
+  bump += size;
+  return p;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <vector>
+
+// Chunked arena for search trees. Workers allocate through their own Cursor (bump
+// pointer inside a private chunk, plus a private free list per size class), so the hot
+// path takes no lock; only grabbing a fresh chunk or stealing recycled blocks does.
+// Objects placed here must be trivially destructible: `reset()` forgets every
+// allocation in O(1) and keeps the chunks for the next search.
+class NodeArena {
+public:
+  static constexpr size_t kChunkBytes = 256 * 1024;
+  static constexpr size_t kAlign = 16;
+  static constexpr int kClasses = 26; // 16..256 bytes in 16-byte steps, then powers of two
+
+  explicit NodeArena(size_t budgetBytes = 0) : budget(budgetBytes) {}
+  ~NodeArena();
+  NodeArena(const NodeArena&) = delete;
+  NodeArena& operator=(const NodeArena&) = delete;
+
+  // Per-thread allocation handle. Must not outlive the arena or survive a reset().
+  class Cursor {
+  public:
+    explicit Cursor(NodeArena& a) : arena(&a) {}
+    // Returns nullptr once the memory budget is exhausted.
+    void* allocate(size_t bytes);
+    template<class T, class... Args> T* create(Args&&... args){
+      void* p = allocate(sizeof(T));
+      return p ? new(p) T(std::forward<Args>(args)...) : nullptr;
+    }
+    template<class T> T* allocateArray(size_t n){ return static_cast<T*>(allocate(n * sizeof(T))); }
+  private:
+    NodeArena* arena;
+    char* bump = nullptr;
+    char* end = nullptr;
+    void* freeLists[kClasses] = {};
+  };
+
+  // Return a block to the shared free lists; it is handed out again to any cursor.
+  void recycle(void* p, size_t bytes);
+  // Forget every allocation in O(1). Chunks are kept for reuse; outstanding cursors
+  // must be discarded.
+  void reset();
+  // Reset and give the chunks back to the system.
+  void release();
+
+  void setBudget(size_t bytes){ budget = bytes; }
+  size_t budgetBytes() const { return budget; }
+  // Bytes of chunks handed to cursors since the last reset.
+  size_t bytesInUse() const { return chunksInUse.load(std::memory_order_relaxed) * kChunkBytes; }
+  // Bytes of chunks held (in use or cached for reuse).
+  size_t bytesReserved() const;
+
+  static int classOf(size_t bytes);
+  static size_t classBytes(int c){ return c < 16 ? size_t(c + 1) * 16 : size_t(512) << (c - 16); }
+
+private:
+  char* grabChunk();
+  void* stealFreeList(int c);
+
+  size_t budget; // 0 = unlimited
+  mutable std::mutex mutex; // guards chunks and shared free lists
+  std::vector<char*> chunks;
+  std::atomic<size_t> chunksInUse{0};
+  void* sharedFree[kClasses] = {};
+  std::atomic<bool> haveShared[kClasses] = {};
+};
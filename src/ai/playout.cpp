@@ -0,0 +1,256 @@
+#include "playout.h"
+
+#include <algorithm>
+#include <cmath>
+
+bool PlayoutEngine::reset(const Board& b, Sampling sampling){
+  int n = b.size();
+  if(n < 1 || n > kMaxSize) return false;
+  N = n; W = N + 1;
+  weighted = sampling == Sampling::Weighted;
+  int cells = (N + 2) * W + 1;
+  std::fill(colour, colour + cells, kOffBoard);
+  std::fill(head, head + cells, 0);
+  numEmpty = 0;
+  for(int y=0;y<N;++y) for(int x=0;x<N;++x){
+    int cell = cellOf(x, y), p = y * N + x;
+    colour[cell] = EMPTY;
+    pointOf[cell] = static_cast<int16_t>(p);
+    cellOfPoint[p] = static_cast<int16_t>(cell);
+    emptyIdx[cell] = static_cast<int16_t>(numEmpty);
+    emptyList[numEmpty++] = static_cast<int16_t>(cell);
+  }
+  for(int y=0;y<N;++y) for(int x=0;x<N;++x){
+    int cell = cellOf(x, y);
+    uint16_t v = 0;
+    for(int d : {-W, -1, 1, W}) v += uint16_t(1) << (4 * colour[cell + d]);
+    nbr[cell] = v;
+  }
+  if(weighted){
+    if(sizeOfBase != N){
+      double centre = (N - 1) / 2.0;
+      for(int y=0;y<N;++y) for(int x=0;x<N;++x){
+        int cell = cellOf(x, y);
+        base[cell] = static_cast<int32_t>(std::lround(16.0 * (N + 1 - std::hypot(x - centre, y - centre))));
+        rowOf[cell] = static_cast<uint8_t>(y);
+      }
+      sizeOfBase = N;
+    }
+    std::fill(weight, weight + cells, 0);
+    std::fill(stonesNear, stonesNear + cells, 0);
+    std::fill(rowSum, rowSum + N, 0);
+    total = 0;
+    for(int y=0;y<N;++y) for(int x=0;x<N;++x) addWeight(cellOf(x, y), base[cellOf(x, y)]);
+  }
+  clearSink();
+  ko = -1;
+  const std::vector<Stone>& stones = b.cells();
+  for(int p=0;p<N*N;++p) if(stones[p] != EMPTY) place(cellOfPoint[p], stones[p]);
+  ko = b.koPoint() >= 0 ? cellOfPoint[b.koPoint()] : -1;
+  numPlayed = 0;
+  return true;
+}
+
+void PlayoutEngine::removeChain(int h){
+  uint16_t toEmpty = uint16_t(1) - (uint16_t(1) << (4 * colour[h]));
+  int s = h;
+  // the four neighbours are written out: this and place() are the inner loop
+  auto freed = [&](int q){
+    nbr[q] += toEmpty;
+    int hq = head[q];
+    int add = hq != h;
+    libs[hq] += add; libSum[hq] += add * s; libSum2[hq] += add * s * s;
+  };
+  do {
+    colour[s] = EMPTY;
+    emptyIdx[s] = static_cast<int16_t>(numEmpty);
+    emptyList[numEmpty++] = static_cast<int16_t>(s);
+    if(weighted) emptyWeights(s);
+    freed(s - W); freed(s - 1); freed(s + 1); freed(s + W);
+    s = nextStone[s];
+  } while(s != h);
+  do { int next = nextStone[s]; head[s] = 0; s = next; } while(s != h);
+}
+
+void PlayoutEngine::place(int cell, int c){
+  int them = 3 - c;
+  colour[cell] = static_cast<uint8_t>(c);
+  int i = emptyIdx[cell], last = emptyList[--numEmpty];
+  emptyList[i] = static_cast<int16_t>(last);
+  emptyIdx[last] = static_cast<int16_t>(i);
+  if(weighted) stoneWeights(cell);
+  head[cell] = nextStone[cell] = cell;
+  chainSize[cell] = 1;
+  uint16_t fromEmpty = (uint16_t(1) << (4 * c)) - uint16_t(1);
+  int lib = 0, sum = 0, sum2 = 0;
+  int friends[4], nf = 0;
+  auto taken = [&](int q){
+    nbr[q] += fromEmpty;
+    int col = colour[q], hq = head[q];
+    int e = col == EMPTY;
+    lib += e; sum += e * q; sum2 += e * q * q;
+    libs[hq] -= 1; libSum[hq] -= cell; libSum2[hq] -= cell * cell;
+    friends[nf] = hq; nf += col == c;
+  };
+  taken(cell - W); taken(cell - 1); taken(cell + 1); taken(cell + W);
+  libs[cell] = lib; libSum[cell] = sum; libSum2[cell] = sum2;
+  // merge friendly chains into the larger one
+  int h = cell;
+  for(int k=0;k<nf;++k){
+    int a = h, b = head[friends[k]];
+    if(b == h) continue;
+    if(chainSize[a] < chainSize[b]) std::swap(a, b);
+    int s = b;
+    do { head[s] = a; s = nextStone[s]; } while(s != b);
+    std::swap(nextStone[a], nextStone[b]);
+    libs[a] += libs[b]; libSum[a] += libSum[b]; libSum2[a] += libSum2[b];
+    chainSize[a] += chainSize[b];
+    h = a;
+  }
+  auto dead = [&](int q){ return unsigned(colour[q] == them) & unsigned(libs[head[q]] == 0); };
+  unsigned capture = dead(cell - W) | dead(cell - 1) << 1 | dead(cell + 1) << 2 | dead(cell + W) << 3;
+  if(!capture){ ko = -1; return; }
+  const int dirs[4] = {-W, -1, 1, W};
+  int captured = 0, capturedAt = -1;
+  for(int k=0;k<4;++k){
+    int q = cell + dirs[k];
+    // a chain touching the stone twice is gone after the first
+    if(!(capture >> k & 1) || colour[q] != them) continue;
+    captured += chainSize[head[q]];
+    capturedAt = head[q];
+    removeChain(head[q]);
+  }
+  ko = captured == 1 && chainSize[h] == 1 && libs[h] == 1 ? capturedAt : -1;
+}
+
+bool PlayoutEngine::playable(int cell, int c) const {
+  unsigned nb = nbr[cell];
+  // a liberty; the ko point never has one
+  if(nb & 0xF) return true;
+  if(cell == ko) return false;
+  // own eye: every neighbour ours (or off the board) and the diagonals mostly safe
+  unsigned own = (nb >> (4 * c)) & 0xF, off = nb >> 12;
+  if(own + off == 4){
+    int them = 3 - c;
+    int enemy = (colour[cell - W - 1] == them) + (colour[cell - W + 1] == them) +
+                (colour[cell + W - 1] == them) + (colour[cell + W + 1] == them);
+    if(enemy + (off != 0) < 2) return false;
+  }
+  // not suicide: a friend with another liberty, or a capture
+  auto saves = [&](int q){ int col = colour[q]; return col - 1u < 2u && (col == c) != inAtari(head[q]); };
+  return saves(cell - W) || saves(cell - 1) || saves(cell + 1) || saves(cell + W);
+}
+
+void PlayoutEngine::stoneWeights(int cell){
+  addWeight(cell, -weight[cell]);
+  for(int d : {-W - 1, -W, -W + 1, -1, 1, W - 1, W, W + 1}){
+    int q = cell + d;
+    ++stonesNear[q];
+    if(colour[q] == EMPTY) addWeight(q, kNearStone);
+  }
+}
+
+void PlayoutEngine::emptyWeights(int cell){
+  for(int d : {-W - 1, -W, -W + 1, -1, 1, W - 1, W, W + 1}){
+    int q = cell + d;
+    --stonesNear[q];
+    if(colour[q] == EMPTY) addWeight(q, -kNearStone);
+  }
+  addWeight(cell, base[cell] + kNearStone * stonesNear[cell]);
+}
+
+int PlayoutEngine::drawWeighted(int c, Xoshiro256& rng){
+  // an unplayable point drops out of the sums until the move is chosen, so the draw
+  // follows the weights of the playable points
+  int16_t rejected[kPoints];
+  int numRejected = 0, chosen = -1;
+  while(total > 0){
+    int r = static_cast<int>(rng.below(static_cast<uint32_t>(total))), y = 0;
+    while(r >= rowSum[y]) r -= rowSum[y++];
+    int cell = cellOf(0, y);
+    while(r >= weight[cell]) r -= weight[cell++];
+    if(playable(cell, c)){ chosen = cell; break; }
+    rejected[numRejected++] = static_cast<int16_t>(cell);
+    addWeight(cell, -weight[cell]);
+  }
+  for(int k=0;k<numRejected;++k){
+    int cell = rejected[k];
+    addWeight(cell, base[cell] + kNearStone * stonesNear[cell]);
+  }
+  return chosen;
+}
+
+int PlayoutEngine::drawUniform(int c, Xoshiro256& rng){
+  // an unplayable point is swapped behind the candidates, so every playable point is
+  // equally likely
+  for(int n=numEmpty;n>0;--n){
+    int i = static_cast<int>(rng.below(static_cast<uint32_t>(n))), cell = emptyList[i];
+    if(playable(cell, c)) return cell;
+    int last = emptyList[n-1];
+    emptyList[i] = static_cast<int16_t>(last); emptyIdx[last] = static_cast<int16_t>(i);
+    emptyList[n-1] = static_cast<int16_t>(cell); emptyIdx[cell] = static_cast<int16_t>(n-1);
+  }
+  return -1;
+}
+
+double PlayoutEngine::run(Stone toMove, Xoshiro256& rng, int maxMoves, double komi){
+  int c = toMove, passes = 0;
+  numPlayed = 0;
+  clearSink();
+  maxMoves = std::min(maxMoves, kMaxMoves);
+  for(int i=0;i<maxMoves && passes<2;++i){
+    int chosen = weighted ? drawWeighted(c, rng) : drawUniform(c, rng);
+    if(chosen < 0){ ++passes; ko = -1; }
+    else {
+      place(chosen, c);
+      played[numPlayed] = pointOf[chosen];
+      playedBy[numPlayed++] = static_cast<uint8_t>(c);
+      passes = 0;
+    }
+    c = 3 - c;
+  }
+  return (passes == 2 ? finalScore() : areaScore()) > komi ? 1.0 : 0.0;
+}
+
+int PlayoutEngine::finalScore() const {
+  // an empty point next to another is always playable, so none is left after two passes
+  int score = 0;
+  for(int y=0;y<N;++y) for(int x=0;x<N;++x){
+    int cell = cellOf(x, y), col = colour[cell];
+    if(col == BLACK) ++score;
+    else if(col == WHITE) --score;
+    else {
+      unsigned nb = nbr[cell], b = (nb >> 4) & 0xF, w = (nb >> 8) & 0xF;
+      score += (b && !w) - (w && !b);
+    }
+  }
+  return score;
+}
+
+int PlayoutEngine::areaScore() const {
+  int score = 0;
+  uint8_t seen[kCells] = {};
+  int16_t stack[kPoints];
+  for(int y=0;y<N;++y) for(int x=0;x<N;++x){
+    int cell = cellOf(x, y);
+    if(colour[cell] == BLACK){ ++score; continue; }
+    if(colour[cell] == WHITE){ --score; continue; }
+    if(seen[cell]) continue;
+    // flood the empty region, noting which colours border it
+    int size = 0, borders = 0, top = 0;
+    stack[top++] = static_cast<int16_t>(cell);
+    seen[cell] = 1;
+    while(top){
+      int s = stack[--top];
+      ++size;
+      for(int d : {-W, -1, 1, W}){
+        int q = s + d;
+        if(colour[q] == EMPTY){ if(!seen[q]){ seen[q] = 1; stack[top++] = static_cast<int16_t>(q); } }
+        else if(colour[q] != kOffBoard) borders |= colour[q];
+      }
+    }
+    if(borders == BLACK) score += size;
+    else if(borders == WHITE) score -= size;
+  }
+  return score;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include "board.h"
+
+// xoshiro256** (Blackman & Vigna): small, fast and good enough for playouts.
+struct Xoshiro256 {
+  uint64_t s[4];
+  explicit Xoshiro256(uint64_t seed = 1){
+    // splitmix64 spreads any seed over the whole state
+    for(auto& v : s){
+      uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      v = z ^ (z >> 31);
+    }
+  }
+  uint64_t next(){
+    uint64_t r = rotl(s[1] * 5, 7) * 9, t = s[1] << 17;
+    s[2] ^= s[0]; s[3] ^= s[1]; s[1] ^= s[2]; s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return r;
+  }
+  // uniform in [0, n)
+  uint32_t below(uint32_t n){ return static_cast<uint32_t>(((next() >> 32) * n) >> 32); }
+private:
+  static uint64_t rotl(uint64_t x, int k){ return (x << k) | (x >> (64 - k)); }
+};
+
+// Random playouts on a private fixed-size board, without heap allocation. Chains keep
+// pseudo-liberty counts with sums of liberty indices and their squares, which tells
+// atari apart exactly, and every point keeps 4-bit counts of its neighbours by colour.
+// Moves are drawn among the points that are legal, not the ko point and not the mover's
+// own eye, either weighted like MCTS's prior heuristic or uniformly from an incrementally
+// kept list of empty points. Rules: simple ko, no suicide; area scoring.
+class PlayoutEngine {
+public:
+  static constexpr int kMaxSize = 19;
+
+  // Weighted: 16 * (N + 1 - distance to the centre) plus 32 per stone among the eight
+  // neighbours, the prior heuristic in fixed point, kept in per-row and total sums.
+  // Uniform: cheaper, for when rollout speed matters more than their quality.
+  enum class Sampling { Weighted, Uniform };
+
+  // Load `b`. Fails for boards larger than kMaxSize.
+  bool reset(const Board& b, Sampling sampling = Sampling::Weighted);
+  // Play from the loaded position, `toMove` first, until both sides pass or `maxMoves`
+  // moves; BLACK's result under area scoring with `komi` (1 win, 0 loss).
+  double run(Stone toMove, Xoshiro256& rng, int maxMoves, double komi = 6.5);
+  // Black area minus white area (stones plus empty regions bordered by one colour).
+  int areaScore() const;
+
+  // Stones played by the last run(), in order (passes are not recorded).
+  int movesPlayed() const { return numPlayed; }
+  int playedPoint(int i) const { return played[i]; }
+  Stone playedColour(int i) const { return static_cast<Stone>(playedBy[i]); }
+  Stone at(int x, int y) const { return static_cast<Stone>(colour[cellOf(x, y)]); }
+
+private:
+  // rows of N + 1 cells share one off-board column; cell 0 is off the board
+  static constexpr int kCells = (kMaxSize + 2) * (kMaxSize + 1) + 1;
+  static constexpr int kPoints = kMaxSize * kMaxSize;
+  static constexpr int kMaxMoves = 3 * kPoints;
+  static constexpr uint8_t kOffBoard = 3;
+  static constexpr int kNearStone = 32;
+
+  int N = 0, W = 0; // W: row stride
+  int ko = -1; // cell
+  uint8_t colour[kCells];
+  // neighbour counts, 4 bits per colour (EMPTY, BLACK, WHITE, off-board)
+  uint16_t nbr[kCells];
+  // chain head per stone; empty and off-board cells head to cell 0, a sink whose
+  // counters absorb updates meant for non-stones
+  int32_t head[kCells], nextStone[kCells];
+  // per chain, at its head cell
+  int32_t libs[kCells], chainSize[kCells], libSum[kCells], libSum2[kCells];
+  // cell <-> board point
+  int16_t pointOf[kCells], cellOfPoint[kPoints];
+  int16_t emptyList[kPoints], emptyIdx[kCells];
+  int numEmpty = 0;
+  // weighted sampling; weight is zero off the board and on stones
+  bool weighted = true;
+  int sizeOfBase = 0;
+  int32_t weight[kCells], base[kCells], rowSum[kMaxSize], total = 0;
+  uint8_t stonesNear[kCells], rowOf[kCells];
+  int16_t played[kMaxMoves];
+  uint8_t playedBy[kMaxMoves];
+  int numPlayed = 0;
+
+  int cellOf(int x, int y) const { return (y + 1) * W + x + 1; }
+  bool inAtari(int h) const { return int64_t(libs[h]) * libSum2[h] == int64_t(libSum[h]) * libSum[h]; }
+  bool playable(int cell, int c) const;
+  void place(int cell, int c);
+  void removeChain(int h);
+  void clearSink(){ libs[0] = libSum[0] = libSum2[0] = 0; }
+  void addWeight(int cell, int d){ weight[cell] += d; rowSum[rowOf[cell]] += d; total += d; }
+  // weight updates for a stone placed on / removed from `cell`
+  void stoneWeights(int cell);
+  void emptyWeights(int cell);
+  // a playable point for `c`, or -1
+  int drawWeighted(int c, Xoshiro256& rng);
+  int drawUniform(int c, Xoshiro256& rng);
+  // areaScore() once neither side can move: every empty point is then alone
+  int finalScore() const;
+};
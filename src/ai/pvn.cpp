@@ -19,6 +19,16 @@ static double _move_prior_score_local(const Board& b, const Board::Move& mv){
   return center_score + 2.0*adj;
 }
 
+void PolicyValueNet::evaluateBatch(const std::vector<const Board*>& positions,
+                                   const std::vector<const std::vector<Board::Move>*>& legal,
+                                   std::vector<Evaluation>& out){
+  out.resize(positions.size());
+  for(size_t i=0;i<positions.size();++i){
+    out[i].policy = policy(*positions[i], *legal[i]);
+    out[i].value = value(*positions[i]);
+  }
+}
+
 class SimpleHeuristicPV : public PolicyValueNet {
 public:
   std::vector<double> policy(const Board& b, const std::vector<Board::Move>& legal) override {
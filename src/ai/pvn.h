@@ -11,6 +11,15 @@ public:
   virtual std::vector<double> policy(const Board& b, const std::vector<Board::Move>& legal) = 0;
   // returns value in [0,1] from BLACK perspective
   virtual double value(const Board& b) = 0;
+
+  // Policy and value for one position.
+  struct Evaluation { std::vector<double> policy; double value = 0.5; };
+  // Evaluate positions[i] with legal move list legal[i] into out[i] (resized to fit).
+  // The default calls policy() and value() per position; networks override it to run
+  // one forward pass per batch.
+  virtual void evaluateBatch(const std::vector<const Board*>& positions,
+                             const std::vector<const std::vector<Board::Move>*>& legal,
+                             std::vector<Evaluation>& out);
 };
 
 // Simple heuristic PV: uses the same move_prior_score heuristic as fallback
@@ -0,0 +1,141 @@
+#include "pvn_cache.h"
+#include <algorithm>
+#include <mutex>
+
+namespace {
+size_t slotsFor(size_t megabytes, size_t entryBytes){
+  size_t want = std::max<size_t>(1, (megabytes << 20) / entryBytes);
+  size_t n = 1;
+  while(n * 2 <= want) n *= 2;
+  return n;
+}
+
+// Board symmetry `sym`: bit 0 mirrors x, bit 1 mirrors y, bit 2 transposes.
+inline int transform(int x, int y, int N, int sym){
+  if(sym & 1) x = N - 1 - x;
+  if(sym & 2) y = N - 1 - y;
+  if(sym & 4) std::swap(x, y);
+  return y * N + x;
+}
+
+// keeps positions of different board sizes apart
+inline uint64_t sizeKey(int N){ return static_cast<uint64_t>(N) * 0x9e3779b97f4a7c15ULL; }
+}
+
+CachedPolicyValueNet::CachedPolicyValueNet(std::shared_ptr<PolicyValueNet> n, size_t megabytes, bool sym, int maxBoardSize)
+  : net(std::move(n)), symmetric(sym), stride(static_cast<size_t>(std::max(1, maxBoardSize)) * std::max(1, maxBoardSize) + 1),
+    entries(slotsFor(megabytes, sizeof(Entry) + stride * sizeof(float))), policies(entries.size() * stride), mask(entries.size() - 1) {}
+
+CachedPolicyValueNet::Canon CachedPolicyValueNet::canonical(const Board& b, Stone toMove) const {
+  int N = b.size();
+  if(!symmetric) return {b.situationHash(toMove) ^ sizeKey(N), 0};
+  // the board's own keys come from the same deterministically seeded table
+  thread_local std::unique_ptr<Zobrist> keys;
+  thread_local int keysN = 0;
+  thread_local std::vector<Stone> grid;
+  if(!keys || keysN != N){ keys.reset(new Zobrist(N)); keysN = N; }
+  const std::vector<Stone>& cells = b.cells();
+  grid.resize(cells.size());
+  int ko = b.koPoint();
+  Canon best{0, -1};
+  for(int s=0;s<8;++s){
+    for(int y=0;y<N;++y) for(int x=0;x<N;++x) grid[transform(x, y, N, s)] = cells[y * N + x];
+    uint64_t h = keys->hash(grid);
+    if(toMove == WHITE) h ^= keys->sideKey();
+    if(ko >= 0) h ^= keys->koKey(transform(ko % N, ko / N, N, s));
+    if(best.sym < 0 || h < best.key) best = {h, s};
+  }
+  best.key ^= sizeKey(N);
+  return best;
+}
+
+int CachedPolicyValueNet::pointIndex(const Board::Move& m, int N, int sym){
+  return m.pass ? N * N : transform(m.x, m.y, N, sym);
+}
+
+bool CachedPolicyValueNet::lookup(const Canon& c, int N, const std::vector<Board::Move>* legal, std::vector<double>* p, double* v){
+  size_t i = slot(c.key);
+  Entry& e = entries[i];
+  const float* policy = &policies[i * stride];
+  std::lock_guard<SpinLock> lk(e.lock);
+  bool hit = e.key == c.key;
+  if(hit && v){ hit = e.hasValue; if(hit) *v = e.value; }
+  if(hit && p){
+    hit = e.hasPolicy && e.numLegal == legal->size();
+    if(hit){
+      p->resize(legal->size());
+      for(size_t j=0;j<legal->size();++j) (*p)[j] = policy[pointIndex((*legal)[j], N, c.sym)];
+    }
+  }
+  (hit ? hitCount : missCount).fetch_add(1, std::memory_order_relaxed);
+  return hit;
+}
+
+void CachedPolicyValueNet::store(const Canon& c, int N, const std::vector<Board::Move>* legal, const std::vector<double>* p, const double* v){
+  size_t i = slot(c.key);
+  Entry& e = entries[i];
+  float* policy = &policies[i * stride];
+  std::lock_guard<SpinLock> lk(e.lock);
+  if(e.key != c.key){ e.key = c.key; e.hasPolicy = e.hasValue = false; }
+  if(v){ e.value = *v; e.hasValue = true; }
+  // a board too large for the slot keeps only its value
+  if(p && p->size() == legal->size() && static_cast<size_t>(N) * N + 1 <= stride){
+    std::fill(policy, policy + N * N + 1, 0.0f);
+    for(size_t j=0;j<legal->size();++j) policy[pointIndex((*legal)[j], N, c.sym)] = static_cast<float>((*p)[j]);
+    e.numLegal = static_cast<uint16_t>(legal->size());
+    e.hasPolicy = true;
+  }
+}
+
+std::vector<double> CachedPolicyValueNet::policy(const Board& b, const std::vector<Board::Move>& legal){
+  Canon c = canonical(b, legal.empty() ? b.toMove() : legal.front().s);
+  std::vector<double> p;
+  if(lookup(c, b.size(), &legal, &p, nullptr)) return p;
+  p = net->policy(b, legal);
+  store(c, b.size(), &legal, &p, nullptr);
+  return p;
+}
+
+double CachedPolicyValueNet::value(const Board& b){
+  Canon c = canonical(b, b.toMove());
+  double v;
+  if(lookup(c, b.size(), nullptr, nullptr, &v)) return v;
+  v = net->value(b);
+  store(c, b.size(), nullptr, nullptr, &v);
+  return v;
+}
+
+void CachedPolicyValueNet::evaluateBatch(const std::vector<const Board*>& positions,
+                                         const std::vector<const std::vector<Board::Move>*>& legal,
+                                         std::vector<Evaluation>& out){
+  out.resize(positions.size());
+  std::vector<size_t> missing;
+  std::vector<Canon> keys;
+  for(size_t i=0;i<positions.size();++i){
+    const Board& b = *positions[i];
+    Canon c = canonical(b, legal[i]->empty() ? b.toMove() : legal[i]->front().s);
+    if(lookup(c, b.size(), legal[i], &out[i].policy, &out[i].value)) continue;
+    missing.push_back(i);
+    keys.push_back(c);
+  }
+  if(missing.empty()) return;
+  std::vector<const Board*> subPositions;
+  std::vector<const std::vector<Board::Move>*> subLegal;
+  for(size_t i : missing){ subPositions.push_back(positions[i]); subLegal.push_back(legal[i]); }
+  std::vector<Evaluation> subOut;
+  net->evaluateBatch(subPositions, subLegal, subOut);
+  for(size_t j=0;j<missing.size();++j){
+    store(keys[j], subPositions[j]->size(), subLegal[j], &subOut[j].policy, &subOut[j].value);
+    out[missing[j]] = std::move(subOut[j]);
+  }
+}
+
+void CachedPolicyValueNet::clear(){
+  for(Entry& e : entries){
+    std::lock_guard<SpinLock> lk(e.lock);
+    e.key = 0;
+    e.hasPolicy = e.hasValue = false;
+  }
+  hitCount.store(0);
+  missCount.store(0);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "pvn.h"
+#include "spin_lock.h"
+
+// Decorator that memoizes another PolicyValueNet. Results are keyed by the situation
+// hash (stones, side to move, ko) in a direct-mapped table sized once from `megabytes`;
+// a colliding position simply replaces the slot. Each slot holds its policy inline, one
+// float per point of a `maxBoardSize` board plus pass, so the table never grows past its
+// budget; larger boards still have their values cached but not their policies. With
+// `symmetric`, positions are first reduced to the smallest hash over the 8 board
+// symmetries and policies are stored in that canonical frame, so rotated and reflected
+// positions share one entry. Safe to call from any number of search threads.
+class CachedPolicyValueNet : public PolicyValueNet {
+public:
+  CachedPolicyValueNet(std::shared_ptr<PolicyValueNet> net, size_t megabytes = 32, bool symmetric = false, int maxBoardSize = 19);
+
+  std::vector<double> policy(const Board& b, const std::vector<Board::Move>& legal) override;
+  double value(const Board& b) override;
+  // Only the positions missing from the cache are forwarded, as one smaller batch.
+  void evaluateBatch(const std::vector<const Board*>& positions,
+                     const std::vector<const std::vector<Board::Move>*>& legal,
+                     std::vector<Evaluation>& out) override;
+
+  // Forget every entry and reset the counters.
+  void clear();
+  size_t capacity() const { return entries.size(); }
+  // Memory held by the table, all of it allocated by the constructor.
+  size_t bytes() const { return entries.size() * sizeof(Entry) + policies.size() * sizeof(float); }
+  uint64_t hits() const { return hitCount.load(); }
+  uint64_t misses() const { return missCount.load(); }
+  double hitRate() const { uint64_t n = hits() + misses(); return n ? double(hits()) / n : 0.0; }
+
+private:
+  struct Entry {
+    SpinLock lock;
+    uint64_t key = 0;
+    bool hasPolicy = false, hasValue = false;
+    double value = 0.0;
+    uint16_t numLegal = 0;
+  };
+  struct Canon { uint64_t key; int sym; };
+
+  Canon canonical(const Board& b, Stone toMove) const;
+  static int pointIndex(const Board::Move& m, int N, int sym);
+  size_t slot(uint64_t key) const { return key & mask; }
+  bool lookup(const Canon& c, int N, const std::vector<Board::Move>* legal, std::vector<double>* p, double* v);
+  void store(const Canon& c, int N, const std::vector<Board::Move>* legal, const std::vector<double>* p, const double* v);
+
+  std::shared_ptr<PolicyValueNet> net;
+  bool symmetric;
+  size_t stride; // floats per policy slot
+  std::vector<Entry> entries;
+  std::vector<float> policies; // per entry: canonical points, pass last
+  uint64_t mask;
+  std::atomic<uint64_t> hitCount{0}, missCount{0};
+};
@@ -0,0 +1,43 @@
+#include "search_pool.h"
+#include <algorithm>
+
+SearchPool::~SearchPool(){
+  {
+    std::lock_guard<std::mutex> lk(mutex);
+    quit = true;
+  }
+  wake.notify_all();
+  for(auto& t : threads) t.join();
+}
+
+void SearchPool::run(int n, const std::function<void(int)>& fn){
+  n = std::max(1, n);
+  std::unique_lock<std::mutex> lk(mutex);
+  while(size() < n){
+    int index = size();
+    threads.emplace_back([this, index]{ loop(index); });
+  }
+  job = &fn;
+  active = n;
+  pending = n;
+  ++generation;
+  wake.notify_all();
+  done.wait(lk, [this]{ return pending == 0; });
+  job = nullptr;
+}
+
+void SearchPool::loop(int index){
+  uint64_t seen = 0;
+  std::unique_lock<std::mutex> lk(mutex);
+  while(true){
+    // workers beyond this generation's count stay parked
+    wake.wait(lk, [&]{ return quit || (generation != seen && index < active); });
+    if(quit) return;
+    seen = generation;
+    const std::function<void(int)>* fn = job;
+    lk.unlock();
+    (*fn)(index);
+    lk.lock();
+    if(--pending == 0) done.notify_one();
+  }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Long-lived search workers. Threads are spawned once, on first use, and park on a
+// condition variable between searches. Each run() is one generation: it wakes the first
+// `n` workers, calls job(index) on each and returns only after all of them have
+// finished, so the caller can read results without racing with running iterations.
+class SearchPool {
+public:
+  SearchPool() = default;
+  ~SearchPool();
+  SearchPool(const SearchPool&) = delete;
+  SearchPool& operator=(const SearchPool&) = delete;
+
+  // Not reentrant: one generation at a time.
+  void run(int n, const std::function<void(int)>& job);
+  int size() const { return static_cast<int>(threads.size()); }
+  uint64_t generations() const { return generation; }
+
+private:
+  void loop(int index);
+
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  std::condition_variable wake; // a new generation (or shutdown)
+  std::condition_variable done; // the last worker of a generation finished
+  const std::function<void(int)>* job = nullptr;
+  uint64_t generation = 0;
+  int active = 0;  // workers taking part in the current generation
+  int pending = 0; // of those, still running
+  bool quit = false;
+};
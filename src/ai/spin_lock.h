@@ -0,0 +1,19 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+// Test-and-test-and-set lock for short critical sections. Trivially destructible, so
+// it can live inside arena-allocated nodes. Usable with std::lock_guard/unique_lock.
+class SpinLock {
+public:
+  void lock(){
+    while(flag.exchange(true, std::memory_order_acquire)){
+      while(flag.load(std::memory_order_relaxed)) std::this_thread::yield();
+    }
+  }
+  bool try_lock(){ return !flag.load(std::memory_order_relaxed) && !flag.exchange(true, std::memory_order_acquire); }
+  void unlock(){ flag.store(false, std::memory_order_release); }
+private:
+  std::atomic<bool> flag{false};
+};
@@ -0,0 +1,69 @@
+#include "time_manager.h"
+#include <algorithm>
+
+TimeManager::TimeManager(const TimeControl& tc) : tc(tc), left(tc.mainTime) {
+  if(left <= 0) enterOvertime(0.0);
+}
+
+void TimeManager::enterOvertime(double carry){
+  overtime = true;
+  left = tc.periodTime;
+  count = tc.kind == TimeControl::ByoYomi ? tc.periods : tc.kind == TimeControl::Canadian ? tc.stones : 0;
+  if(tc.kind == TimeControl::SuddenDeath) left = 0.0;
+  if(carry > 0) moveDone(carry);
+}
+
+void TimeManager::setTimeLeft(double seconds, int n){
+  overtime = n > 0;
+  left = std::max(0.0, seconds);
+  count = n;
+}
+
+void TimeManager::moveDone(double seconds){
+  if(!overtime){
+    left -= seconds;
+    if(left >= 0) return;
+    // the rest of the move was played on overtime
+    enterOvertime(-left);
+    return;
+  }
+  switch(tc.kind){
+    case TimeControl::ByoYomi:
+      // every full period used up is lost; the next move starts a fresh one
+      while(seconds > tc.periodTime && count > 0){ seconds -= tc.periodTime; --count; }
+      left = count > 0 ? tc.periodTime : 0.0;
+      break;
+    case TimeControl::Canadian:
+      left = std::max(0.0, left - seconds);
+      if(--count <= 0){ left = tc.periodTime; count = tc.stones; }
+      break;
+    case TimeControl::SuddenDeath:
+      left = 0.0;
+      break;
+  }
+}
+
+TimeManager::Budget TimeManager::budget(int moveNumber, int boardSize) const {
+  Budget b{0.0, 0.0};
+  if(!overtime){
+    // our share of the moves a typical game still has to go, never fewer than a handful
+    double movesLeft = std::max(8.0, (0.7 * boardSize * boardSize - moveNumber) / 2.0);
+    double perMove = std::max(0.0, left - lag * movesLeft) / movesLeft;
+    // overtime that is there anyway is spent on every move
+    double extra = 0.0;
+    if(tc.kind == TimeControl::ByoYomi && tc.periods > 0) extra = std::max(0.0, tc.periodTime - 2 * lag);
+    if(tc.kind == TimeControl::Canadian && tc.stones > 0) extra = std::max(0.0, tc.periodTime / tc.stones - 2 * lag);
+    b.target = perMove + 0.5 * extra;
+    b.maximum = std::min(b.target * unstableFactor, std::max(0.0, 0.25 * left - lag) + 0.9 * extra);
+  } else if(tc.kind == TimeControl::ByoYomi){
+    // never risk a period on one move
+    b.maximum = std::max(0.0, left - 2 * lag);
+    b.target = 0.6 * b.maximum;
+  } else if(tc.kind == TimeControl::Canadian && count > 0){
+    double perMove = std::max(0.0, left - lag * count) / count;
+    b.target = perMove;
+    b.maximum = std::min(2.0 * perMove, std::max(0.0, left - lag - 0.5 * perMove * (count - 1)));
+  }
+  b.maximum = std::max(b.maximum, b.target);
+  return b;
+}
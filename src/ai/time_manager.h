@@ -0,0 +1,47 @@
+#pragma once
+
+// Clock handling for timed search: how long to think about the next move given the time
+// control and what is left on the clock.
+struct TimeControl {
+  enum Kind { SuddenDeath, ByoYomi, Canadian };
+  Kind kind = SuddenDeath;
+  double mainTime = 0.0;   // seconds
+  double periodTime = 0.0; // byo-yomi: one period; Canadian: the whole overtime block
+  int periods = 0;         // byo-yomi periods
+  int stones = 0;          // Canadian: moves to play per overtime block
+
+  static TimeControl suddenDeath(double main){ TimeControl t; t.mainTime = main; return t; }
+  static TimeControl byoYomi(double main, double period, int n){ TimeControl t; t.kind = ByoYomi; t.mainTime = main; t.periodTime = period; t.periods = n; return t; }
+  static TimeControl canadian(double main, double block, int n){ TimeControl t; t.kind = Canadian; t.mainTime = main; t.periodTime = block; t.stones = n; return t; }
+};
+
+class TimeManager {
+public:
+  // Thinking time for one move: search until `target`, and keep going up to `maximum`
+  // while the choice is unstable.
+  struct Budget { double target; double maximum; };
+
+  explicit TimeManager(const TimeControl& tc);
+
+  // Synchronise with the game clock (GTP time_left): `seconds` left in the current phase
+  // and `count` byo-yomi periods / Canadian stones left, 0 while in main time.
+  void setTimeLeft(double seconds, int count);
+  // Charge one move's thinking time to the clock.
+  void moveDone(double seconds);
+
+  // `moveNumber` is the number of moves played so far, used to estimate how many are left.
+  Budget budget(int moveNumber, int boardSize) const;
+
+  bool inOvertime() const { return overtime; }
+  double timeLeft() const { return left; }
+  int countLeft() const { return count; }
+
+  double lag = 0.1;           // seconds lost per move to I/O and scheduling
+  double unstableFactor = 3.0; // maximum / target while in main time
+private:
+  TimeControl tc;
+  double left;
+  int count = 0;
+  bool overtime = false;
+  void enterOvertime(double carry);
+};
@@ -0,0 +1,63 @@
+#include "tt_lockfree.h"
+#include <algorithm>
+#include <limits>
+
+LockFreeTT::LockFreeTT(size_t megabytes){
+  size_t want = std::max<size_t>(1, (megabytes << 20) / sizeof(Bucket));
+  numBuckets = 1;
+  while(numBuckets * 2 <= want) numBuckets *= 2;
+  buckets.reset(new Bucket[numBuckets]);
+}
+
+void LockFreeTT::insert(uint64_t key, void* ptr, unsigned priority){
+  priority = std::min(priority, kMaxPriority);
+  unsigned a = age.load(std::memory_order_relaxed) & 0xFF;
+  uint64_t d = pack(ptr, a, priority);
+  Bucket& b = bucketOf(key);
+  // the same key, else a free or stale slot, else the lowest-priority entry
+  Slot* victim = nullptr;
+  int victimScore = std::numeric_limits<int>::max();
+  for(Slot& s : b.slots){
+    uint64_t sd = s.data.load(std::memory_order_relaxed);
+    uint64_t sc = s.check.load(std::memory_order_relaxed);
+    if(sd != 0 && (sc ^ sd) == key){ victim = &s; victimScore = -1; break; }
+    int score = sd == 0 || ageOf(sd) != a ? -1 : static_cast<int>(priorityOf(sd));
+    if(score < victimScore){ victim = &s; victimScore = score; }
+  }
+  // a full bucket keeps its entries when they all matter more
+  if(victimScore > static_cast<int>(priority)) return;
+  victim->data.store(d, std::memory_order_relaxed);
+  victim->check.store(key ^ d, std::memory_order_release);
+}
+
+void* LockFreeTT::get(uint64_t key) const {
+  unsigned a = age.load(std::memory_order_relaxed) & 0xFF;
+  const Bucket& b = bucketOf(key);
+  for(const Slot& s : b.slots){
+    uint64_t sc = s.check.load(std::memory_order_acquire);
+    uint64_t sd = s.data.load(std::memory_order_relaxed);
+    if((sc ^ sd) == key && sd != 0 && ageOf(sd) == a) return pointerOf(sd);
+  }
+  return nullptr;
+}
+
+void LockFreeTT::erase(uint64_t key){
+  Bucket& b = bucketOf(key);
+  for(Slot& s : b.slots){
+    uint64_t sd = s.data.load(std::memory_order_relaxed);
+    if((s.check.load(std::memory_order_relaxed) ^ sd) == key && sd != 0){
+      s.data.store(0, std::memory_order_relaxed);
+      s.check.store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+void LockFreeTT::clear(){
+  unsigned next = (age.load(std::memory_order_relaxed) + 1) & 0xFF;
+  // after 255 clears the age comes round again: wipe for real
+  if(next == 0){
+    for(size_t i=0;i<numBuckets;++i) for(Slot& s : buckets[i].slots){ s.data.store(0, std::memory_order_relaxed); s.check.store(0, std::memory_order_relaxed); }
+    next = 1;
+  }
+  age.store(next, std::memory_order_relaxed);
+}
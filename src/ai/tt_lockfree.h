@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Fixed-size transposition table with lock-free probing. Buckets of four 16-byte slots
+// fill one cache line; a key maps to one bucket. Each slot stores `data` (pointer, age,
+// priority) and `check` = key ^ data, written with two plain atomic stores: a reader
+// that sees a torn pair fails the check and treats it as a miss, so entries are lost
+// under contention but never mixed up. When a bucket is full the lowest-priority entry
+// is replaced (MCTS passes a priority that falls with depth). clear() ages the table in
+// O(1); stale entries read as empty.
+//
+// Pointers must fit in 48 bits (user space on x86-64/AArch64).
+class LockFreeTT {
+public:
+  explicit LockFreeTT(size_t megabytes = 16);
+
+  void insert(uint64_t key, void* ptr, unsigned priority = 0);
+  void* get(uint64_t key) const;
+  // Drop `key`'s entry if present.
+  void erase(uint64_t key);
+  void clear();
+
+  size_t capacity() const { return numBuckets * kWays; }
+  size_t bytes() const { return numBuckets * sizeof(Bucket); }
+
+  static constexpr unsigned kMaxPriority = 255;
+private:
+  static constexpr int kWays = 4;
+  struct Slot { std::atomic<uint64_t> check{0}; std::atomic<uint64_t> data{0}; };
+  struct alignas(64) Bucket { Slot slots[kWays]; };
+
+  // data: pointer (low 48 bits) | age << 48 | priority << 56
+  static uint64_t pack(void* p, unsigned age, unsigned prio){
+    return reinterpret_cast<uint64_t>(p) | (uint64_t(age & 0xFF) << 48) | (uint64_t(prio) << 56);
+  }
+  static void* pointerOf(uint64_t d){ return reinterpret_cast<void*>(d & ((uint64_t(1) << 48) - 1)); }
+  static unsigned ageOf(uint64_t d){ return unsigned(d >> 48) & 0xFF; }
+  static unsigned priorityOf(uint64_t d){ return unsigned(d >> 56); }
+  Bucket& bucketOf(uint64_t key) const { return buckets[(key ^ (key >> 29)) & (numBuckets - 1)]; }
+
+  std::unique_ptr<Bucket[]> buckets;
+  size_t numBuckets;
+  std::atomic<unsigned> age{1};
+};
@@ -18,4 +18,68 @@ static void BM_MCTS_Parallel(benchmark::State& state) {
 }
 
 BENCHMARK(BM_MCTS_Parallel)->Args({1,200})->Args({2,400})->Args({4,800})->Args({8,1600});
+
+// Thread scaling: a fixed 8000-iteration search on 1..16 threads (wall clock).
+static void BM_MCTS_Scaling(benchmark::State& state) {
+  int threads = state.range(0);
+  const int iterations = 8000;
+  Board b(9);
+  b.place(4,4,BLACK);
+  b.place(3,4,WHITE);
+  b.place(5,4,WHITE);
+  MCTS m;
+  for (auto _ : state) {
+    auto mv = m.runParallel(b, BLACK, iterations, threads);
+    benchmark::DoNotOptimize(mv);
+  }
+  state.SetItemsProcessed(state.iterations() * iterations);
+}
+
+BENCHMARK(BM_MCTS_Scaling)->RangeMultiplier(2)->Range(1, 16)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// Selection argmax on a fully expanded 19x19 root (362 edges).
+static void BM_SelectWideRoot(benchmark::State& state) {
+  Board b(19);
+  MCTSConfig cfg; cfg.pw_k = 1e6; // expand every root move before descending
+  MCTS m(cfg);
+  m.runParallel(b, BLACK, 2000, 1);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(m.selectRootEdge());
+  }
+  state.counters["edges"] = m.rootChildrenCount();
+  state.SetItemsProcessed(state.iterations() * m.rootChildrenCount());
+}
+
+BENCHMARK(BM_SelectWideRoot);
+
+// Stand-in for a network on an accelerator: a fixed cost per forward pass plus a small
+// cost per position, so throughput depends on how full the batches are.
+namespace {
+struct FixedOverheadPV : PolicyValueNet {
+  std::vector<double> policy(const Board&, const std::vector<Board::Move>& legal) override { return std::vector<double>(legal.size(), 1.0); }
+  double value(const Board&) override { return 0.5; }
+  void evaluateBatch(const std::vector<const Board*>& positions,
+                     const std::vector<const std::vector<Board::Move>*>& legal,
+                     std::vector<Evaluation>& out) override {
+    std::this_thread::sleep_for(std::chrono::microseconds(200 + 5 * positions.size()));
+    PolicyValueNet::evaluateBatch(positions, legal, out);
+  }
+};
+}
+
+// 8 search threads feeding one evaluator; args: batch size.
+static void BM_BatchedLeafEval(benchmark::State& state) {
+  auto ev = std::make_shared<BatchEvaluator>(std::make_shared<FixedOverheadPV>(), state.range(0), std::chrono::microseconds(500));
+  Board b(9);
+  MCTSConfig cfg;
+  MCTS m(cfg);
+  m.setEvaluator(ev);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(m.runParallel(b, BLACK, 400, 8));
+  }
+  state.SetItemsProcessed(state.iterations() * 400);
+  state.counters["avg_batch"] = ev->averageBatch();
+}
+
+BENCHMARK(BM_BatchedLeafEval)->RangeMultiplier(2)->Range(1, 16)->UseRealTime()->Unit(benchmark::kMillisecond);
 BENCHMARK_MAIN();
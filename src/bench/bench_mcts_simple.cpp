@@ -19,6 +19,23 @@ void run_case(int threads, int iterations) {
   std::cout << "threads=" << threads << " iterations=" << iterations << " time_ms=" << ms << "\n";
 }
 
+// Self-play opening with one tree: share of each search's root visits inherited from
+// the previous move.
+void run_reuse(int moves, int iterations) {
+  Board b(9);
+  MCTSConfig cfg; cfg.playout_depth = 50;
+  MCTS m(cfg);
+  Stone s = BLACK;
+  double inherited = 0.0;
+  for (int i = 0; i < moves; ++i) {
+    auto mv = m.runParallel(b, s, iterations, 1);
+    inherited += double(m.lastSearchStats().inheritedVisits) / m.rootVisitCount();
+    if (mv.pass) b.pass(s); else b.place(mv.x, mv.y, s);
+    s = (s == BLACK ? WHITE : BLACK);
+  }
+  std::cout << "reuse moves=" << moves << " iterations=" << iterations << " inherited_pct=" << 100.0 * inherited / moves << "\n";
+}
+
 int main(int argc, char** argv) {
   if (argc == 3) {
     int threads = std::stoi(argv[1]);
@@ -31,5 +48,7 @@ int main(int argc, char** argv) {
   run_case(2, 400);
   run_case(4, 800);
   run_case(8, 1600);
+  run_case(16, 3200);
+  run_reuse(20, 800);
   return 0;
 }
@@ -0,0 +1,104 @@
+#include <benchmark/benchmark.h>
+#include "board.h"
+#include "ai/conv_net.h"
+#include "ai/feature_encoder.h"
+#include "ai/gemm.h"
+#include "ai/mcts.h"
+
+// Forward passes of a 32-channel, 4-block network; args: batch size, board size,
+// int8 (1) or float32 (0).
+static void BM_ConvForward(benchmark::State& state) {
+  int batch = state.range(0), N = state.range(1);
+  bool int8 = state.range(2) != 0;
+  ConvPolicyValueNet net;
+  net.randomize(1);
+  std::vector<Board> boards;
+  for(int i=0;i<batch;++i){
+    Board b(N);
+    b.place(i % N, (i / N) % N, BLACK);
+    boards.push_back(b);
+  }
+  std::vector<const Board*> positions;
+  std::vector<std::vector<Board::Move>> moves;
+  for(auto& b : boards){ positions.push_back(&b); moves.push_back(MCTS::legalMoves(b, WHITE)); }
+  std::vector<const std::vector<Board::Move>*> legal;
+  for(auto& m : moves) legal.push_back(&m);
+  if(int8){
+    net.calibrate(positions);
+    net.setPrecision(ConvPolicyValueNet::Precision::Int8);
+  }
+  std::vector<PolicyValueNet::Evaluation> out;
+  for (auto _ : state) {
+    net.evaluateBatch(positions, legal, out);
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * batch);
+  state.counters["avx2"] = sgemmUsesAvx2();
+  state.SetLabel(int8 ? igemmKernel() : "float32");
+}
+
+BENCHMARK(BM_ConvForward)->ArgsProduct({{1, 4, 16, 64}, {9, 19}, {0, 1}})->Unit(benchmark::kMillisecond);
+
+static void BM_Sgemm(benchmark::State& state) {
+  int M = 32, K = 288, N = state.range(0);
+  std::vector<float> A(M * K, 0.5f), B(K * N, 0.25f), C(M * N);
+  for (auto _ : state) {
+    sgemm(M, N, K, A.data(), B.data(), C.data());
+    benchmark::DoNotOptimize(C.data());
+  }
+  state.counters["GFLOPS"] = benchmark::Counter(2.0 * M * N * K * state.iterations(), benchmark::Counter::kIsRate, benchmark::Counter::kIs1000);
+}
+
+BENCHMARK(BM_Sgemm)->Arg(81)->Arg(361)->Arg(16 * 81)->Arg(16 * 361);
+// A 19x19 game of 200 random legal moves, with the board after each one.
+struct RecordedGame {
+  std::vector<Board::Move> moves;
+  std::vector<Board> after;
+  RecordedGame() {
+    Board b(19);
+    uint64_t r = 12345;
+    Stone s = BLACK;
+    while(moves.size() < 200){
+      r = r * 6364136223846793005ULL + 1442695040888963407ULL;
+      int x = (r >> 33) % 19, y = (r >> 45) % 19;
+      if(b.get(x, y) != EMPTY || !b.place(x, y, s)) continue;
+      moves.push_back({x, y, s, false, std::string()});
+      after.push_back(b);
+      s = s == BLACK ? WHITE : BLACK;
+    }
+  }
+};
+
+// Feature planes for every position of a game, updated move by move vs re-encoded.
+static void BM_EncodeIncremental(benchmark::State& state) {
+  static RecordedGame g;
+  std::vector<float> out(FeatureEncoder::kPlanes * 361);
+  FeatureEncoder fe;
+  for (auto _ : state) {
+    fe.reset(Board(19));
+    for(size_t i=0;i<g.moves.size();++i){
+      fe.play(g.after[i], g.moves[i]);
+      fe.write(g.after[i].toMove(), out.data());
+      benchmark::DoNotOptimize(out.data());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * g.moves.size());
+}
+
+static void BM_EncodeRebuild(benchmark::State& state) {
+  static RecordedGame g;
+  std::vector<float> out(FeatureEncoder::kPlanes * 361);
+  FeatureEncoder fe;
+  for (auto _ : state) {
+    for(size_t i=0;i<g.moves.size();++i){
+      fe.reset(g.after[i]);
+      fe.write(g.after[i].toMove(), out.data());
+      benchmark::DoNotOptimize(out.data());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * g.moves.size());
+}
+
+BENCHMARK(BM_EncodeIncremental);
+BENCHMARK(BM_EncodeRebuild);
+BENCHMARK_MAIN();
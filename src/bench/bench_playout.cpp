@@ -0,0 +1,38 @@
+#include <benchmark/benchmark.h>
+#include "board.h"
+#include "ai/mcts.h"
+#include "ai/playout.h"
+
+// Complete playouts from the empty board on the allocation-free engine; args: board size,
+// uniform sampling (0 = weighted by the prior heuristic).
+static void BM_Playout(benchmark::State& state) {
+  int N = state.range(0);
+  auto sampling = state.range(1) ? PlayoutEngine::Sampling::Uniform : PlayoutEngine::Sampling::Weighted;
+  Board empty(N);
+  PlayoutEngine engine;
+  Xoshiro256 rng(1);
+  int64_t moves = 0;
+  for (auto _ : state) {
+    engine.reset(empty, sampling);
+    benchmark::DoNotOptimize(engine.run(BLACK, rng, 3 * N * N));
+    moves += engine.movesPlayed();
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["moves"] = benchmark::Counter(double(moves) / state.iterations());
+}
+
+// Playouts as the search runs them without a net: MCTS::rollout at the default depth.
+static void BM_SearchRollout(benchmark::State& state) {
+  int N = state.range(0);
+  MCTS m;
+  m.setPV(nullptr);
+  Board empty(N);
+  std::mt19937_64 rng(1);
+  for (auto _ : state) benchmark::DoNotOptimize(m.rollout(empty, BLACK, rng));
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_Playout)->Args({9, 0})->Args({9, 1})->Args({13, 0})->Args({13, 1})->Args({19, 0})->Args({19, 1});
+BENCHMARK(BM_SearchRollout)->Arg(9)->Arg(19);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,46 @@
+// Strength versus playouts: RAVE against plain UCT on 9x9 at equal playouts per move,
+// both driven by random rollouts. Usage: bench_rave [games] [playouts...]
+#include <iostream>
+#include <string>
+#include <vector>
+#include "board.h"
+#include "rules.h"
+#include "ai/mcts.h"
+
+// Plays one game; returns true when the RAVE engine wins.
+static bool play_game(int playouts, bool raveIsBlack, uint64_t seed) {
+  const int N = 9;
+  MCTSConfig plainCfg; plainCfg.playout_depth = 100;
+  MCTSConfig raveCfg = plainCfg; raveCfg.rave = true;
+  MCTS black(raveIsBlack ? raveCfg : plainCfg), white(raveIsBlack ? plainCfg : raveCfg);
+  black.setPV(nullptr); white.setPV(nullptr);
+  // vary the games: open with a seeded random black stone
+  Board b(N);
+  b.place(int(seed % N), int((seed / N) % N), BLACK);
+  Stone s = WHITE;
+  int passes = 0;
+  for (int mv = 0; mv < 2 * N * N && passes < 2; ++mv) {
+    MCTS& engine = s == BLACK ? black : white;
+    auto m = engine.runParallel(b, s, playouts, 1);
+    if (m.pass || !b.place(m.x, m.y, s)) { b.pass(s); ++passes; }
+    else passes = 0;
+    s = (s == BLACK ? WHITE : BLACK);
+  }
+  auto sc = Scorer::score(b, Ruleset::Chinese, 6.5);
+  bool blackWins = sc.first > sc.second;
+  return blackWins == raveIsBlack;
+}
+
+int main(int argc, char** argv) {
+  int games = argc > 1 ? std::stoi(argv[1]) : 8;
+  std::vector<int> playouts;
+  for (int i = 2; i < argc; ++i) playouts.push_back(std::stoi(argv[i]));
+  if (playouts.empty()) playouts = {64, 128, 256};
+  for (int p : playouts) {
+    int wins = 0;
+    for (int g = 0; g < games; ++g) wins += play_game(p, g % 2 == 0, 0x9E37u * (g + 1)) ? 1 : 0;
+    std::cout << "playouts=" << p << " games=" << games << " rave_wins=" << wins
+              << " rave_win_pct=" << 100.0 * wins / games << "\n";
+  }
+  return 0;
+}
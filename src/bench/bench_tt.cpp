@@ -0,0 +1,48 @@
+// Transposition table contention: ShardedTT (mutex per shard) against LockFreeTT
+// under the MCTS access mix, one lookup per expansion check plus an insert per expansion.
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include "ai/tt_sharded.h"
+#include "ai/tt_lockfree.h"
+
+namespace {
+constexpr uint64_t kKeys = 1 << 20;
+
+inline uint64_t nextKey(uint64_t& x){
+  x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+  return ((x >> 17) % kKeys + 1) * 0x9E3779B97F4A7C15ULL;
+}
+inline void* valueFor(uint64_t k){ return reinterpret_cast<void*>(uintptr_t(k & 0xFFFFFFFFFFF0ULL)); }
+
+ShardedTT* sharded = nullptr;
+LockFreeTT* lockFree = nullptr;
+}
+
+static void BM_ShardedTT(benchmark::State& state){
+  if(state.thread_index() == 0) sharded = new ShardedTT(64);
+  uint64_t x = 0x9E37 + state.thread_index();
+  for(auto _ : state){
+    uint64_t k = nextKey(x);
+    // 3 lookups per insert
+    if((x & 3) == 0) sharded->insert(k, valueFor(k));
+    else benchmark::DoNotOptimize(sharded->get(k));
+  }
+  state.SetItemsProcessed(state.iterations());
+  if(state.thread_index() == 0){ delete sharded; sharded = nullptr; }
+}
+BENCHMARK(BM_ShardedTT)->ThreadRange(1, 32)->UseRealTime();
+
+static void BM_LockFreeTT(benchmark::State& state){
+  if(state.thread_index() == 0) lockFree = new LockFreeTT(64);
+  uint64_t x = 0x9E37 + state.thread_index();
+  for(auto _ : state){
+    uint64_t k = nextKey(x);
+    if((x & 3) == 0) lockFree->insert(k, valueFor(k), unsigned(k >> 56));
+    else benchmark::DoNotOptimize(lockFree->get(k));
+  }
+  state.SetItemsProcessed(state.iterations());
+  if(state.thread_index() == 0){ delete lockFree; lockFree = nullptr; }
+}
+BENCHMARK(BM_LockFreeTT)->ThreadRange(1, 32)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Portable bit helpers for bitmap scans (GCC/Clang builtins, MSVC intrinsics).
+inline int lowestBit(uint64_t v){
+#ifdef _MSC_VER
+  unsigned long i; _BitScanForward64(&i, v); return static_cast<int>(i);
+#else
+  return __builtin_ctzll(v);
+#endif
+}
+
+inline int popCount(uint64_t v){
+#ifdef _MSC_VER
+  return static_cast<int>(__popcnt64(v));
+#else
+  return __builtin_popcountll(v);
+#endif
+}
+
+inline int highestBit(uint64_t v){
+#ifdef _MSC_VER
+  unsigned long i; _BitScanReverse64(&i, v); return static_cast<int>(i);
+#else
+  return 63 - __builtin_clzll(v);
+#endif
+}
+
+// Hint the cache that `p` is about to be read.
+inline void prefetchRead(const void* p){
+#ifdef _MSC_VER
+  _mm_prefetch(static_cast<const char*>(p), _MM_HINT_T0);
+#else
+  __builtin_prefetch(p, 0, 3);
+#endif
+}
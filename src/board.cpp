@@ -99,6 +99,7 @@ void Board::removeGroup(int x,int y, Stone color){
 
   // Check and remove enemy groups with no liberties on tmp
   const int dx[4] = {1,-1,0,0}, dy[4] = {0,0,1,-1};
+  int captured = 0, lastCaptured = -1;
   for(int i=0;i<4;i++){
     int nx=x+dx[i], ny=y+dy[i];
     if(!inside(nx,ny)) continue;
@@ -107,6 +108,8 @@ void Board::removeGroup(int x,int y, Stone color){
       if(!hasLibertyInGrid(nx,ny,tmp)){
         auto gang = collectGroupInGrid(nx,ny,tmp);
         for(int p : gang) tmp[p] = EMPTY;
+        captured += static_cast<int>(gang.size());
+        lastCaptured = nid;
       }
     }
   }
@@ -116,13 +119,29 @@ void Board::removeGroup(int x,int y, Stone color){
 
   // Check superko (hash exists previously)
   uint64_t newHash = zobristTable.hash(tmp);
-  if (std::any_of(hashHistory.begin(), hashHistory.end(), [newHash](uint64_t h){ return h==newHash; })) return false;
+  if (seenBefore(newHash)) return false;
+
+  // Simple ko: a lone stone captured exactly one stone and its only liberty is that point
+  ko = -1;
+  if(captured == 1){
+    int libs = 0; bool alone = true;
+    for(int i=0;i<4;i++){
+      int nx=x+dx[i], ny=y+dy[i];
+      if(!inside(nx,ny)) continue;
+      Stone c = tmp[idx(nx,ny)];
+      if(c==EMPTY) libs++;
+      else if(c==s) alone = false;
+    }
+    if(alone && libs==1) ko = lastCaptured;
+  }
+  (s==BLACK ? capturesBlack : capturesWhite) += captured;
 
   // Accept move: apply tmp to real grid
   grid.swap(tmp);
   currentHash = newHash;
   hashHistory.push_back(currentHash);
   recordMove(x,y,s,false);
+  sideToMove = s==BLACK ? WHITE : BLACK;
   return true;
 }
 
@@ -193,7 +212,7 @@ void Board::removeGroup(int x,int y, Stone color){
 
   // Check superko (hash exists previously)
   uint64_t newHash = zobristTable.hash(tmp);
-  if (std::any_of(hashHistory.begin(), hashHistory.end(), [newHash](uint64_t h){ return h==newHash; })) return false;
+  if (seenBefore(newHash)) return false;
   return true;
 }
 
@@ -205,6 +224,37 @@ void Board::removeGroup(int x,int y, Stone color){
 }
 
 // public helper implementations
+void Board::setPosition(const std::vector<Stone>& g, Stone toMove, int koPoint, int capturedByBlack, int capturedByWhite){
+  grid = g;
+  grid.resize(N*N, EMPTY);
+  currentHash = zobristTable.hash(grid);
+  hashHistory.assign(1, currentHash);
+  sharedHistory = nullptr;
+  moveHistory.clear();
+  sideToMove = toMove;
+  ko = koPoint;
+  capturesBlack = capturedByBlack;
+  capturesWhite = capturedByWhite;
+}
+
+void Board::restore(const Board& from, const std::vector<uint64_t>* seen){
+  if(N != from.N){ N = from.N; zobristTable = from.zobristTable; }
+  grid.assign(from.grid.begin(), from.grid.end());
+  capturesBlack = from.capturesBlack;
+  capturesWhite = from.capturesWhite;
+  ko = from.ko;
+  sideToMove = from.sideToMove;
+  currentHash = from.currentHash;
+  hashHistory.assign(1, currentHash);
+  sharedHistory = seen;
+  moveHistory.clear();
+}
+
+bool Board::seenBefore(uint64_t h) const {
+  if(std::find(hashHistory.begin(), hashHistory.end(), h) != hashHistory.end()) return true;
+  return sharedHistory && std::binary_search(sharedHistory->begin(), sharedHistory->end(), h);
+}
+
 void Board::appendMove(int x,int y, Stone s, bool pass, const std::string &comment){
   moveHistory.push_back({x,y,s,pass,comment});
 }
@@ -17,7 +17,27 @@ public:
   [[maybe_unused]] Stone get(int x,int y) const { return grid[idx(x,y)]; }
   [[maybe_unused]] int size() const { return N; }
   [[maybe_unused]] uint64_t zobrist() const { return currentHash; }
+  // stones plus `toMove` and the ko point: equal situations have the same legal moves
+  // (up to superko) and can share search statistics
+  [[maybe_unused]] uint64_t situationHash(Stone toMove) const {
+    return currentHash ^ (toMove == WHITE ? zobristTable.sideKey() : 0) ^ (ko >= 0 ? zobristTable.koKey(ko) : 0);
+  }
   [[maybe_unused]] const std::vector<uint64_t>& history() const { return hashHistory; }
+  // raw row-major grid, for bulk conversions
+  [[maybe_unused]] const std::vector<Stone>& cells() const { return grid; }
+  // stones captured by `s` so far
+  [[maybe_unused]] int captures(Stone s) const { return s==BLACK ? capturesBlack : s==WHITE ? capturesWhite : 0; }
+  // point (idx) the opponent may not retake immediately after a single-stone ko capture, or -1
+  [[maybe_unused]] int koPoint() const { return ko; }
+  // colour expected to move next (alternates after each place/pass)
+  [[maybe_unused]] Stone toMove() const { return sideToMove; }
+  // load a position wholesale; resets hash and move history to this position
+  void setPosition(const std::vector<Stone>& g, Stone toMove, int koPoint = -1, int capturedByBlack = 0, int capturedByWhite = 0);
+  // scratch copy for search: `from`'s stones, captures, ko, side to move and hash, but
+  // not its move or hash history, reusing this board's storage. Superko also checks
+  // `seen` (sorted position hashes, left unowned and unchanged) besides positions
+  // played after the restore.
+  void restore(const Board& from, const std::vector<uint64_t>* seen);
 
   struct Move { int x; int y; Stone s; bool pass; std::string comment; };
   [[maybe_unused]] const std::vector<Move>& moves() const { return moveHistory; }
@@ -32,14 +52,19 @@ public:
 private:
   int N;
   std::vector<Stone> grid;
+  int capturesBlack{0}, capturesWhite{0};
+  int ko{-1};
+  Stone sideToMove{BLACK};
   [[maybe_unused]] bool hasLibertyDFS(int x, int y, std::vector<char>& visited) const;
   [[maybe_unused]] void removeGroup(int x, int y, Stone color);
   // Zobrist hashing & history for superko
   uint64_t currentHash{0};
   std::vector<uint64_t> hashHistory;
+  const std::vector<uint64_t>* sharedHistory{nullptr}; // see restore()
+  bool seenBefore(uint64_t h) const;
   Zobrist zobristTable;
   // Move history for SGF roundtrips
   std::vector<Move> moveHistory;
   void recordMove(int x,int y, Stone s, bool pass=false){ moveHistory.push_back({x,y,s,pass, std::string()}); }
-  void recordPass(Stone s){ moveHistory.push_back({-1,-1,s,true, std::string()}); hashHistory.push_back(currentHash); }
+  void recordPass(Stone s){ moveHistory.push_back({-1,-1,s,true, std::string()}); hashHistory.push_back(currentHash); ko = -1; sideToMove = s==BLACK ? WHITE : BLACK; }
 };
\ No newline at end of file
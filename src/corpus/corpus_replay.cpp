@@ -0,0 +1,82 @@
+#include "corpus_replay.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace Corpus {
+
+SourceFn fileSource(const std::vector<std::string>& paths){
+  return [paths](uint32_t id, std::string& sgf){
+    if(id >= paths.size()) return false;
+    std::ifstream in(paths[id], std::ios::binary);
+    if(!in) return false;
+    std::ostringstream ss; ss << in.rdbuf();
+    sgf = ss.str();
+    return true;
+  };
+}
+
+SourceFn stringSource(const std::vector<std::string>& sgfs){
+  return [sgfs](uint32_t id, std::string& sgf){
+    if(id >= sgfs.size()) return false;
+    sgf = sgfs[id];
+    return true;
+  };
+}
+
+unsigned resolveThreads(unsigned threads){
+  if(threads > 0) return threads;
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+ReplayStats replayCorpus(uint32_t gameCount, const SourceFn& source, const std::vector<IndexSink*>& sinks, unsigned threads){
+  unsigned workers = std::min<unsigned>(resolveThreads(threads), std::max<uint32_t>(1, gameCount));
+  for(auto *s : sinks) s->begin(gameCount, workers);
+
+  std::atomic<uint32_t> next{0};
+  std::atomic<uint32_t> parsed{0}, failed{0};
+  std::atomic<uint64_t> positions{0};
+  // Games vary wildly in cost, so hand them out in small batches rather than static ranges.
+  const uint32_t batch = 16;
+
+  auto work = [&](unsigned worker){
+    std::string text;
+    SGF::Game g;
+    uint64_t localPositions = 0;
+    while(true){
+      uint32_t first = next.fetch_add(batch, std::memory_order_relaxed);
+      if(first >= gameCount) break;
+      uint32_t last = std::min(gameCount, first + batch);
+      for(uint32_t id = first; id < last; ++id){
+        bool ok = false;
+        try { ok = source(id, text) && SGF::parseGame(text, g); }
+        catch(...) { ok = false; } // std::stoi/stod on malformed properties
+        int n = g.SZ > 0 ? g.SZ : 19;
+        if(!ok || n < 2 || n > 25){ failed.fetch_add(1, std::memory_order_relaxed); continue; }
+        for(auto *s : sinks) s->onGame(worker, id, g);
+        Board b(n);
+        for(auto *s : sinks) s->onPosition(worker, id, 0, b);
+        SGF::replay(g.moves, b, [&](const Board& cur, size_t moveNumber){
+          for(auto *s : sinks) s->onPosition(worker, id, static_cast<uint32_t>(moveNumber), cur);
+        });
+        localPositions += g.moves.size() + 1;
+        parsed.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    positions.fetch_add(localPositions, std::memory_order_relaxed);
+  };
+
+  std::vector<std::thread> pool;
+  for(unsigned w = 1; w < workers; ++w) pool.emplace_back(work, w);
+  work(0);
+  for(auto &t : pool) t.join();
+
+  ReplayStats st;
+  st.games = parsed.load(); st.failed = failed.load(); st.positions = positions.load();
+  return st;
+}
+
+} // namespace Corpus
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "board.h"
+#include "sgf.h"
+
+namespace Corpus {
+
+// Supplies the SGF text of game `id`; returns false if it cannot be read.
+using SourceFn = std::function<bool(uint32_t id, std::string& sgf)>;
+
+SourceFn fileSource(const std::vector<std::string>& paths);
+SourceFn stringSource(const std::vector<std::string>& sgfs);
+
+// Consumer of a corpus replay. Every game is handled by exactly one worker, so sinks
+// keep per-worker (or per-game) buffers and never need to lock in the callbacks.
+class IndexSink {
+public:
+  virtual ~IndexSink() = default;
+  virtual void begin(uint32_t gameCount, unsigned workers) = 0;
+  virtual void onGame(unsigned worker, uint32_t game, const SGF::Game& g) { (void)worker; (void)game; (void)g; }
+  // moveNumber 0 is the empty starting position
+  virtual void onPosition(unsigned worker, uint32_t game, uint32_t moveNumber, const Board& b) { (void)worker; (void)game; (void)moveNumber; (void)b; }
+};
+
+struct ReplayStats {
+  uint32_t games = 0;   // parsed and replayed
+  uint32_t failed = 0;  // unreadable or malformed records
+  uint64_t positions = 0;
+};
+
+// 0 means one worker per hardware thread
+unsigned resolveThreads(unsigned threads);
+
+// Parse and replay games [0, gameCount) on `threads` workers, feeding every sink.
+// Replay goes through SGF::parseGame/SGF::replay so positions match what SGF::parse builds.
+ReplayStats replayCorpus(uint32_t gameCount, const SourceFn& source, const std::vector<IndexSink*>& sinks, unsigned threads = 0);
+
+} // namespace Corpus
@@ -0,0 +1,409 @@
+#include "game_codec.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+#include "conv_net.h"
+#include "corpus_replay.h"
+
+namespace Corpus {
+
+namespace {
+
+const char kMagic[8] = {'G','O','A','R','C','H','I','V'};
+const uint32_t kHeuristicModelId = 1;
+const uint32_t kNetworkModelId = 2;
+
+// Rank alphabet: ranks below kDirect are coded directly, larger ranks escape to a
+// bit-length + raw-bits code, and moves outside the candidate list are sent raw.
+const int kDirect = 32;
+const int kLongRank = kDirect;
+const int kRawMove = kDirect + 1;
+const int kRankSymbols = kDirect + 2;
+const int kLengthSymbols = 12;
+
+// ---- byte-level container helpers ----
+
+void putVarint(std::string& out, uint64_t v){
+  while(v >= 0x80){ out.push_back(static_cast<char>((v & 0x7F) | 0x80)); v >>= 7; }
+  out.push_back(static_cast<char>(v));
+}
+
+void putString(std::string& out, const std::string& s){ putVarint(out, s.size()); out += s; }
+
+struct ByteReader {
+  const std::string& in;
+  size_t pos = 0;
+  bool ok = true;
+  explicit ByteReader(const std::string& s): in(s) {}
+  uint64_t varint(){
+    uint64_t v = 0; int shift = 0;
+    while(pos < in.size() && shift < 64){
+      uint8_t b = static_cast<uint8_t>(in[pos++]);
+      v |= static_cast<uint64_t>(b & 0x7F) << shift;
+      if(!(b & 0x80)) return v;
+      shift += 7;
+    }
+    ok = false; return 0;
+  }
+  std::string string(){
+    uint64_t n = varint();
+    if(!ok || n > in.size() - pos){ ok = false; return std::string(); }
+    std::string s = in.substr(pos, n); pos += n; return s;
+  }
+  void raw(void* dst, size_t n){
+    if(n > in.size() - pos){ ok = false; std::memset(dst, 0, n); return; }
+    std::memcpy(dst, in.data() + pos, n); pos += n;
+  }
+};
+
+// ---- arithmetic coder (Witten-Neal-Cleary, 32-bit state) ----
+
+const uint64_t kTop = 0xFFFFFFFFULL;
+const uint64_t kHalf = 0x80000000ULL;
+const uint64_t kQuarter = 0x40000000ULL;
+
+class ArithEncoder {
+public:
+  explicit ArithEncoder(std::string& out): out(out) {}
+  void encode(uint32_t cumLow, uint32_t cumHigh, uint32_t total){
+    uint64_t range = high - low + 1;
+    high = low + range * cumHigh / total - 1;
+    low = low + range * cumLow / total;
+    while(true){
+      if(high < kHalf){ emit(0); }
+      else if(low >= kHalf){ emit(1); low -= kHalf; high -= kHalf; }
+      else if(low >= kQuarter && high < kHalf + kQuarter){ ++pending; low -= kQuarter; high -= kQuarter; }
+      else break;
+      low <<= 1; high = (high << 1) | 1;
+    }
+  }
+  void finish(){
+    ++pending;
+    emit(low < kQuarter ? 0 : 1);
+    if(nbits) out.push_back(static_cast<char>(acc << (8 - nbits)));
+  }
+private:
+  void bit(int b){ acc = static_cast<uint8_t>((acc << 1) | b); if(++nbits == 8){ out.push_back(static_cast<char>(acc)); nbits = 0; acc = 0; } }
+  void emit(int b){ bit(b); for(; pending; --pending) bit(!b); }
+  std::string& out;
+  uint64_t low = 0, high = kTop;
+  uint64_t pending = 0;
+  uint8_t acc = 0;
+  int nbits = 0;
+};
+
+class ArithDecoder {
+public:
+  ArithDecoder(const std::string& in, size_t start): in(in), pos(start) {
+    for(int i=0;i<32;++i) value = (value << 1) | bit();
+  }
+  uint32_t target(uint32_t total) const {
+    uint64_t range = high - low + 1;
+    return static_cast<uint32_t>(((value - low + 1) * total - 1) / range);
+  }
+  void consume(uint32_t cumLow, uint32_t cumHigh, uint32_t total){
+    uint64_t range = high - low + 1;
+    high = low + range * cumHigh / total - 1;
+    low = low + range * cumLow / total;
+    while(true){
+      if(high < kHalf){}
+      else if(low >= kHalf){ low -= kHalf; high -= kHalf; value -= kHalf; }
+      else if(low >= kQuarter && high < kHalf + kQuarter){ low -= kQuarter; high -= kQuarter; value -= kQuarter; }
+      else break;
+      low <<= 1; high = (high << 1) | 1; value = (value << 1) | bit();
+    }
+  }
+private:
+  uint64_t bit(){
+    if(pos >= in.size()) return 0; // reading past the end yields zeros
+    uint64_t b = (static_cast<uint8_t>(in[pos]) >> (7 - nbit)) & 1;
+    if(++nbit == 8){ nbit = 0; ++pos; }
+    return b;
+  }
+  const std::string& in;
+  size_t pos;
+  int nbit = 0;
+  uint64_t low = 0, high = kTop, value = 0;
+};
+
+// Adaptive frequency model over a small alphabet.
+class AdaptiveModel {
+public:
+  explicit AdaptiveModel(int n, int decay = 0): freq(n) {
+    // start from a geometric-ish prior so short games do not pay for learning flat counts
+    for(int i=0;i<n;++i) freq[i] = std::max(1, 32 >> (decay ? i / decay : 0));
+    for(uint32_t f : freq) total += f;
+  }
+  void encode(ArithEncoder& enc, int s){
+    uint32_t lo = 0;
+    for(int i=0;i<s;++i) lo += freq[i];
+    enc.encode(lo, lo + freq[s], total);
+    update(s);
+  }
+  int decode(ArithDecoder& dec){
+    uint32_t t = dec.target(total);
+    uint32_t lo = 0; int s = 0;
+    while(s < (int)freq.size() - 1 && lo + freq[s] <= t){ lo += freq[s]; ++s; }
+    dec.consume(lo, lo + freq[s], total);
+    update(s);
+    return s;
+  }
+private:
+  void update(int s){
+    freq[s] += 24; total += 24;
+    if(total > (1u << 16)){
+      total = 0;
+      for(auto &f : freq){ f = (f + 1) / 2; total += f; }
+    }
+  }
+  std::vector<uint32_t> freq;
+  uint32_t total = 0;
+};
+
+void encodeUniform(ArithEncoder& enc, uint32_t v, uint32_t n){ enc.encode(v, v + 1, n); }
+uint32_t decodeUniform(ArithDecoder& dec, uint32_t n){
+  uint32_t v = std::min(dec.target(n), n - 1);
+  dec.consume(v, v + 1, n);
+  return v;
+}
+
+// Models for one game. Games start from fresh models so each decodes on its own.
+struct MoveModels {
+  AdaptiveModel rank{kRankSymbols, 2};
+  AdaptiveModel length{kLengthSymbols, 3};
+  AdaptiveModel color{2, 1};
+};
+
+int boardSizeOf(const SGF::Game& g){ return g.SZ > 0 ? g.SZ : 19; }
+
+// Candidates: empty points row-major, then pass (the order MCTS::legalMoves uses).
+void candidates(const Board& b, Stone s, std::vector<Board::Move>& out){
+  out.clear();
+  int N = b.size();
+  for(int y=0;y<N;y++) for(int x=0;x<N;x++) if(b.get(x,y)==EMPTY) out.push_back({x,y,s,false,std::string()});
+  out.push_back({-1,-1,s,true,std::string()});
+}
+
+// Position of candidate `i` when sorted by descending probability, ties by index.
+size_t rankOf(const std::vector<double>& p, size_t i){
+  size_t r = 0;
+  for(size_t j=0;j<p.size();++j) if(p[j] > p[i] || (p[j] == p[i] && j < i)) ++r;
+  return r;
+}
+
+size_t candidateAtRank(const std::vector<double>& p, size_t rank, std::vector<uint32_t>& order){
+  order.resize(p.size());
+  for(size_t i=0;i<p.size();++i) order[i] = static_cast<uint32_t>(i);
+  std::nth_element(order.begin(), order.begin() + rank, order.end(), [&p](uint32_t a, uint32_t b){
+    return p[a] != p[b] ? p[a] > p[b] : a < b;
+  });
+  return order[rank];
+}
+
+void applyMove(Board& b, const Board::Move& m){
+  if(m.pass) b.pass(m.s);
+  else b.place(m.x, m.y, m.s);
+}
+
+bool validSize(int n){ return n >= 1 && n <= 64; }
+
+} // namespace
+
+CodecModel heuristicModel(){
+  CodecModel m;
+  m.id = kHeuristicModelId;
+  m.make = []{ return makeSimpleHeuristicPV(); };
+  return m;
+}
+
+bool networkModel(const std::string& weightsPath, CodecModel& out){
+  auto net = std::make_shared<ConvPolicyValueNet>();
+  if(!net->load(weightsPath)) return false;
+  std::ifstream in(weightsPath, std::ios::binary);
+  std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  // FNV-1a over the weights, then the kernel
+  uint32_t h = 2166136261u;
+  for(char c : bytes){ h ^= static_cast<uint8_t>(c); h *= 16777619u; }
+#if defined(__AVX2__) && defined(__FMA__)
+  h ^= 1; h *= 16777619u;
+#endif
+  out.id = kNetworkModelId;
+  out.version = h;
+  out.make = [net]{ return std::shared_ptr<PolicyValueNet>(std::make_shared<ConvPolicyValueNet>(*net)); };
+  return true;
+}
+
+std::string encodeGame(const SGF::Game& g, PolicyValueNet& pv){
+  std::string out;
+  int N = boardSizeOf(g);
+  if(!validSize(N)) return out;
+  putVarint(out, static_cast<uint64_t>(g.SZ));
+  char km[sizeof(double)]; std::memcpy(km, &g.KM, sizeof(double)); out.append(km, sizeof(double));
+  for(const auto *s : {&g.PB, &g.PW, &g.RE, &g.DT, &g.BR, &g.WR}) putString(out, *s);
+  putVarint(out, g.moves.size());
+  size_t comments = 0;
+  for(const auto &m : g.moves) if(!m.comment.empty()) ++comments;
+  putVarint(out, comments);
+  for(size_t i=0;i<g.moves.size();++i) if(!g.moves[i].comment.empty()){ putVarint(out, i); putString(out, g.moves[i].comment); }
+
+  ArithEncoder enc(out);
+  MoveModels models;
+  Board b(N);
+  std::vector<Board::Move> cand;
+  Stone expected = BLACK;
+  for(const auto &m : g.moves){
+    models.color.encode(enc, m.s == expected ? 0 : 1);
+    candidates(b, m.s, cand);
+    size_t idx = cand.size();
+    if(m.pass) idx = cand.size() - 1;
+    else if(b.inside(m.x, m.y) && b.get(m.x, m.y) == EMPTY){
+      for(size_t i=0;i+1<cand.size();++i) if(cand[i].x == m.x && cand[i].y == m.y){ idx = i; break; }
+    }
+    if(idx == cand.size()){
+      models.rank.encode(enc, kRawMove);
+      encodeUniform(enc, static_cast<uint32_t>(m.x + 128) & 0xFF, 256);
+      encodeUniform(enc, static_cast<uint32_t>(m.y + 128) & 0xFF, 256);
+    } else {
+      auto probs = pv.policy(b, cand);
+      size_t rank = rankOf(probs, idx);
+      if(rank < static_cast<size_t>(kDirect)) models.rank.encode(enc, static_cast<int>(rank));
+      else {
+        models.rank.encode(enc, kLongRank);
+        uint32_t v = static_cast<uint32_t>(rank - kDirect + 1); // >= 1
+        int len = 0; while((v >> len) > 1) ++len;               // v has len+1 significant bits
+        models.length.encode(enc, len);
+        if(len) encodeUniform(enc, v & ((1u << len) - 1), 1u << len);
+      }
+    }
+    applyMove(b, m);
+    expected = (m.s == BLACK ? WHITE : BLACK);
+  }
+  enc.finish();
+  return out;
+}
+
+bool decodeGame(const std::string& blob, PolicyValueNet& pv, SGF::Game& out){
+  out = SGF::Game();
+  ByteReader r(blob);
+  out.SZ = static_cast<int>(r.varint());
+  r.raw(&out.KM, sizeof(double));
+  for(auto *s : {&out.PB, &out.PW, &out.RE, &out.DT, &out.BR, &out.WR}) *s = r.string();
+  uint64_t nMoves = r.varint();
+  uint64_t nComments = r.varint();
+  int N = boardSizeOf(out);
+  if(!r.ok || !validSize(N) || nMoves > blob.size() * 8 + 1) return false;
+  out.moves.resize(nMoves);
+  for(uint64_t c=0;c<nComments && r.ok;++c){
+    uint64_t i = r.varint();
+    std::string text = r.string();
+    if(i >= nMoves){ r.ok = false; break; }
+    out.moves[i].comment = std::move(text);
+  }
+  if(!r.ok) return false;
+
+  ArithDecoder dec(blob, r.pos);
+  MoveModels models;
+  Board b(N);
+  std::vector<Board::Move> cand;
+  std::vector<uint32_t> order;
+  Stone expected = BLACK;
+  for(auto &m : out.moves){
+    Stone s = models.color.decode(dec) == 0 ? expected : (expected == BLACK ? WHITE : BLACK);
+    int sym = models.rank.decode(dec);
+    m.s = s;
+    if(sym == kRawMove){
+      m.x = static_cast<int>(decodeUniform(dec, 256)) - 128;
+      m.y = static_cast<int>(decodeUniform(dec, 256)) - 128;
+      m.pass = false;
+    } else {
+      size_t rank = static_cast<size_t>(sym);
+      if(sym == kLongRank){
+        int len = models.length.decode(dec);
+        uint32_t v = 1u << len;
+        if(len) v |= decodeUniform(dec, 1u << len);
+        rank = v - 1 + kDirect;
+      }
+      candidates(b, s, cand);
+      if(rank >= cand.size()) return false;
+      auto probs = pv.policy(b, cand);
+      const auto &c = cand[candidateAtRank(probs, rank, order)];
+      m.x = c.x; m.y = c.y; m.pass = c.pass;
+    }
+    applyMove(b, m);
+    expected = (s == BLACK ? WHITE : BLACK);
+  }
+  return true;
+}
+
+std::string compressArchive(const std::vector<SGF::Game>& games, const CodecModel& model, unsigned threads,
+                            std::vector<size_t>* skipped){
+  std::vector<std::string> blobs(games.size());
+  std::atomic<size_t> next{0};
+  auto work = [&]{
+    auto pv = model.make();
+    for(size_t i = next++; i < games.size(); i = next++) blobs[i] = encodeGame(games[i], *pv);
+  };
+  unsigned workers = std::min<unsigned>(resolveThreads(threads), std::max<size_t>(1, games.size()));
+  std::vector<std::thread> pool;
+  for(unsigned w=1; w<workers; ++w) pool.emplace_back(work);
+  work();
+  for(auto &t : pool) t.join();
+  // an empty blob never decodes, so it would make the whole archive unreadable
+  size_t kept = 0;
+  for(size_t i=0;i<blobs.size();++i){
+    if(blobs[i].empty()){ if(skipped) skipped->push_back(i); continue; }
+    if(kept != i) blobs[kept] = std::move(blobs[i]);
+    ++kept;
+  }
+  blobs.resize(kept);
+
+  std::string out(kMagic, sizeof(kMagic));
+  uint32_t hdr[4] = {kCodecVersion, model.id, static_cast<uint32_t>(blobs.size()), model.version};
+  out.append(reinterpret_cast<const char*>(hdr), sizeof(hdr));
+  uint64_t off = 0;
+  for(const auto &b : blobs){ out.append(reinterpret_cast<const char*>(&off), sizeof(off)); off += b.size(); }
+  out.append(reinterpret_cast<const char*>(&off), sizeof(off));
+  for(const auto &b : blobs) out += b;
+  return out;
+}
+
+bool decompressArchive(const std::string& archive, const CodecModel& model, std::vector<SGF::Game>& out, unsigned threads){
+  out.clear();
+  uint32_t hdr[4];
+  if(archive.size() < sizeof(kMagic) + sizeof(hdr) || std::memcmp(archive.data(), kMagic, sizeof(kMagic)) != 0) return false;
+  std::memcpy(hdr, archive.data() + sizeof(kMagic), sizeof(hdr));
+  if(hdr[0] != kCodecVersion || hdr[1] != model.id || hdr[3] != model.version) return false;
+  size_t n = hdr[2];
+  size_t tableAt = sizeof(kMagic) + sizeof(hdr);
+  if(archive.size() < tableAt + (n + 1) * sizeof(uint64_t)) return false;
+  std::vector<uint64_t> offs(n + 1);
+  std::memcpy(offs.data(), archive.data() + tableAt, offs.size() * sizeof(uint64_t));
+  size_t dataAt = tableAt + offs.size() * sizeof(uint64_t);
+  for(size_t i=0;i<n;++i) if(offs[i] > offs[i+1]) return false;
+  if(offs[n] > archive.size() - dataAt) return false;
+
+  out.resize(n);
+  std::atomic<size_t> next{0};
+  std::atomic<bool> ok{true};
+  auto work = [&]{
+    auto pv = model.make();
+    for(size_t i = next++; i < n; i = next++){
+      std::string blob = archive.substr(dataAt + offs[i], offs[i+1] - offs[i]);
+      if(!decodeGame(blob, *pv, out[i])) ok = false;
+    }
+  };
+  unsigned workers = std::min<unsigned>(resolveThreads(threads), std::max<size_t>(1, n));
+  std::vector<std::thread> pool;
+  for(unsigned w=1; w<workers; ++w) pool.emplace_back(work);
+  work();
+  for(auto &t : pool) t.join();
+  if(!ok) out.clear();
+  return ok;
+}
+
+} // namespace Corpus
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "pvn.h"
+#include "sgf.h"
+
+namespace Corpus {
+
+// Archival codec for game records. Every move is replaced by its rank among the
+// candidate moves (empty points in row-major order, then pass) ordered by a
+// PolicyValueNet's policy, and the ranks are arithmetic-coded with an adaptive model.
+// Decoding replays the board and re-runs the same policy, so the model is part of the
+// format: archives record its id and weights version and refuse to decode under any
+// other model.
+//
+// Format version 1. Games are coded independently so archives compress and
+// decompress in parallel.
+const uint32_t kCodecVersion = 1;
+
+struct CodecModel {
+  uint32_t id = 0;
+  uint32_t version = 0; // which weights, for models that load them
+  // Called once per worker thread; policies need not be thread-safe.
+  std::function<std::shared_ptr<PolicyValueNet>()> make;
+};
+
+// Model id 1: the move_prior_score heuristic via makeSimpleHeuristicPV().
+CodecModel heuristicModel();
+// Model id 2: a ConvPolicyValueNet weight file (ai/conv_net.h), loaded once and copied
+// per worker. The version is a hash of the file and of the sgemm kernel in this build,
+// whose float rounding can reorder close moves. Fails when the file cannot be loaded.
+bool networkModel(const std::string& weightsPath, CodecModel& out);
+
+// Single-game blobs (metadata, comments and coded moves). encodeGame returns an empty
+// blob for games it cannot code (board size outside 1..64).
+std::string encodeGame(const SGF::Game& g, PolicyValueNet& pv);
+bool decodeGame(const std::string& blob, PolicyValueNet& pv, SGF::Game& out);
+
+// Whole archives: header, per-game offset table, game blobs. Games encodeGame rejects are
+// left out of the archive and their indices appended to `skipped` when given.
+std::string compressArchive(const std::vector<SGF::Game>& games, const CodecModel& model, unsigned threads = 0,
+                            std::vector<size_t>* skipped = nullptr);
+bool decompressArchive(const std::string& archive, const CodecModel& model, std::vector<SGF::Game>& out, unsigned threads = 0);
+
+} // namespace Corpus
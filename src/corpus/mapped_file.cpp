@@ -0,0 +1,59 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Corpus {
+
+#ifdef _WIN32
+bool MappedFile::open(const std::string& path){
+  close();
+  HANDLE f = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if(f == INVALID_HANDLE_VALUE) return false;
+  LARGE_INTEGER sz;
+  if(!GetFileSizeEx(f, &sz) || sz.QuadPart == 0){ CloseHandle(f); return false; }
+  HANDLE m = CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if(!m){ CloseHandle(f); return false; }
+  void* p = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+  if(!p){ CloseHandle(m); CloseHandle(f); return false; }
+  file = f; mapping = m;
+  ptr = static_cast<const unsigned char*>(p);
+  len = static_cast<size_t>(sz.QuadPart);
+  return true;
+}
+
+void MappedFile::close(){
+  if(ptr) UnmapViewOfFile(ptr);
+  if(mapping) CloseHandle(static_cast<HANDLE>(mapping));
+  if(file) CloseHandle(static_cast<HANDLE>(file));
+  ptr = nullptr; len = 0; mapping = nullptr; file = nullptr;
+}
+#else
+bool MappedFile::open(const std::string& path){
+  close();
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if(fd < 0) return false;
+  struct stat st;
+  if(fstat(fd, &st) != 0 || st.st_size == 0){ ::close(fd); return false; }
+  void* p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd); // the mapping keeps its own reference to the file
+  if(p == MAP_FAILED) return false;
+  ptr = static_cast<const unsigned char*>(p);
+  len = static_cast<size_t>(st.st_size);
+  return true;
+}
+
+void MappedFile::close(){
+  if(ptr) munmap(const_cast<unsigned char*>(ptr), len);
+  ptr = nullptr; len = 0;
+}
+#endif
+
+} // namespace Corpus
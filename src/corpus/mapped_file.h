@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace Corpus {
+
+// Read-only memory mapping of a whole file. Index readers keep one of these open
+// and answer queries straight from the page cache.
+class MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile() { close(); }
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  bool open(const std::string& path);
+  void close();
+  bool isOpen() const { return ptr != nullptr; }
+  const unsigned char* data() const { return ptr; }
+  size_t size() const { return len; }
+
+private:
+  const unsigned char* ptr = nullptr;
+  size_t len = 0;
+#ifdef _WIN32
+  void* file = nullptr;
+  void* mapping = nullptr;
+#endif
+};
+
+} // namespace Corpus
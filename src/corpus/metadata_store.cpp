@@ -0,0 +1,256 @@
+#include "metadata_store.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace Corpus {
+
+namespace {
+
+const char kMagic[8] = {'G','O','M','E','T','A','D','B'};
+const uint32_t kVersion = 1;
+const size_t kBlock = 4096; // rows per scan block
+
+struct StoreHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t gameCount;
+  uint32_t playerCount;
+  uint32_t reserved;
+  uint64_t nameBytes;
+};
+
+// Byte offsets of each column; every column starts on an 8-byte boundary.
+struct Layout {
+  size_t black, white, date, result, komi, moves, size, blackRank, whiteRank, nameOffsets, nameData, total;
+};
+
+Layout layoutFor(uint64_t n, uint64_t players, uint64_t nameBytes){
+  auto align8 = [](size_t v){ return (v + 7) & ~size_t(7); };
+  Layout l;
+  size_t p = sizeof(StoreHeader);
+  l.black = p;       p = align8(p + n * sizeof(uint32_t));
+  l.white = p;       p = align8(p + n * sizeof(uint32_t));
+  l.date = p;        p = align8(p + n * sizeof(uint32_t));
+  l.result = p;      p = align8(p + n * sizeof(uint16_t));
+  l.komi = p;        p = align8(p + n * sizeof(int16_t));
+  l.moves = p;       p = align8(p + n * sizeof(uint16_t));
+  l.size = p;        p = align8(p + n);
+  l.blackRank = p;   p = align8(p + n);
+  l.whiteRank = p;   p = align8(p + n);
+  l.nameOffsets = p; p = p + (players + 1) * sizeof(uint64_t);
+  l.nameData = p;    p = p + nameBytes;
+  l.total = p;
+  return l;
+}
+
+std::string lowerTrim(const std::string& s){
+  std::string out;
+  for(char c : s) if(!std::isspace(static_cast<unsigned char>(c))) out.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
+  return out;
+}
+
+} // namespace
+
+uint16_t packResult(const std::string& re){
+  std::string r = lowerTrim(re);
+  if(r=="0" || r=="draw" || r=="jigo") return static_cast<uint16_t>(Winner::Draw);
+  if(r.size() < 2 || (r[0]!='b' && r[0]!='w') || r[1]!='+') return static_cast<uint16_t>(Winner::Unknown);
+  uint16_t winner = static_cast<uint16_t>(r[0]=='b' ? Winner::Black : Winner::White);
+  std::string rest = r.substr(2);
+  ResultKind kind = ResultKind::Other;
+  unsigned margin = 0;
+  if(rest=="r" || rest=="resign") kind = ResultKind::Resign;
+  else if(rest=="t" || rest=="time") kind = ResultKind::Time;
+  else if(!rest.empty() && (std::isdigit(static_cast<unsigned char>(rest[0])) || rest[0]=='.')){
+    kind = ResultKind::Score;
+    double m = std::atof(rest.c_str());
+    margin = static_cast<unsigned>(std::min(4095.0, std::round(m * 2.0)));
+  }
+  return static_cast<uint16_t>(winner | (static_cast<uint16_t>(kind) << 2) | (margin << 4));
+}
+
+int8_t parseRank(const std::string& rank){
+  std::string r = lowerTrim(rank);
+  size_t i = 0; int v = 0;
+  while(i < r.size() && std::isdigit(static_cast<unsigned char>(r[i]))){ v = v*10 + (r[i]-'0'); ++i; }
+  if(i==0 || i>=r.size() || v<=0) return kNoRank;
+  switch(r[i]){
+    case 'k': return v > 30 ? kNoRank : static_cast<int8_t>(1 - v);
+    case 'd': return v > 9 ? kNoRank : static_cast<int8_t>(v);
+    case 'p': return v > 9 ? kNoRank : static_cast<int8_t>(9 + v);
+    default: return kNoRank;
+  }
+}
+
+uint32_t parseDate(const std::string& dt){
+  // YYYY[-MM[-DD]], possibly followed by more dates
+  uint32_t parts[3] = {0, 0, 0};
+  int digits[3] = {4, 2, 2};
+  size_t i = 0;
+  for(int k=0;k<3;++k){
+    if(k>0){ if(i >= dt.size() || dt[i] != '-') break; ++i; }
+    int n = 0;
+    while(n < digits[k] && i < dt.size() && std::isdigit(static_cast<unsigned char>(dt[i]))){ parts[k] = parts[k]*10 + (dt[i]-'0'); ++i; ++n; }
+    if(n != digits[k]){ if(k==0) return 0; parts[k] = 0; break; }
+  }
+  return parts[0]*10000 + parts[1]*100 + parts[2];
+}
+
+void MetadataStoreWriter::begin(uint32_t gameCount, unsigned workers){
+  (void)workers;
+  rows.assign(gameCount, Row());
+}
+
+void MetadataStoreWriter::onGame(unsigned worker, uint32_t game, const SGF::Game& g){
+  (void)worker;
+  Row &r = rows[game];
+  r.black = g.PB;
+  r.white = g.PW;
+  r.date = parseDate(g.DT);
+  r.result = packResult(g.RE);
+  r.komi2 = static_cast<int16_t>(std::max(-32768.0, std::min(32767.0, std::round(g.KM * 2.0))));
+  r.moves = static_cast<uint16_t>(std::min<size_t>(g.moves.size(), 65535));
+  r.size = static_cast<uint8_t>(g.SZ > 0 ? g.SZ : 19);
+  r.blackRank = parseRank(g.BR);
+  r.whiteRank = parseRank(g.WR);
+}
+
+bool MetadataStoreWriter::write(const std::string& path){
+  std::vector<std::string> dict;
+  dict.reserve(rows.size() * 2);
+  for(const auto &r : rows){ dict.push_back(r.black); dict.push_back(r.white); }
+  std::sort(dict.begin(), dict.end());
+  dict.erase(std::unique(dict.begin(), dict.end()), dict.end());
+  auto idOf = [&dict](const std::string& s){ return static_cast<uint32_t>(std::lower_bound(dict.begin(), dict.end(), s) - dict.begin()); };
+
+  uint64_t nameBytes = 0;
+  for(const auto &d : dict) nameBytes += d.size();
+  uint64_t n = rows.size();
+  Layout l = layoutFor(n, dict.size(), nameBytes);
+  std::vector<unsigned char> buf(l.total, 0);
+
+  StoreHeader hdr;
+  std::memcpy(hdr.magic, kMagic, sizeof(kMagic));
+  hdr.version = kVersion;
+  hdr.gameCount = static_cast<uint32_t>(n);
+  hdr.playerCount = static_cast<uint32_t>(dict.size());
+  hdr.reserved = 0;
+  hdr.nameBytes = nameBytes;
+  std::memcpy(buf.data(), &hdr, sizeof(hdr));
+
+  unsigned char* base = buf.data();
+  auto* black = reinterpret_cast<uint32_t*>(base + l.black);
+  auto* white = reinterpret_cast<uint32_t*>(base + l.white);
+  auto* date = reinterpret_cast<uint32_t*>(base + l.date);
+  auto* result = reinterpret_cast<uint16_t*>(base + l.result);
+  auto* komi = reinterpret_cast<int16_t*>(base + l.komi);
+  auto* moves = reinterpret_cast<uint16_t*>(base + l.moves);
+  auto* size = base + l.size;
+  auto* brank = reinterpret_cast<int8_t*>(base + l.blackRank);
+  auto* wrank = reinterpret_cast<int8_t*>(base + l.whiteRank);
+  for(uint64_t i=0;i<n;++i){
+    const Row &r = rows[i];
+    black[i] = idOf(r.black); white[i] = idOf(r.white);
+    date[i] = r.date; result[i] = r.result; komi[i] = r.komi2; moves[i] = r.moves;
+    size[i] = r.size; brank[i] = r.blackRank; wrank[i] = r.whiteRank;
+  }
+  auto* offs = reinterpret_cast<uint64_t*>(base + l.nameOffsets);
+  uint64_t off = 0;
+  for(size_t i=0;i<dict.size();++i){
+    offs[i] = off;
+    std::memcpy(base + l.nameData + off, dict[i].data(), dict[i].size());
+    off += dict[i].size();
+  }
+  offs[dict.size()] = off;
+
+  std::ofstream out(path, std::ios::binary);
+  if(!out) return false;
+  out.write(reinterpret_cast<const char*>(buf.data()), static_cast<std::streamsize>(buf.size()));
+  return static_cast<bool>(out);
+}
+
+bool MetadataStore::open(const std::string& path){
+  if(!file.open(path)) return false;
+  StoreHeader hdr;
+  if(file.size() < sizeof(hdr)){ file.close(); return false; }
+  std::memcpy(&hdr, file.data(), sizeof(hdr));
+  if(std::memcmp(hdr.magic, kMagic, sizeof(kMagic)) != 0 || hdr.version != kVersion){ file.close(); return false; }
+  Layout l = layoutFor(hdr.gameCount, hdr.playerCount, hdr.nameBytes);
+  if(file.size() < l.total){ file.close(); return false; }
+  const unsigned char* p = file.data();
+  nGames = hdr.gameCount;
+  nPlayers = hdr.playerCount;
+  blackPlayer = reinterpret_cast<const uint32_t*>(p + l.black);
+  whitePlayer = reinterpret_cast<const uint32_t*>(p + l.white);
+  date = reinterpret_cast<const uint32_t*>(p + l.date);
+  result = reinterpret_cast<const uint16_t*>(p + l.result);
+  komi2 = reinterpret_cast<const int16_t*>(p + l.komi);
+  moves = reinterpret_cast<const uint16_t*>(p + l.moves);
+  size = reinterpret_cast<const uint8_t*>(p + l.size);
+  blackRank = reinterpret_cast<const int8_t*>(p + l.blackRank);
+  whiteRank = reinterpret_cast<const int8_t*>(p + l.whiteRank);
+  nameOffsets = reinterpret_cast<const uint64_t*>(p + l.nameOffsets);
+  nameData = reinterpret_cast<const char*>(p + l.nameData);
+  return true;
+}
+
+std::string MetadataStore::playerName(uint32_t id) const {
+  if(id >= nPlayers) return std::string();
+  return std::string(nameData + nameOffsets[id], nameData + nameOffsets[id+1]);
+}
+
+uint32_t MetadataStore::playerId(const std::string& name) const {
+  uint32_t lo = 0, hi = nPlayers;
+  while(lo < hi){
+    uint32_t mid = lo + (hi - lo) / 2;
+    const char* s = nameData + nameOffsets[mid];
+    size_t len = static_cast<size_t>(nameOffsets[mid+1] - nameOffsets[mid]);
+    int c = std::string(s, len).compare(name);
+    if(c == 0) return mid;
+    if(c < 0) lo = mid + 1; else hi = mid;
+  }
+  return UINT32_MAX;
+}
+
+std::vector<uint32_t> MetadataStore::select(const MetadataFilter& f) const {
+  std::vector<uint32_t> out;
+  auto resolve = [this](const std::string& name, uint32_t& id){
+    if(name.empty()){ id = UINT32_MAX; return true; }
+    id = playerId(name);
+    return id != UINT32_MAX;
+  };
+  uint32_t anyId, blackId, whiteId;
+  if(!resolve(f.player, anyId) || !resolve(f.blackPlayer, blackId) || !resolve(f.whitePlayer, whiteId)) return out;
+  const int komiLo = std::isinf(f.komiMin) ? -32768 : static_cast<int>(std::ceil(f.komiMin * 2.0 - 1e-9));
+  const int komiHi = std::isinf(f.komiMax) ? 32767 : static_cast<int>(std::floor(f.komiMax * 2.0 + 1e-9));
+  const bool byKomi = komiLo > -32768 || komiHi < 32767;
+  const bool byDate = f.dateFrom > 0 || f.dateTo < std::numeric_limits<uint32_t>::max();
+  const bool byMoves = f.minMoves > 0 || f.maxMoves < 65535;
+  const uint8_t wantWinner = static_cast<uint8_t>(f.winner);
+
+  // Each predicate is a branch-free pass over one column block, ANDed into a byte mask;
+  // the loops are simple enough for the compiler to vectorize.
+  uint8_t mask[kBlock];
+  for(size_t base=0; base<nGames; base+=kBlock){
+    const size_t n = std::min<size_t>(kBlock, nGames - base);
+    const uint8_t* sz = size + base;
+    if(f.size > 0){ const uint8_t want = static_cast<uint8_t>(f.size); for(size_t i=0;i<n;++i) mask[i] = sz[i] == want; }
+    else { for(size_t i=0;i<n;++i) mask[i] = sz[i] != 0; }
+    if(anyId != UINT32_MAX){ const uint32_t *b = blackPlayer + base, *w = whitePlayer + base; for(size_t i=0;i<n;++i) mask[i] &= (b[i] == anyId) | (w[i] == anyId); }
+    if(blackId != UINT32_MAX){ const uint32_t *b = blackPlayer + base; for(size_t i=0;i<n;++i) mask[i] &= b[i] == blackId; }
+    if(whiteId != UINT32_MAX){ const uint32_t *w = whitePlayer + base; for(size_t i=0;i<n;++i) mask[i] &= w[i] == whiteId; }
+    if(f.minRank != kNoRank){ const int8_t *b = blackRank + base, *w = whiteRank + base; const int8_t r = f.minRank; for(size_t i=0;i<n;++i) mask[i] &= (b[i] >= r) & (w[i] >= r); }
+    if(wantWinner){ const uint16_t* r = result + base; for(size_t i=0;i<n;++i) mask[i] &= (r[i] & 3) == wantWinner; }
+    if(byKomi){ const int16_t* k = komi2 + base; for(size_t i=0;i<n;++i) mask[i] &= (k[i] >= komiLo) & (k[i] <= komiHi); }
+    if(byDate){ const uint32_t* d = date + base; const uint32_t lo = f.dateFrom, hi = f.dateTo; for(size_t i=0;i<n;++i) mask[i] &= (d[i] >= lo) & (d[i] <= hi); }
+    if(byMoves){ const uint16_t* m = moves + base; const int lo = f.minMoves, hi = f.maxMoves; for(size_t i=0;i<n;++i) mask[i] &= (m[i] >= lo) & (m[i] <= hi); }
+    for(size_t i=0;i<n;++i) if(mask[i]) out.push_back(static_cast<uint32_t>(base + i));
+  }
+  return out;
+}
+
+} // namespace Corpus
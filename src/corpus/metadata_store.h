@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "corpus_replay.h"
+#include "mapped_file.h"
+
+namespace Corpus {
+
+// Packed result column: bits 0-1 winner, bits 2-3 kind, bits 4-15 score margin in half points.
+enum class Winner : uint8_t { Unknown = 0, Black = 1, White = 2, Draw = 3 };
+enum class ResultKind : uint8_t { Score = 0, Resign = 1, Time = 2, Other = 3 };
+
+uint16_t packResult(const std::string& re);
+inline Winner resultWinner(uint16_t r) { return static_cast<Winner>(r & 3); }
+inline ResultKind resultKind(uint16_t r) { return static_cast<ResultKind>((r >> 2) & 3); }
+inline double resultMargin(uint16_t r) { return (r >> 4) / 2.0; }
+
+// Ranks on one scale: 30k=-29 .. 1k=0, 1d=1 .. 9d=9, 1p=10 .. 9p=18; kNoRank when missing.
+const int8_t kNoRank = std::numeric_limits<int8_t>::min();
+int8_t parseRank(const std::string& rank);
+// First date of an SGF DT value as YYYYMMDD; 0 when missing. Partial dates fill with zeros.
+uint32_t parseDate(const std::string& dt);
+
+// Filter for MetadataStore::select. Default-constructed fields do not constrain anything.
+struct MetadataFilter {
+  std::string player;      // plays either colour
+  std::string blackPlayer;
+  std::string whitePlayer;
+  int8_t minRank = kNoRank; // both players at least this strong (use parseRank)
+  Winner winner = Winner::Unknown; // Unknown = any result
+  double komiMin = -std::numeric_limits<double>::infinity();
+  double komiMax = std::numeric_limits<double>::infinity();
+  int size = 0;
+  uint32_t dateFrom = 0;
+  uint32_t dateTo = std::numeric_limits<uint32_t>::max();
+  int minMoves = 0;
+  int maxMoves = std::numeric_limits<int>::max();
+};
+
+// Collects game metadata during a corpus replay and writes the columnar store.
+class MetadataStoreWriter : public IndexSink {
+public:
+  void begin(uint32_t gameCount, unsigned workers) override;
+  void onGame(unsigned worker, uint32_t game, const SGF::Game& g) override;
+  bool write(const std::string& path);
+
+private:
+  struct Row {
+    std::string black, white;
+    uint32_t date = 0;
+    uint16_t result = 0;
+    int16_t komi2 = 0;
+    uint16_t moves = 0;
+    uint8_t size = 0;
+    int8_t blackRank = kNoRank, whiteRank = kNoRank;
+  };
+  std::vector<Row> rows;
+};
+
+// Memory-mapped column store. Every column is a flat array indexed by game id; player
+// names are dictionary-encoded against a sorted name table.
+class MetadataStore {
+public:
+  bool open(const std::string& path);
+  bool isOpen() const { return file.isOpen(); }
+  uint32_t gameCount() const { return nGames; }
+
+  // Dictionary id of `name`, or UINT32_MAX if no game has that player.
+  uint32_t playerId(const std::string& name) const;
+  std::string playerName(uint32_t id) const;
+
+  // Sorted ids of the games matching every constraint of `f`.
+  std::vector<uint32_t> select(const MetadataFilter& f) const;
+
+  // Raw columns
+  const uint32_t* blackPlayer = nullptr;
+  const uint32_t* whitePlayer = nullptr;
+  const uint32_t* date = nullptr;
+  const uint16_t* result = nullptr;
+  const int16_t* komi2 = nullptr; // komi in half points
+  const uint16_t* moves = nullptr;
+  const uint8_t* size = nullptr;  // 0 for records that failed to parse
+  const int8_t* blackRank = nullptr;
+  const int8_t* whiteRank = nullptr;
+
+private:
+  MappedFile file;
+  uint32_t nGames = 0;
+  uint32_t nPlayers = 0;
+  const uint64_t* nameOffsets = nullptr;
+  const char* nameData = nullptr;
+};
+
+} // namespace Corpus
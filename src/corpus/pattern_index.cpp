@@ -0,0 +1,420 @@
+#include "pattern_index.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+#include "bitops.h"
+
+namespace Corpus {
+
+namespace {
+
+const char kMagic[8] = {'G','O','P','A','T','I','D','X'};
+const uint32_t kVersion = 2;
+
+template <class Pattern> struct States;
+template <> struct States<CornerPattern> { static const int value = 3; }; // empty, black, white
+template <> struct States<LocalPattern> { static const int value = 4; };  // and off the board
+
+struct IndexHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t gameCount;
+  uint64_t patternCount; // corner patterns
+  uint64_t localCount;   // local windows
+  uint64_t words;        // 64-bit words per game bitmap
+};
+
+template <class Pattern>
+size_t bitmapWords(uint64_t words){ return static_cast<size_t>(Pattern::kCells) * States<Pattern>::value * words; }
+
+uint64_t transposeMask(uint64_t m){
+  uint64_t out = 0;
+  while(m){
+    int bit = lowestBit(m);
+    m &= m - 1;
+    int r = bit / CornerPattern::kSide, c = bit % CornerPattern::kSide;
+    out |= 1ULL << (c * CornerPattern::kSide + r);
+  }
+  return out;
+}
+
+// Cell of a 5x5 window under each of the 8 symmetries: bit 0 flips rows, bit 1 flips
+// columns, bit 2 transposes.
+struct LocalSymmetries {
+  uint8_t cell[8][LocalPattern::kCells];
+  LocalSymmetries(){
+    const int n = LocalPattern::kSide;
+    for(int sym=0;sym<8;++sym) for(int r=0;r<n;++r) for(int c=0;c<n;++c){
+      int rr = (sym & 1) ? n-1-r : r, cc = (sym & 2) ? n-1-c : c;
+      if(sym & 4) std::swap(rr, cc);
+      cell[sym][r*n + c] = static_cast<uint8_t>(rr*n + cc);
+    }
+  }
+};
+
+uint32_t transformMask(uint32_t m, int sym){
+  static const LocalSymmetries table;
+  uint32_t out = 0;
+  while(m){
+    int bit = lowestBit(m);
+    m &= m - 1;
+    out |= 1u << table.cell[sym][bit];
+  }
+  return out;
+}
+
+// Runs fn(begin, end) over [0, n) split into `parts` contiguous ranges, each a multiple of `align`.
+template <class Fn>
+void parallelRanges(uint64_t n, unsigned parts, uint64_t align, Fn fn){
+  parts = std::max(1u, parts);
+  uint64_t step = (n + parts - 1) / parts;
+  step = (step + align - 1) / align * align;
+  if(step == 0) step = align;
+  std::vector<std::thread> ts;
+  for(uint64_t b = 0; b < n; b += step) ts.emplace_back(fn, b, std::min(n, b + step));
+  for(auto &t : ts) t.join();
+}
+
+} // namespace
+
+CornerPattern CornerPattern::extract(const Board& b, int corner){
+  CornerPattern p;
+  int N = b.size();
+  for(int r=0;r<kSide;++r){
+    int y = (corner & 2) ? N-1-r : r;
+    for(int c=0;c<kSide;++c){
+      int x = (corner & 1) ? N-1-c : c;
+      Stone s = b.get(x, y);
+      if(s==BLACK) p.black |= 1ULL << (r*kSide + c);
+      else if(s==WHITE) p.white |= 1ULL << (r*kSide + c);
+    }
+  }
+  return p;
+}
+
+CornerPattern CornerPattern::transposed() const {
+  CornerPattern p;
+  p.black = transposeMask(black);
+  p.white = transposeMask(white);
+  return p;
+}
+
+CornerPattern CornerPattern::canonical() const {
+  CornerPattern t = transposed();
+  CornerPattern best = *this;
+  for(const auto &v : {t, colorSwapped(), t.colorSwapped()}) if(v < best) best = v;
+  return best;
+}
+
+LocalPattern LocalPattern::extract(const Board& b, int x, int y){
+  LocalPattern p;
+  int N = b.size(), h = kSide / 2;
+  for(int r=0;r<kSide;++r) for(int c=0;c<kSide;++c){
+    int px = x + c - h, py = y + r - h;
+    uint32_t bit = 1u << (r*kSide + c);
+    if(px < 0 || py < 0 || px >= N || py >= N){ p.edge |= bit; continue; }
+    Stone s = b.get(px, py);
+    if(s==BLACK) p.black |= bit;
+    else if(s==WHITE) p.white |= bit;
+  }
+  return p;
+}
+
+LocalPattern LocalPattern::transformed(int sym) const {
+  LocalPattern p;
+  p.black = transformMask(black, sym);
+  p.white = transformMask(white, sym);
+  p.edge = transformMask(edge, sym);
+  return p;
+}
+
+LocalPattern LocalPattern::canonical() const {
+  LocalPattern best = *this;
+  for(int sym=0;sym<8;++sym){
+    LocalPattern t = transformed(sym);
+    if(t < best) best = t;
+    t = t.colorSwapped();
+    if(t < best) best = t;
+  }
+  return best;
+}
+
+uint64_t LocalPattern::hash() const {
+  // splitmix64 finaliser over the three 25-bit masks
+  uint64_t z = (static_cast<uint64_t>(black) | static_cast<uint64_t>(white) << 25) ^ (static_cast<uint64_t>(edge) * 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+LocalQuery LocalQuery::fromRows(const std::vector<std::string>& rows){
+  LocalQuery q;
+  for(int r=0;r<(int)rows.size() && r<LocalPattern::kSide;++r){
+    for(int c=0;c<(int)rows[r].size() && c<LocalPattern::kSide;++c){
+      uint32_t bit = 1u << (r*LocalPattern::kSide + c);
+      char ch = rows[r][c];
+      if(ch=='X' || ch=='B'){ q.black |= bit; q.care |= bit; }
+      else if(ch=='O' || ch=='W'){ q.white |= bit; q.care |= bit; }
+      else if(ch=='#'){ q.edge |= bit; q.care |= bit; }
+      else if(ch=='.'){ q.care |= bit; }
+    }
+  }
+  return q;
+}
+
+CornerQuery CornerQuery::fromRows(const std::vector<std::string>& rows){
+  CornerQuery q;
+  for(int r=0;r<(int)rows.size() && r<CornerPattern::kSide;++r){
+    for(int c=0;c<(int)rows[r].size() && c<CornerPattern::kSide;++c){
+      uint64_t bit = 1ULL << (r*CornerPattern::kSide + c);
+      char ch = rows[r][c];
+      if(ch=='X' || ch=='B'){ q.black |= bit; q.care |= bit; }
+      else if(ch=='O' || ch=='W'){ q.white |= bit; q.care |= bit; }
+      else if(ch=='.'){ q.care |= bit; }
+    }
+  }
+  return q;
+}
+
+void PatternIndexWriter::begin(uint32_t gameCount, unsigned nWorkers){
+  workers.assign(nWorkers, WorkerState());
+  games.assign(gameCount, std::vector<CornerPattern>());
+  locals.assign(gameCount, std::vector<LocalPattern>());
+}
+
+void PatternIndexWriter::onPosition(unsigned worker, uint32_t game, uint32_t moveNumber, const Board& b){
+  if(moveNumber > 0 && !b.moves().empty()){
+    const Board::Move& m = b.moves().back();
+    if(!m.pass) locals[game].push_back(LocalPattern::extract(b, m.x, m.y).canonical());
+  }
+  if(b.size() < CornerPattern::kSide) return;
+  auto &ws = workers[worker];
+  if(ws.game != game){
+    ws.game = game;
+    for(auto &l : ws.last){ l.black = ~0ULL; l.white = ~0ULL; }
+  }
+  auto &out = games[game];
+  // Only corners touched by the last move change, so most positions add nothing.
+  for(int c=0;c<4;++c){
+    CornerPattern p = CornerPattern::extract(b, c);
+    if(p == ws.last[c]) continue;
+    ws.last[c] = p;
+    out.push_back(p.canonical());
+  }
+}
+
+namespace {
+
+// Sorts and dedupes each game's patterns, then builds the per-game offsets and the
+// (cell, state) game bitmaps.
+template <class Pattern>
+void buildSection(std::vector<std::vector<Pattern>>& games, unsigned parts, uint64_t words,
+                  std::vector<uint64_t>& offsets, std::vector<uint64_t>& bitmaps){
+  uint64_t nGames = games.size();
+  parallelRanges(nGames, parts, 1, [&games](uint64_t b, uint64_t e){
+    for(uint64_t g=b; g<e; ++g){
+      auto &v = games[g];
+      std::sort(v.begin(), v.end());
+      v.erase(std::unique(v.begin(), v.end()), v.end());
+    }
+  });
+
+  offsets.assign(nGames + 1, 0);
+  for(uint64_t g=0; g<nGames; ++g) offsets[g+1] = offsets[g] + games[g].size();
+
+  // Each thread owns whole bitmap words (64 games), so no two threads share a word.
+  const int states = States<Pattern>::value;
+  bitmaps.assign(bitmapWords<Pattern>(words), 0);
+  parallelRanges(nGames, parts, 64, [&](uint64_t b, uint64_t e){
+    for(uint64_t g=b; g<e; ++g){
+      uint64_t bit = 1ULL << (g & 63);
+      for(const auto &p : games[g]){
+        for(int cell=0; cell<Pattern::kCells; ++cell)
+          bitmaps[(static_cast<size_t>(cell) * states + p.state(cell)) * words + (g >> 6)] |= bit;
+      }
+    }
+  });
+}
+
+template <class T>
+void writeArray(std::ofstream& out, const std::vector<T>& v){
+  out.write(reinterpret_cast<const char*>(v.data()), static_cast<std::streamsize>(v.size() * sizeof(T)));
+}
+
+} // namespace
+
+bool PatternIndexWriter::write(const std::string& path, unsigned threads){
+  unsigned parts = resolveThreads(threads);
+  uint64_t nGames = games.size();
+  uint64_t words = (nGames + 63) / 64;
+  std::vector<uint64_t> cornerOffsets, cornerBitmaps, localOffsets, localBitmaps;
+  buildSection(games, parts, words, cornerOffsets, cornerBitmaps);
+  buildSection(locals, parts, words, localOffsets, localBitmaps);
+
+  std::vector<PatternIndex::HashEntry> hashes;
+  hashes.reserve(localOffsets[nGames]);
+  for(uint64_t g=0; g<nGames; ++g)
+    for(const auto &p : locals[g]) hashes.push_back({p.hash(), static_cast<uint32_t>(g), 0});
+  std::sort(hashes.begin(), hashes.end(), [](const PatternIndex::HashEntry& a, const PatternIndex::HashEntry& b){
+    return a.hash != b.hash ? a.hash < b.hash : a.game < b.game;
+  });
+
+  std::ofstream out(path, std::ios::binary);
+  if(!out) return false;
+  IndexHeader hdr;
+  std::memcpy(hdr.magic, kMagic, sizeof(kMagic));
+  hdr.version = kVersion;
+  hdr.gameCount = static_cast<uint32_t>(nGames);
+  hdr.patternCount = cornerOffsets[nGames];
+  hdr.localCount = localOffsets[nGames];
+  hdr.words = words;
+  out.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+  writeArray(out, cornerBitmaps);
+  writeArray(out, cornerOffsets);
+  for(const auto &v : games) writeArray(out, v);
+  writeArray(out, localBitmaps);
+  writeArray(out, localOffsets);
+  writeArray(out, hashes);
+  for(const auto &v : locals) writeArray(out, v);
+  return static_cast<bool>(out);
+}
+
+bool PatternIndex::open(const std::string& path){
+  if(!file.open(path)) return false;
+  IndexHeader hdr;
+  if(file.size() < sizeof(hdr)){ file.close(); return false; }
+  std::memcpy(&hdr, file.data(), sizeof(hdr));
+  if(std::memcmp(hdr.magic, kMagic, sizeof(kMagic)) != 0 || hdr.version != kVersion){ file.close(); return false; }
+  // compare counts against what is left of the file, so a corrupt header cannot overflow
+  uint64_t rest = file.size() - sizeof(hdr);
+  uint64_t offsetBytes = (static_cast<uint64_t>(hdr.gameCount) + 1) * sizeof(uint64_t);
+  uint64_t maxWords = rest / sizeof(uint64_t) / (LocalPattern::kCells * States<LocalPattern>::value + CornerPattern::kCells * States<CornerPattern>::value);
+  if(hdr.words > maxWords){ file.close(); return false; }
+  uint64_t fixed = (bitmapWords<CornerPattern>(hdr.words) + bitmapWords<LocalPattern>(hdr.words)) * sizeof(uint64_t) + 2 * offsetBytes;
+  if(fixed > rest){ file.close(); return false; }
+  rest -= fixed;
+  if(hdr.patternCount > rest / sizeof(CornerPattern)){ file.close(); return false; }
+  rest -= hdr.patternCount * sizeof(CornerPattern);
+  if(hdr.localCount > rest / (sizeof(HashEntry) + sizeof(LocalPattern))){ file.close(); return false; }
+  nGames = hdr.gameCount;
+  words = hdr.words;
+  const unsigned char* q = file.data() + sizeof(hdr);
+  corners.count = hdr.patternCount;
+  corners.bitmaps = reinterpret_cast<const uint64_t*>(q);
+  q += bitmapWords<CornerPattern>(words) * sizeof(uint64_t);
+  corners.offsets = reinterpret_cast<const uint64_t*>(q);
+  q += offsetBytes;
+  corners.patterns = reinterpret_cast<const CornerPattern*>(q);
+  q += corners.count * sizeof(CornerPattern);
+  locals.count = hdr.localCount;
+  locals.bitmaps = reinterpret_cast<const uint64_t*>(q);
+  q += bitmapWords<LocalPattern>(words) * sizeof(uint64_t);
+  locals.offsets = reinterpret_cast<const uint64_t*>(q);
+  q += offsetBytes;
+  hashes = reinterpret_cast<const HashEntry*>(q);
+  q += locals.count * sizeof(HashEntry);
+  locals.patterns = reinterpret_cast<const LocalPattern*>(q);
+  return true;
+}
+
+// Stored patterns are canonical, so the caller passes the query under every transform
+// that canonical() folds; duplicates among them are skipped.
+template <class Pattern, class Query>
+void PatternIndex::searchVariants(const Section<Pattern>& s, const std::vector<Query>& variants,
+                                  std::vector<uint64_t>& result, PatternSearchStats& st) const {
+  const int states = States<Pattern>::value;
+  std::vector<uint64_t> acc(words);
+  for(size_t v=0; v<variants.size(); ++v){
+    const Query &cq = variants[v];
+    bool seen = false;
+    for(size_t u=0; u<v; ++u) if(variants[u] == cq) seen = true;
+    if(seen) continue;
+
+    std::fill(acc.begin(), acc.end(), ~0ULL);
+    if(nGames % 64) acc[words-1] = (1ULL << (nGames % 64)) - 1;
+    uint64_t care = cq.care;
+    while(care){
+      int cell = lowestBit(care);
+      care &= care - 1;
+      const uint64_t* bm = s.bitmaps + (static_cast<size_t>(cell) * states + cq.state(cell)) * words;
+      uint64_t any = 0;
+      for(uint64_t w=0; w<words; ++w){ acc[w] &= bm[w]; any |= acc[w]; }
+      if(!any) break;
+    }
+
+    for(uint64_t w=0; w<words; ++w){
+      uint64_t bits = acc[w] & ~result[w];
+      while(bits){
+        int b = lowestBit(bits);
+        bits &= bits - 1;
+        uint64_t g = w * 64 + b;
+        ++st.candidates;
+        for(uint64_t i=s.offsets[g]; i<s.offsets[g+1]; ++i){
+          ++st.verified;
+          if(cq.matches(s.patterns[i])){ result[w] |= 1ULL << b; break; }
+        }
+      }
+    }
+  }
+}
+
+std::vector<uint32_t> PatternIndex::gameList(const std::vector<uint64_t>& result) const {
+  std::vector<uint32_t> out;
+  for(uint64_t w=0; w<words; ++w){
+    uint64_t bits = result[w];
+    while(bits){ int b = lowestBit(bits); bits &= bits - 1; out.push_back(static_cast<uint32_t>(w * 64 + b)); }
+  }
+  return out;
+}
+
+std::vector<uint32_t> PatternIndex::search(const CornerQuery& q, PatternSearchStats* stats) const {
+  PatternSearchStats st;
+  std::vector<uint64_t> result(words, 0);
+  std::vector<CornerQuery> variants(4);
+  variants[0] = q;
+  variants[1].care = transposeMask(q.care); variants[1].black = transposeMask(q.black); variants[1].white = transposeMask(q.white);
+  for(int i=0;i<2;++i){ variants[i+2] = variants[i]; std::swap(variants[i+2].black, variants[i+2].white); }
+  searchVariants(corners, variants, result, st);
+  if(stats) *stats = st;
+  return gameList(result);
+}
+
+std::vector<uint32_t> PatternIndex::search(const LocalQuery& q, PatternSearchStats* stats) const {
+  PatternSearchStats st;
+  std::vector<uint64_t> result(words, 0);
+  if(q.exact()){
+    // a fully specified window is found by the hash of its canonical form
+    LocalPattern p;
+    p.black = q.black; p.white = q.white; p.edge = q.edge;
+    p = p.canonical();
+    uint64_t h = p.hash();
+    const HashEntry* last = hashes + locals.count;
+    const HashEntry* it = std::lower_bound(hashes, last, h, [](const HashEntry& e, uint64_t v){ return e.hash < v; });
+    for(; it != last && it->hash == h; ++it){
+      ++st.candidates;
+      // verify against the game's sorted list, in case of a hash collision
+      const LocalPattern* first = locals.patterns + locals.offsets[it->game];
+      const LocalPattern* end = locals.patterns + locals.offsets[it->game + 1];
+      ++st.verified;
+      if(std::binary_search(first, end, p)) result[it->game >> 6] |= 1ULL << (it->game & 63);
+    }
+  } else {
+    std::vector<LocalQuery> variants;
+    for(int sym=0;sym<8;++sym){
+      LocalQuery t;
+      t.black = transformMask(q.black, sym); t.white = transformMask(q.white, sym);
+      t.edge = transformMask(q.edge, sym); t.care = transformMask(q.care, sym);
+      variants.push_back(t);
+      std::swap(t.black, t.white);
+      variants.push_back(t);
+    }
+    searchVariants(locals, variants, result, st);
+  }
+  if(stats) *stats = st;
+  return gameList(result);
+}
+
+} // namespace Corpus
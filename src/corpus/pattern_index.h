@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "corpus_replay.h"
+#include "mapped_file.h"
+
+namespace Corpus {
+
+// 7x7 corner region in the top-left frame: cell (row, col) is bit row*7+col, row 0 and
+// col 0 lying on the board edges. Black and white occupancy are separate 49-bit masks.
+struct CornerPattern {
+  static const int kSide = 7;
+  static const int kCells = kSide * kSide;
+  uint64_t black = 0;
+  uint64_t white = 0;
+
+  bool operator==(const CornerPattern& o) const { return black==o.black && white==o.white; }
+  bool operator<(const CornerPattern& o) const { return black!=o.black ? black<o.black : white<o.white; }
+
+  // Region of corner `corner` (0=top-left, 1=top-right, 2=bottom-left, 3=bottom-right)
+  // mapped into the top-left frame. Requires b.size() >= 7.
+  static CornerPattern extract(const Board& b, int corner);
+  CornerPattern transposed() const;
+  CornerPattern colorSwapped() const { CornerPattern p; p.black = white; p.white = black; return p; }
+  // Smallest of the transpose/colour-swap variants. Together with the corner mapping in
+  // extract() this makes the key invariant under all 8 symmetries and colour swap.
+  CornerPattern canonical() const;
+  int state(int cell) const { return (black >> cell & 1) ? 1 : (white >> cell & 1) ? 2 : 0; }
+};
+
+// Corner query with wildcards: cells outside `care` match anything.
+struct CornerQuery {
+  uint64_t black = 0;
+  uint64_t white = 0;
+  uint64_t care = 0;
+
+  // Up to 7 rows of up to 7 characters in the top-left frame:
+  // 'X'/'B' black, 'O'/'W' white, '.' empty, anything else is a wildcard.
+  static CornerQuery fromRows(const std::vector<std::string>& rows);
+  bool operator==(const CornerQuery& o) const { return black==o.black && white==o.white && care==o.care; }
+  bool matches(const CornerPattern& p) const {
+    return ((p.black ^ black) & care) == 0 && ((p.white ^ white) & care) == 0;
+  }
+  int state(int cell) const { return (black >> cell & 1) ? 1 : (white >> cell & 1) ? 2 : 0; }
+};
+
+// 5x5 window centred on a played stone, anywhere on the board: cell (row, col) is bit
+// row*5+col and the stone is cell 12. Cells past the board edge are set in `edge`.
+struct LocalPattern {
+  static const int kSide = 5;
+  static const int kCells = kSide * kSide;
+  uint32_t black = 0;
+  uint32_t white = 0;
+  uint32_t edge = 0;
+
+  bool operator==(const LocalPattern& o) const { return black==o.black && white==o.white && edge==o.edge; }
+  bool operator<(const LocalPattern& o) const {
+    if(black != o.black) return black < o.black;
+    return white != o.white ? white < o.white : edge < o.edge;
+  }
+
+  static LocalPattern extract(const Board& b, int x, int y);
+  // Window under board symmetry `sym` (0..7, 0 = identity).
+  LocalPattern transformed(int sym) const;
+  LocalPattern colorSwapped() const { LocalPattern p = *this; std::swap(p.black, p.white); return p; }
+  // Smallest of the 16 symmetry/colour-swap variants.
+  LocalPattern canonical() const;
+  uint64_t hash() const;
+  // 0 empty, 1 black, 2 white, 3 off the board
+  int state(int cell) const { return (black >> cell & 1) ? 1 : (white >> cell & 1) ? 2 : (edge >> cell & 1) ? 3 : 0; }
+};
+
+// Local query with wildcards: cells outside `care` match anything.
+struct LocalQuery {
+  uint32_t black = 0;
+  uint32_t white = 0;
+  uint32_t edge = 0;
+  uint32_t care = 0;
+
+  // Up to 5 rows of up to 5 characters with the played stone in the middle:
+  // 'X'/'B' black, 'O'/'W' white, '.' empty, '#' off the board, anything else is a wildcard.
+  static LocalQuery fromRows(const std::vector<std::string>& rows);
+  bool operator==(const LocalQuery& o) const { return black==o.black && white==o.white && edge==o.edge && care==o.care; }
+  bool matches(const LocalPattern& p) const {
+    return ((p.black ^ black) & care) == 0 && ((p.white ^ white) & care) == 0 && ((p.edge ^ edge) & care) == 0;
+  }
+  int state(int cell) const { return (black >> cell & 1) ? 1 : (white >> cell & 1) ? 2 : (edge >> cell & 1) ? 3 : 0; }
+  bool exact() const { return care == (1u << LocalPattern::kCells) - 1; }
+};
+
+// Collects the distinct canonical corner patterns and local windows around the moves of
+// every game during a corpus replay.
+class PatternIndexWriter : public IndexSink {
+public:
+  void begin(uint32_t gameCount, unsigned workers) override;
+  void onPosition(unsigned worker, uint32_t game, uint32_t moveNumber, const Board& b) override;
+  // Builds the (cell, colour) game bitmaps and writes the index file.
+  bool write(const std::string& path, unsigned threads = 0);
+
+private:
+  struct WorkerState {
+    uint32_t game = UINT32_MAX;
+    CornerPattern last[4];
+  };
+  std::vector<WorkerState> workers;
+  std::vector<std::vector<CornerPattern>> games;
+  std::vector<std::vector<LocalPattern>> locals;
+};
+
+struct PatternSearchStats {
+  uint64_t candidates = 0; // games surviving the bitmap intersection, summed over variants
+  uint64_t verified = 0;   // stored patterns compared against the query
+};
+
+// Inverted index over corner shapes and local windows. For each cell and cell state there
+// is a bitmap of games holding that state in some canonical pattern; a query ANDs the
+// bitmaps of its specified cells and then checks the candidates' pattern lists. Local
+// windows are also keyed by the hash of their canonical form, which answers fully
+// specified local queries without the bitmaps.
+class PatternIndex {
+public:
+  bool open(const std::string& path);
+  bool isOpen() const { return file.isOpen(); }
+  uint32_t gameCount() const { return nGames; }
+  uint64_t patternCount() const { return corners.count; }
+  uint64_t localCount() const { return locals.count; }
+
+  // Sorted ids of games that contain the query in any corner under any symmetry or colour swap.
+  std::vector<uint32_t> search(const CornerQuery& q, PatternSearchStats* stats = nullptr) const;
+  // Sorted ids of games in which some move left the query around it, under any symmetry
+  // or colour swap.
+  std::vector<uint32_t> search(const LocalQuery& q, PatternSearchStats* stats = nullptr) const;
+
+  // Hash table entry for one (game, local window) pair, as stored in the file.
+  struct HashEntry {
+    uint64_t hash;
+    uint32_t game;
+    uint32_t pad;
+  };
+
+private:
+  template <class Pattern>
+  struct Section {
+    uint64_t count = 0;
+    const uint64_t* bitmaps = nullptr; // per (cell, state), `words` each
+    const uint64_t* offsets = nullptr; // per game into patterns
+    const Pattern* patterns = nullptr;
+  };
+  template <class Pattern, class Query>
+  void searchVariants(const Section<Pattern>& s, const std::vector<Query>& variants,
+                      std::vector<uint64_t>& result, PatternSearchStats& st) const;
+  std::vector<uint32_t> gameList(const std::vector<uint64_t>& result) const;
+  MappedFile file;
+  uint32_t nGames = 0;
+  uint64_t words = 0;
+  Section<CornerPattern> corners;
+  Section<LocalPattern> locals;
+  const HashEntry* hashes = nullptr; // one per stored local pattern, sorted by hash
+};
+
+} // namespace Corpus
@@ -0,0 +1,192 @@
+#include "position_index.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <queue>
+#include <thread>
+
+namespace Corpus {
+
+namespace {
+
+const char kMagic[8] = {'G','O','P','O','S','I','D','X'};
+const uint32_t kVersion = 1;
+
+struct IndexHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t gameCount;
+  uint64_t entryCount;
+  uint64_t nameBytes;
+};
+
+bool hitLess(const PositionHit& a, const PositionHit& b){
+  if(a.hash != b.hash) return a.hash < b.hash;
+  if(a.game != b.game) return a.game < b.game;
+  return a.move < b.move;
+}
+
+uint64_t gameFingerprint(const SGF::Game& g){
+  // FNV-1a over the size and the move list; comments and metadata do not count
+  uint64_t h = 1469598103934665603ULL;
+  auto mix = [&h](uint64_t v){ h ^= v; h *= 1099511628211ULL; };
+  mix(static_cast<uint64_t>(g.SZ > 0 ? g.SZ : 19));
+  for(const auto &m : g.moves){
+    mix(m.pass ? 0xFFFFu : static_cast<uint64_t>((m.x & 0xFF) | ((m.y & 0xFF) << 8)));
+    mix(static_cast<uint64_t>(m.s));
+  }
+  return h;
+}
+
+} // namespace
+
+PositionIndexWriter::PositionIndexWriter(std::vector<std::string> gameNames): names(std::move(gameNames)) {}
+
+void PositionIndexWriter::begin(uint32_t gameCount, unsigned workers){
+  buffers.assign(workers, WorkerBuffer());
+  games.assign(gameCount, PositionGameInfo{0, 0, 0, 0, 0});
+  for(uint32_t i=0;i<gameCount;++i) games[i].canonical = i;
+  if(names.size() < gameCount) names.resize(gameCount);
+}
+
+void PositionIndexWriter::onGame(unsigned worker, uint32_t game, const SGF::Game& g){
+  (void)worker;
+  auto &info = games[game];
+  info.fingerprint = gameFingerprint(g);
+  info.moves = static_cast<uint32_t>(g.moves.size());
+  info.size = static_cast<uint32_t>(g.SZ > 0 ? g.SZ : 19);
+}
+
+void PositionIndexWriter::onPosition(unsigned worker, uint32_t game, uint32_t moveNumber, const Board& b){
+  auto &buf = buffers[worker];
+  uint64_t h = b.zobrist();
+  // Superko forbids repeats, so a hash only recurs right after a pass or a rejected move;
+  // keep the first occurrence per game.
+  if(buf.lastGame == game && buf.lastHash == h && moveNumber != 0) return;
+  buf.lastGame = game; buf.lastHash = h;
+  buf.hits.push_back({h, game, moveNumber});
+}
+
+uint64_t PositionIndexWriter::entryCount() const {
+  uint64_t n = 0;
+  for(const auto &b : buffers) n += b.hits.size();
+  return n;
+}
+
+bool PositionIndexWriter::write(const std::string& path){
+  // sort worker buffers concurrently; each is already grouped by game
+  {
+    std::vector<std::thread> sorters;
+    for(auto &b : buffers) sorters.emplace_back([&b]{ std::sort(b.hits.begin(), b.hits.end(), hitLess); });
+    for(auto &t : sorters) t.join();
+  }
+
+  // dedupe: games with equal fingerprints and sizes share the lowest id
+  std::vector<uint32_t> order;
+  for(uint32_t i=0;i<games.size();++i) if(games[i].size != 0) order.push_back(i);
+  std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b){
+    const auto &ga = games[a], &gb = games[b];
+    if(ga.fingerprint != gb.fingerprint) return ga.fingerprint < gb.fingerprint;
+    if(ga.size != gb.size) return ga.size < gb.size;
+    return a < b;
+  });
+  for(size_t i=1;i<order.size();++i){
+    const auto &prev = games[order[i-1]];
+    auto &cur = games[order[i]];
+    if(cur.fingerprint == prev.fingerprint && cur.size == prev.size) cur.canonical = prev.canonical;
+  }
+
+  std::ofstream out(path, std::ios::binary);
+  if(!out) return false;
+  IndexHeader hdr;
+  std::memcpy(hdr.magic, kMagic, sizeof(kMagic));
+  hdr.version = kVersion;
+  hdr.gameCount = static_cast<uint32_t>(games.size());
+  hdr.entryCount = entryCount();
+  hdr.nameBytes = 0;
+  for(size_t i=0;i<games.size();++i) hdr.nameBytes += names[i].size();
+  out.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+
+  // k-way merge of the sorted buffers straight into the file
+  using Cursor = std::pair<const PositionHit*, const PositionHit*>;
+  auto cmp = [](const Cursor& a, const Cursor& b){ return hitLess(*b.first, *a.first); };
+  std::priority_queue<Cursor, std::vector<Cursor>, decltype(cmp)> heap(cmp);
+  for(const auto &b : buffers) if(!b.hits.empty()) heap.push({b.hits.data(), b.hits.data() + b.hits.size()});
+  std::vector<PositionHit> chunk;
+  chunk.reserve(1 << 16);
+  while(!heap.empty()){
+    Cursor c = heap.top(); heap.pop();
+    chunk.push_back(*c.first);
+    if(++c.first != c.second) heap.push(c);
+    if(chunk.size() == chunk.capacity()){
+      out.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(chunk.size() * sizeof(PositionHit)));
+      chunk.clear();
+    }
+  }
+  out.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(chunk.size() * sizeof(PositionHit)));
+
+  out.write(reinterpret_cast<const char*>(games.data()), static_cast<std::streamsize>(games.size() * sizeof(PositionGameInfo)));
+  uint64_t off = 0;
+  for(size_t i=0;i<games.size();++i){ out.write(reinterpret_cast<const char*>(&off), sizeof(off)); off += names[i].size(); }
+  out.write(reinterpret_cast<const char*>(&off), sizeof(off));
+  for(size_t i=0;i<games.size();++i) out.write(names[i].data(), static_cast<std::streamsize>(names[i].size()));
+  return static_cast<bool>(out);
+}
+
+bool PositionIndex::open(const std::string& path){
+  if(!file.open(path)) return false;
+  const unsigned char* p = file.data();
+  size_t sz = file.size();
+  IndexHeader hdr;
+  if(sz < sizeof(hdr)){ file.close(); return false; }
+  std::memcpy(&hdr, p, sizeof(hdr));
+  if(std::memcmp(hdr.magic, kMagic, sizeof(kMagic)) != 0 || hdr.version != kVersion){ file.close(); return false; }
+  // compare counts against what is left of the file, so a corrupt header cannot overflow
+  size_t rest = sz - sizeof(hdr);
+  size_t tables = hdr.gameCount * sizeof(PositionGameInfo) + (static_cast<size_t>(hdr.gameCount) + 1) * sizeof(uint64_t);
+  if(tables > rest || hdr.entryCount > (rest - tables) / sizeof(PositionHit)){ file.close(); return false; }
+  rest -= tables + hdr.entryCount * sizeof(PositionHit);
+  if(hdr.nameBytes > rest){ file.close(); return false; }
+  nGames = hdr.gameCount;
+  nEntries = hdr.entryCount;
+  const unsigned char* q = p + sizeof(hdr);
+  hits = reinterpret_cast<const PositionHit*>(q);
+  q += nEntries * sizeof(PositionHit);
+  games = reinterpret_cast<const PositionGameInfo*>(q);
+  q += nGames * sizeof(PositionGameInfo);
+  nameOffsets = reinterpret_cast<const uint64_t*>(q);
+  q += (static_cast<size_t>(nGames) + 1) * sizeof(uint64_t);
+  nameData = reinterpret_cast<const char*>(q);
+  return true;
+}
+
+std::string PositionIndex::gameName(uint32_t game) const {
+  if(game >= nGames) return std::string();
+  return std::string(nameData + nameOffsets[game], nameData + nameOffsets[game+1]);
+}
+
+PositionIndex::Range PositionIndex::lookup(uint64_t hash) const {
+  const PositionHit* first = hits;
+  const PositionHit* last = hits + nEntries;
+  auto lo = std::lower_bound(first, last, hash, [](const PositionHit& h, uint64_t v){ return h.hash < v; });
+  auto hi = std::upper_bound(lo, last, hash, [](uint64_t v, const PositionHit& h){ return v < h.hash; });
+  return {lo, hi};
+}
+
+std::vector<PositionHit> PositionIndex::lookup(const Board& b) const {
+  std::vector<PositionHit> out;
+  auto r = lookup(b.zobrist());
+  for(auto it = r.first; it != r.second; ++it){
+    if(games[it->game].size == static_cast<uint32_t>(b.size())) out.push_back(*it);
+  }
+  return out;
+}
+
+std::vector<uint32_t> PositionIndex::uniqueGames() const {
+  std::vector<uint32_t> out;
+  for(uint32_t i=0;i<nGames;++i) if(games[i].size != 0 && games[i].canonical == i) out.push_back(i);
+  return out;
+}
+
+} // namespace Corpus
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "corpus_replay.h"
+#include "mapped_file.h"
+
+namespace Corpus {
+
+// One (position, game, move) occurrence. The on-disk index is an array of these
+// sorted by (hash, game, move), so a lookup is a binary search over mapped memory.
+struct PositionHit {
+  uint64_t hash;  // Board::zobrist() of the position
+  uint32_t game;  // index into the corpus file list
+  uint32_t move;  // number of moves played to reach the position (0 = empty board)
+};
+
+// Per-game record stored after the hit array.
+struct PositionGameInfo {
+  uint64_t fingerprint; // hash of board size and the full move sequence
+  uint32_t canonical;   // lowest game id with an identical record (itself if unique)
+  uint32_t moves;
+  uint32_t size;        // board size, 0 if the record failed to parse
+  uint32_t reserved;
+};
+
+// Collects positions during a corpus replay and writes the sorted index file.
+class PositionIndexWriter : public IndexSink {
+public:
+  explicit PositionIndexWriter(std::vector<std::string> gameNames);
+  void begin(uint32_t gameCount, unsigned workers) override;
+  void onGame(unsigned worker, uint32_t game, const SGF::Game& g) override;
+  void onPosition(unsigned worker, uint32_t game, uint32_t moveNumber, const Board& b) override;
+  // Sorts the per-worker buffers in parallel and streams a k-way merge to `path`.
+  bool write(const std::string& path);
+  uint64_t entryCount() const;
+
+private:
+  struct WorkerBuffer {
+    std::vector<PositionHit> hits;
+    uint32_t lastGame = UINT32_MAX;
+    uint64_t lastHash = 0;
+  };
+  std::vector<std::string> names;
+  std::vector<WorkerBuffer> buffers;
+  std::vector<PositionGameInfo> games;
+};
+
+// Read-only view of an index file written by PositionIndexWriter.
+class PositionIndex {
+public:
+  using Range = std::pair<const PositionHit*, const PositionHit*>;
+
+  bool open(const std::string& path);
+  bool isOpen() const { return file.isOpen(); }
+
+  uint32_t gameCount() const { return nGames; }
+  uint64_t entryCount() const { return nEntries; }
+  std::string gameName(uint32_t game) const;
+  const PositionGameInfo& game(uint32_t id) const { return games[id]; }
+
+  // Every occurrence of `hash`, ordered by game then move.
+  Range lookup(uint64_t hash) const;
+  // Occurrences of the board's position restricted to games of the same size.
+  std::vector<PositionHit> lookup(const Board& b) const;
+
+  // Dedupe helpers: identical records share the canonical id of their first copy.
+  uint32_t canonicalGame(uint32_t game) const { return games[game].canonical; }
+  bool isDuplicate(uint32_t game) const { return games[game].canonical != game; }
+  std::vector<uint32_t> uniqueGames() const;
+
+private:
+  MappedFile file;
+  uint32_t nGames = 0;
+  uint64_t nEntries = 0;
+  const PositionHit* hits = nullptr;
+  const PositionGameInfo* games = nullptr;
+  const uint64_t* nameOffsets = nullptr;
+  const char* nameData = nullptr;
+};
+
+} // namespace Corpus
@@ -0,0 +1,109 @@
+#include "packed_position.h"
+
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define GO_PACK_SSE2 1
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define GO_PACK_AVX2 1
+#endif
+
+namespace {
+
+// 16 stones -> 32 bits of 2-bit fields.
+inline uint32_t pack16(const Stone* p){
+#ifdef GO_PACK_SSE2
+  const __m128i* v = reinterpret_cast<const __m128i*>(p);
+  __m128i a = _mm_packs_epi32(_mm_loadu_si128(v), _mm_loadu_si128(v + 1));
+  __m128i b = _mm_packs_epi32(_mm_loadu_si128(v + 2), _mm_loadu_si128(v + 3));
+  __m128i bytes = _mm_packus_epi16(a, b);                       // one stone per byte
+  __m128i x = _mm_or_si128(bytes, _mm_srli_epi16(bytes, 6));    // pairs -> 4-bit nibble
+  x = _mm_and_si128(x, _mm_set1_epi16(0x000F));
+  x = _mm_or_si128(x, _mm_srli_epi32(x, 12));                   // nibble pairs -> byte
+  x = _mm_and_si128(x, _mm_set1_epi32(0x000000FF));
+  x = _mm_packs_epi32(x, x);
+  x = _mm_packus_epi16(x, x);
+  return static_cast<uint32_t>(_mm_cvtsi128_si32(x));
+#else
+  uint32_t w = 0;
+  for(int i=0;i<16;++i) w |= static_cast<uint32_t>(p[i] & 3) << (2 * i);
+  return w;
+#endif
+}
+
+// 8 stones from 16 bits of 2-bit fields.
+inline void unpack8(uint32_t bits, Stone* out){
+#ifdef GO_PACK_AVX2
+  __m256i v = _mm256_srlv_epi32(_mm256_set1_epi32(static_cast<int>(bits)), _mm256_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14));
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_and_si256(v, _mm256_set1_epi32(3)));
+#else
+  for(int i=0;i<8;++i) out[i] = static_cast<Stone>((bits >> (2 * i)) & 3);
+#endif
+}
+
+} // namespace
+
+static_assert(sizeof(Stone) == 4, "SIMD conversions assume int-sized Stone");
+
+void packStones(const Stone* points, int count, uint64_t* words){
+  int full = count & ~15;
+  for(int i=0;i<full;i+=16){
+    uint64_t half = pack16(points + i);
+    if(i & 16) words[i >> 5] |= half << 32;
+    else words[i >> 5] = half;
+  }
+  if(full < count){
+    uint64_t rest = 0;
+    for(int i=full;i<count;++i) rest |= static_cast<uint64_t>(points[i] & 3) << (2 * (i & 31));
+    if(full & 16) words[full >> 5] |= rest;
+    else words[full >> 5] = rest;
+  }
+}
+
+void unpackStones(const uint64_t* words, int count, Stone* points){
+  int full = count & ~7;
+  for(int i=0;i<full;i+=8) unpack8(static_cast<uint32_t>(words[i >> 5] >> ((i & 31) * 2)) & 0xFFFF, points + i);
+  for(int i=full;i<count;++i) points[i] = static_cast<Stone>((words[i >> 5] >> ((i & 31) * 2)) & 3);
+}
+
+bool PackedPosition::pack(const Board& b){
+  int n = b.size();
+  if(n < 1 || n * n > kMaxPoints) return false;
+  std::memset(words, 0, sizeof(words));
+  packStones(b.cells().data(), n * n, words);
+  size = static_cast<uint8_t>(n);
+  toMove = static_cast<uint8_t>(b.toMove());
+  ko = static_cast<int16_t>(b.koPoint());
+  prisoners[0] = static_cast<uint16_t>(b.captures(BLACK));
+  prisoners[1] = static_cast<uint16_t>(b.captures(WHITE));
+  return true;
+}
+
+bool PackedPosition::unpack(Board& out) const {
+  if(size == 0) return false;
+  int n = size;
+  std::vector<Stone> grid(n * n);
+  unpackStones(words, n * n, grid.data());
+  if(out.size() != n) out = Board(n);
+  out.setPosition(grid, static_cast<Stone>(toMove), ko, prisoners[0], prisoners[1]);
+  return true;
+}
+
+uint64_t PackedPosition::hash() const {
+  // multiply-xorshift fold over the point words, then the tail
+  uint64_t h = 0x9E3779B97F4A7C15ULL ^ size;
+  for(uint64_t w : words){ h = (h ^ w) * 0xBF58476D1CE4E5B9ULL; h ^= h >> 31; }
+  uint64_t tail = static_cast<uint64_t>(toMove) | static_cast<uint64_t>(static_cast<uint16_t>(ko)) << 8
+                | static_cast<uint64_t>(prisoners[0]) << 24 | static_cast<uint64_t>(prisoners[1]) << 40;
+  h = (h ^ tail) * 0x94D049BB133111EBULL;
+  return h ^ (h >> 29);
+}
+
+bool PackedPosition::operator==(const PackedPosition& o) const {
+  return std::memcmp(words, o.words, sizeof(words)) == 0 && size == o.size && toMove == o.toMove
+      && ko == o.ko && prisoners[0] == o.prisoners[0] && prisoners[1] == o.prisoners[1];
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "board.h"
+
+// Compact position: 2 bits per point (EMPTY=0, BLACK=1, WHITE=2) in row-major order,
+// plus side to move, simple-ko point and prisoners. Boards up to 19x19 fit; a 19x19
+// position is 96 bytes of points plus an 8-byte tail, trivially copyable, so it can be
+// memcpy'd into files, shared memory or hash-table slots. Unused bits are always zero,
+// which makes equality and hashing plain word compares.
+struct PackedPosition {
+  static constexpr int kWords = 12;
+  static constexpr int kMaxPoints = kWords * 32;
+
+  uint64_t words[kWords] = {};
+  uint8_t size = 0;        // board side, 0 for an empty (invalid) record
+  uint8_t toMove = EMPTY;  // Stone
+  int16_t ko = -1;         // point index, -1 when none
+  uint16_t prisoners[2] = {0, 0}; // stones captured by BLACK, WHITE
+
+  // Fails for boards larger than 19x19.
+  bool pack(const Board& b);
+  // Rebuilds `out` (resized to this position's board) with fresh hash/move history.
+  bool unpack(Board& out) const;
+
+  Stone at(int point) const { return static_cast<Stone>((words[point >> 5] >> ((point & 31) * 2)) & 3); }
+  uint64_t hash() const;
+
+  bool operator==(const PackedPosition& o) const;
+  bool operator!=(const PackedPosition& o) const { return !(*this == o); }
+};
+
+static_assert(sizeof(PackedPosition) == 104, "PackedPosition layout changed");
+
+// Bulk point conversions used by pack/unpack; SSE2/AVX2 when compiled in, scalar otherwise.
+void packStones(const Stone* points, int count, uint64_t* words);
+void unpackStones(const uint64_t* words, int count, Stone* points);
+
+namespace std {
+template<> struct hash<PackedPosition> {
+  size_t operator()(const PackedPosition& p) const { return static_cast<size_t>(p.hash()); }
+};
+}
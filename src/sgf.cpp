@@ -36,17 +36,23 @@ static std::string unescapeText(const std::string &in){
 namespace SGF {
 
 bool parse(const std::string& sgf, Board& out, double& komi_out, Game* game){
-  komi_out = 0.0;
-  if(game){ game->moves.clear(); game->PB.clear(); game->PW.clear(); game->RE.clear(); game->KM = 0.0; }
-  (void)out; // size not tracked here
+  Game g;
+  if(!parseGame(sgf, g)) return false;
+  komi_out = g.KM;
+  replay(g.moves, out);
+  if(game) *game = std::move(g);
+  return true;
+}
+
+bool parseGame(const std::string& sgf, Game& game){
+  game = Game();
   // find SZ
   auto szpos = sgf.find("SZ[");
   if(szpos!=std::string::npos){
     auto p = sgf.find(']', szpos+3);
     if(p!=std::string::npos){
       std::string val = sgf.substr(szpos+3, p-(szpos+3));
-      int v = std::stoi(val);
-      (void)v;
+      game.SZ = std::stoi(val);
     }
   }
   // find KM
@@ -55,17 +61,17 @@ bool parse(const std::string& sgf, Board& out, double& komi_out, Game* game){
     auto p = sgf.find(']', kmpos+3);
     if(p!=std::string::npos){
       std::string val = sgf.substr(kmpos+3, p-(kmpos+3));
-      komi_out = std::stod(val);
-      if(game) game->KM = komi_out;
+      game.KM = std::stod(val);
     }
   }
 
   // parse nodes and moves (main line only)
+  bool sawNode = false;
   size_t i=0; while(i<sgf.size()){
     if(sgf[i]==';'){
-      i++;
+      i++; sawNode = true;
       // parse all properties in this node
-      [[maybe_unused]] std::string nodePB, nodePW, nodeRE, nodeC;
+      std::string nodeC;
       char moveColor=0; std::string moveVal;
       while(i<sgf.size() && sgf[i]!=';' && sgf[i]!=')' && sgf[i] != '('){
         if(std::isspace((unsigned char)sgf[i])){ i++; continue; }
@@ -81,28 +87,45 @@ bool parse(const std::string& sgf, Board& out, double& komi_out, Game* game){
           if(prop=="B" || prop=="W"){
             moveColor = prop[0]; moveVal = val;
           } else if(prop=="KM"){
-            komi_out = std::stod(val);
-            if(game) game->KM = komi_out;
+            game.KM = std::stod(val);
           } else if(prop=="PB"){
-            if(game) game->PB = val;
+            game.PB = val;
           } else if(prop=="PW"){
-            if(game) game->PW = val;
+            game.PW = val;
           } else if(prop=="RE"){
-            if(game) game->RE = val;
+            game.RE = val;
+          } else if(prop=="DT"){
+            game.DT = val;
+          } else if(prop=="BR"){
+            game.BR = val;
+          } else if(prop=="WR"){
+            game.WR = val;
           } else if(prop=="C"){
             nodeC = val;
           }
+        } else if(prop.empty()) {
+          i++; // skip stray characters so malformed input cannot stall the scan
         }
       }
-      // apply move if any
+      // record move if any
       if(moveColor!=0){
         Stone s = (moveColor=='B')?BLACK:WHITE;
-        if(moveVal.size()==0){ out.pass(s); out.setLastMoveComment(nodeC); if(game) game->moves.push_back({-1,-1,s,true,nodeC}); }
-        else if(moveVal.size()>=2){ int x=letterToCoord(moveVal[0]); int y=letterToCoord(moveVal[1]); out.place(x,y,s); out.setLastMoveComment(nodeC); if(game) game->moves.push_back({x,y,s,false,nodeC}); }
+        if(moveVal.size()==0){ game.moves.push_back({-1,-1,s,true,nodeC}); }
+        else if(moveVal.size()>=2){ game.moves.push_back({letterToCoord(moveVal[0]),letterToCoord(moveVal[1]),s,false,nodeC}); }
       }
     } else i++;
   }
-  return true;
+  return sawNode;
+}
+
+void replay(const std::vector<Board::Move>& moves, Board& out, const MoveCallback& onMove){
+  size_t n = 0;
+  for(const auto &m : moves){
+    if(m.pass) out.pass(m.s);
+    else out.place(m.x, m.y, m.s);
+    out.setLastMoveComment(m.comment);
+    if(onMove) onMove(out, ++n);
+  }
 }
 
 std::string write(const Board& b, double komi){
@@ -115,10 +138,13 @@ std::string write(const Board& b, double komi){
 std::string write(const Game& g){
   std::ostringstream ss;
   ss << "(\n";
-  ss << ";GM[1]FF[4]SZ[19]KM["<<g.KM<<"]"; // SZ is not tracked here
+  ss << ";GM[1]FF[4]SZ["<<(g.SZ>0?g.SZ:19)<<"]KM["<<g.KM<<"]";
   if(!g.PB.empty()) ss << "PB["<<escapeText(g.PB)<<"]";
   if(!g.PW.empty()) ss << "PW["<<escapeText(g.PW)<<"]";
   if(!g.RE.empty()) ss << "RE["<<escapeText(g.RE)<<"]";
+  if(!g.DT.empty()) ss << "DT["<<escapeText(g.DT)<<"]";
+  if(!g.BR.empty()) ss << "BR["<<escapeText(g.BR)<<"]";
+  if(!g.WR.empty()) ss << "WR["<<escapeText(g.WR)<<"]";
   for(auto &m : g.moves){
     ss << ";" << (m.s==BLACK?"B":"W");
     if(m.pass) ss << "[]";
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <string>
 #include "board.h"
 
@@ -8,12 +9,23 @@ namespace SGF {
     std::string PB;
     std::string PW;
     std::string RE;
+    std::string DT; // date, usually YYYY-MM-DD
+    std::string BR; // ranks, e.g. "5d", "2k", "9p"
+    std::string WR;
     double KM = 0.0;
+    int SZ = 0; // 0 when the record has no SZ property
     std::vector<Board::Move> moves;
   };
 
+  // Called after each replayed move with the updated board and the 1-based move number.
+  using MoveCallback = std::function<void(const Board&, size_t)>;
+
   // Parse SGF content into board; returns true on success. If 'game' is provided it will be filled with metadata and moves.
   bool parse(const std::string& sgf, Board& out, double& komi_out, Game* game=nullptr);
+  // Parse metadata and main-line moves only, without touching a board. Fails if there is no node.
+  bool parseGame(const std::string& sgf, Game& game);
+  // Replay `moves` onto `out` the same way `parse` does, reporting every position reached.
+  void replay(const std::vector<Board::Move>& moves, Board& out, const MoveCallback& onMove = MoveCallback());
   // Write a minimal SGF string from the board's move history (deprecated) or from a Game
   std::string write(const Board& b, double komi=0.0);
   std::string write(const Game& g);
@@ -0,0 +1,82 @@
+// Int8 calibration for ConvPolicyValueNet weight files.
+//
+//   go_calibrate <in.gocn> <out.gocn> [--every K] <file.sgf | @list.txt>...
+//       replay the games, run every K-th position (default 1) through the float32
+//       network to record each convolution's input range, and write the weights with
+//       that calibration (file version 2) so the int8 path can be enabled on load
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ai/conv_net.h"
+#include "board.h"
+#include "sgf.h"
+
+static int usage(){
+  std::cerr << "usage: go_calibrate <in.gocn> <out.gocn> [--every K] <file.sgf | @list.txt>...\n";
+  return 2;
+}
+
+static bool collectInputs(const std::vector<std::string>& args, std::vector<std::string>& paths){
+  for(const auto &a : args){
+    if(!a.empty() && a[0]=='@'){
+      std::ifstream in(a.substr(1));
+      if(!in){ std::cerr << "cannot read list " << a.substr(1) << "\n"; return false; }
+      std::string line;
+      while(std::getline(in, line)){ if(!line.empty() && line.back()=='\r') line.pop_back(); if(!line.empty()) paths.push_back(line); }
+    } else paths.push_back(a);
+  }
+  return true;
+}
+
+int main(int argc, char** argv){
+  if(argc < 4) return usage();
+  size_t every = 1;
+  std::vector<std::string> args;
+  for(int i=3;i<argc;++i){
+    std::string a = argv[i];
+    if(a=="--every" && i+1<argc){ every = std::max<size_t>(1, std::stoul(argv[++i])); continue; }
+    args.push_back(a);
+  }
+  std::vector<std::string> paths;
+  if(!collectInputs(args, paths) || paths.empty()) return usage();
+
+  ConvPolicyValueNet net;
+  if(!net.load(argv[1])){ std::cerr << "cannot load network " << argv[1] << "\n"; return 1; }
+
+  // positions are calibrated in batches, grouped by board size
+  const size_t kBatch = 256;
+  std::map<int, std::vector<Board>> pending;
+  size_t positions = 0, games = 0, seen = 0;
+  auto flush = [&](std::vector<Board>& boards){
+    std::vector<const Board*> ptrs;
+    for(const auto& b : boards) ptrs.push_back(&b);
+    net.calibrate(ptrs);
+    positions += boards.size();
+    boards.clear();
+  };
+  for(const auto &p : paths){
+    std::ifstream in(p, std::ios::binary);
+    if(!in){ std::cerr << "cannot read " << p << "\n"; continue; }
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    SGF::Game g;
+    if(!SGF::parseGame(text, g)){ std::cerr << "cannot parse " << p << "\n"; continue; }
+    int N = g.SZ > 0 ? g.SZ : 19;
+    Board b(N);
+    auto& boards = pending[N];
+    SGF::replay(g.moves, b, [&](const Board& pos, size_t){
+      if(seen++ % every != 0) return;
+      boards.push_back(pos);
+      if(boards.size() == kBatch) flush(boards);
+    });
+    ++games;
+  }
+  for(auto& kv : pending) if(!kv.second.empty()) flush(kv.second);
+  if(!net.calibrated()){ std::cerr << "no positions to calibrate on\n"; return 1; }
+  if(!net.save(argv[2])){ std::cerr << "failed to write " << argv[2] << "\n"; return 1; }
+  std::cout << "games=" << games << " positions=" << positions << "\n";
+  return 0;
+}
@@ -0,0 +1,282 @@
+// Corpus indexing tool.
+//
+//   go_corpus index <prefix> [-j threads] <file.sgf | @list.txt>...
+//       replay every game on all cores and write <prefix>.pos, <prefix>.pat and <prefix>.meta
+//   go_corpus query <prefix> <game.sgf> [move]
+//       list the games that reached the position after `move` moves of game.sgf
+//   go_corpus dedupe <prefix>
+//       print groups of identical game records
+//   go_corpus pattern <prefix> [--local] <pattern.txt>
+//       list games containing a 7x7 corner shape; the file holds up to 7 rows in the
+//       top-left frame using X (black), O (white), . (empty) and ? (any). With --local
+//       it holds a 5x5 window centred on a played stone anywhere on the board, and
+//       # marks points off the board
+//   go_corpus select <prefix> [--player P] [--black P] [--white P] [--min-rank 5d]
+//                    [--winner B|W|draw] [--komi K | --komi-min K --komi-max K]
+//                    [--size N] [--from YYYYMMDD] [--to YYYYMMDD] [--min-moves N] [--max-moves N]
+//       list games whose metadata matches every given constraint
+//   go_corpus pack <archive> [-j threads] [--net weights.bin] <file.sgf | @list.txt>...
+//       compress games into a move-rank coded archive, ranking moves by the heuristic
+//       policy or by a ConvPolicyValueNet weight file; exits 1 if any game is left out
+//   go_corpus unpack <archive> <outdir> [-j threads] [--net weights.bin]
+//       decode an archive back to <outdir>/<n>.sgf with the model it was packed with
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "board.h"
+#include "corpus_replay.h"
+#include "game_codec.h"
+#include "metadata_store.h"
+#include "pattern_index.h"
+#include "position_index.h"
+#include "sgf.h"
+
+static int usage(){
+  std::cerr << "usage:\n"
+            << "  go_corpus index <prefix> [-j threads] <file.sgf | @list.txt>...\n"
+            << "  go_corpus query <prefix> <game.sgf> [move]\n"
+            << "  go_corpus dedupe <prefix>\n"
+            << "  go_corpus pattern <prefix> [--local] <pattern.txt>\n"
+            << "  go_corpus select <prefix> [--player P] [--black P] [--white P] [--min-rank R] [--winner B|W|draw]\n"
+            << "                   [--komi K] [--komi-min K] [--komi-max K] [--size N] [--from D] [--to D]\n"
+            << "                   [--min-moves N] [--max-moves N]\n"
+            << "  go_corpus pack <archive> [-j threads] [--net weights.bin] <file.sgf | @list.txt>...\n"
+            << "  go_corpus unpack <archive> <outdir> [-j threads] [--net weights.bin]\n";
+  return 2;
+}
+
+static bool collectInputs(const std::vector<std::string>& args, std::vector<std::string>& paths){
+  for(const auto &a : args){
+    if(!a.empty() && a[0]=='@'){
+      std::ifstream in(a.substr(1));
+      if(!in){ std::cerr << "cannot read list " << a.substr(1) << "\n"; return false; }
+      std::string line;
+      while(std::getline(in, line)){ if(!line.empty() && line.back()=='\r') line.pop_back(); if(!line.empty()) paths.push_back(line); }
+    } else paths.push_back(a);
+  }
+  return true;
+}
+
+static int cmdIndex(int argc, char** argv){
+  if(argc < 4) return usage();
+  std::string prefix = argv[2];
+  unsigned threads = 0;
+  std::vector<std::string> args;
+  for(int i=3;i<argc;++i){
+    std::string a = argv[i];
+    if(a=="-j" && i+1<argc){ threads = static_cast<unsigned>(std::stoul(argv[++i])); continue; }
+    args.push_back(a);
+  }
+  std::vector<std::string> paths;
+  if(!collectInputs(args, paths)) return 1;
+  auto t0 = std::chrono::steady_clock::now();
+  Corpus::PositionIndexWriter pos(paths);
+  Corpus::PatternIndexWriter pat;
+  Corpus::MetadataStoreWriter meta;
+  auto st = Corpus::replayCorpus(static_cast<uint32_t>(paths.size()), Corpus::fileSource(paths), {&pos, &pat, &meta}, threads);
+  if(!pos.write(prefix + ".pos")){ std::cerr << "failed to write " << prefix << ".pos\n"; return 1; }
+  if(!pat.write(prefix + ".pat", threads)){ std::cerr << "failed to write " << prefix << ".pat\n"; return 1; }
+  if(!meta.write(prefix + ".meta")){ std::cerr << "failed to write " << prefix << ".meta\n"; return 1; }
+  double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  std::cout << "games=" << st.games << " failed=" << st.failed << " positions=" << st.positions
+            << " entries=" << pos.entryCount() << " threads=" << Corpus::resolveThreads(threads)
+            << " time_s=" << secs << "\n";
+  return 0;
+}
+
+static int cmdQuery(int argc, char** argv){
+  if(argc < 4) return usage();
+  Corpus::PositionIndex idx;
+  if(!idx.open(std::string(argv[2]) + ".pos")){ std::cerr << "cannot open index " << argv[2] << ".pos\n"; return 1; }
+  std::ifstream in(argv[3]);
+  if(!in){ std::cerr << "cannot read " << argv[3] << "\n"; return 1; }
+  std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  SGF::Game g;
+  if(!SGF::parseGame(text, g)){ std::cerr << "cannot parse " << argv[3] << "\n"; return 1; }
+  size_t upto = argc > 4 ? std::stoul(argv[4]) : g.moves.size();
+  if(upto < g.moves.size()) g.moves.resize(upto);
+  Board b(g.SZ > 0 ? g.SZ : 19);
+  SGF::replay(g.moves, b);
+  auto t0 = std::chrono::steady_clock::now();
+  auto hits = idx.lookup(b);
+  double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+  for(const auto &h : hits) std::cout << idx.gameName(h.game) << " move " << h.move << "\n";
+  std::cerr << hits.size() << " hits in " << us << " us\n";
+  return 0;
+}
+
+static int cmdDedupe(int argc, char** argv){
+  if(argc < 3) return usage();
+  Corpus::PositionIndex idx;
+  if(!idx.open(std::string(argv[2]) + ".pos")){ std::cerr << "cannot open index " << argv[2] << ".pos\n"; return 1; }
+  std::map<uint32_t, std::vector<uint32_t>> groups;
+  for(uint32_t i=0;i<idx.gameCount();++i) if(idx.isDuplicate(i)) groups[idx.canonicalGame(i)].push_back(i);
+  for(const auto &kv : groups){
+    std::cout << idx.gameName(kv.first);
+    for(uint32_t d : kv.second) std::cout << " = " << idx.gameName(d);
+    std::cout << "\n";
+  }
+  std::cerr << idx.uniqueGames().size() << " unique of " << idx.gameCount() << " games\n";
+  return 0;
+}
+
+static int cmdPattern(int argc, char** argv){
+  if(argc < 4) return usage();
+  bool local = std::string(argv[3]) == "--local";
+  if(local && argc < 5) return usage();
+  const char* file = argv[local ? 4 : 3];
+  Corpus::PatternIndex pat;
+  if(!pat.open(std::string(argv[2]) + ".pat")){ std::cerr << "cannot open index " << argv[2] << ".pat\n"; return 1; }
+  Corpus::PositionIndex pos;
+  bool haveNames = pos.open(std::string(argv[2]) + ".pos");
+  std::ifstream in(file);
+  if(!in){ std::cerr << "cannot read " << file << "\n"; return 1; }
+  std::vector<std::string> rows;
+  std::string line;
+  while(std::getline(in, line)){ if(!line.empty() && line.back()=='\r') line.pop_back(); rows.push_back(line); }
+  auto t0 = std::chrono::steady_clock::now();
+  Corpus::PatternSearchStats st;
+  auto games = local ? pat.search(Corpus::LocalQuery::fromRows(rows), &st)
+                     : pat.search(Corpus::CornerQuery::fromRows(rows), &st);
+  double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+  for(uint32_t g : games) std::cout << (haveNames ? pos.gameName(g) : std::to_string(g)) << "\n";
+  std::cerr << games.size() << " games (" << st.candidates << " candidates) in " << ms << " ms\n";
+  return 0;
+}
+
+static int cmdSelect(int argc, char** argv){
+  if(argc < 3) return usage();
+  Corpus::MetadataStore meta;
+  if(!meta.open(std::string(argv[2]) + ".meta")){ std::cerr << "cannot open store " << argv[2] << ".meta\n"; return 1; }
+  Corpus::PositionIndex pos;
+  bool haveNames = pos.open(std::string(argv[2]) + ".pos");
+  Corpus::MetadataFilter f;
+  for(int i=3;i<argc;++i){
+    std::string opt = argv[i];
+    if(i+1 >= argc) return usage();
+    std::string v = argv[++i];
+    if(opt=="--player") f.player = v;
+    else if(opt=="--black") f.blackPlayer = v;
+    else if(opt=="--white") f.whitePlayer = v;
+    else if(opt=="--min-rank") f.minRank = Corpus::parseRank(v);
+    else if(opt=="--winner") f.winner = (v=="B"||v=="b") ? Corpus::Winner::Black : (v=="W"||v=="w") ? Corpus::Winner::White : Corpus::Winner::Draw;
+    else if(opt=="--komi") f.komiMin = f.komiMax = std::stod(v);
+    else if(opt=="--komi-min") f.komiMin = std::stod(v);
+    else if(opt=="--komi-max") f.komiMax = std::stod(v);
+    else if(opt=="--size") f.size = std::stoi(v);
+    else if(opt=="--from") f.dateFrom = static_cast<uint32_t>(std::stoul(v));
+    else if(opt=="--to") f.dateTo = static_cast<uint32_t>(std::stoul(v));
+    else if(opt=="--min-moves") f.minMoves = std::stoi(v);
+    else if(opt=="--max-moves") f.maxMoves = std::stoi(v);
+    else return usage();
+  }
+  auto t0 = std::chrono::steady_clock::now();
+  auto games = meta.select(f);
+  double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+  for(uint32_t g : games) std::cout << (haveNames ? pos.gameName(g) : std::to_string(g)) << "\n";
+  std::cerr << games.size() << " of " << meta.gameCount() << " games in " << ms << " ms\n";
+  return 0;
+}
+
+// Heuristic policy, or the network in `net` when given.
+static bool codecModel(const std::string& net, Corpus::CodecModel& model){
+  if(net.empty()){ model = Corpus::heuristicModel(); return true; }
+  if(Corpus::networkModel(net, model)) return true;
+  std::cerr << "cannot load network " << net << "\n";
+  return false;
+}
+
+static int cmdPack(int argc, char** argv){
+  if(argc < 4) return usage();
+  unsigned threads = 0;
+  std::string net;
+  std::vector<std::string> args;
+  for(int i=3;i<argc;++i){
+    std::string a = argv[i];
+    if(a=="-j" && i+1<argc){ threads = static_cast<unsigned>(std::stoul(argv[++i])); continue; }
+    if(a=="--net" && i+1<argc){ net = argv[++i]; continue; }
+    args.push_back(a);
+  }
+  Corpus::CodecModel model;
+  if(!codecModel(net, model)) return 1;
+  std::vector<std::string> paths;
+  if(!collectInputs(args, paths)) return 1;
+  std::vector<SGF::Game> games;
+  std::vector<std::string> gamePaths;
+  size_t textBytes = 0, unreadable = 0;
+  for(const auto &p : paths){
+    std::ifstream in(p, std::ios::binary);
+    if(!in){ std::cerr << "cannot read " << p << "\n"; ++unreadable; continue; }
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    SGF::Game g;
+    if(!SGF::parseGame(text, g)){ std::cerr << "cannot parse " << p << "\n"; ++unreadable; continue; }
+    textBytes += text.size();
+    games.push_back(std::move(g));
+    gamePaths.push_back(p);
+  }
+  auto t0 = std::chrono::steady_clock::now();
+  std::vector<size_t> skipped;
+  std::string archive = Corpus::compressArchive(games, model, threads, &skipped);
+  double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  std::ofstream out(argv[2], std::ios::binary);
+  if(!out.write(archive.data(), static_cast<std::streamsize>(archive.size()))){ std::cerr << "failed to write " << argv[2] << "\n"; return 1; }
+  for(size_t i : skipped) std::cerr << "skipped " << gamePaths[i] << ": unsupported board size\n";
+  std::cout << "games=" << games.size() - skipped.size() << " skipped=" << skipped.size() + unreadable << " sgf_bytes=" << textBytes
+            << " archive_bytes=" << archive.size() << " time_s=" << secs << "\n";
+  // the archive holds what could be packed, but it is not the whole input
+  return skipped.empty() && unreadable == 0 ? 0 : 1;
+}
+
+static int cmdUnpack(int argc, char** argv){
+  if(argc < 4) return usage();
+  unsigned threads = 0;
+  std::string net;
+  for(int i=4;i<argc;++i){
+    std::string a = argv[i];
+    if(a=="-j" && i+1<argc) threads = static_cast<unsigned>(std::stoul(argv[++i]));
+    else if(a=="--net" && i+1<argc) net = argv[++i];
+    else return usage();
+  }
+  Corpus::CodecModel model;
+  if(!codecModel(net, model)) return 1;
+  std::ifstream in(argv[2], std::ios::binary);
+  if(!in){ std::cerr << "cannot read " << argv[2] << "\n"; return 1; }
+  std::string archive((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  std::vector<SGF::Game> games;
+  auto t0 = std::chrono::steady_clock::now();
+  if(!Corpus::decompressArchive(archive, model, games, threads)){
+    std::cerr << "cannot decode " << argv[2] << " (corrupt, or packed with a different model)\n";
+    return 1;
+  }
+  double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  std::string dir = argv[3];
+  for(size_t i=0;i<games.size();++i){
+    std::string path = dir + "/" + std::to_string(i) + ".sgf";
+    if(!SGF::writeFile(path, games[i])){ std::cerr << "failed to write " << path << "\n"; return 1; }
+  }
+  std::cout << "games=" << games.size() << " time_s=" << secs << "\n";
+  return 0;
+}
+
+int main(int argc, char** argv){
+  if(argc < 2) return usage();
+  std::string cmd = argv[1];
+  try {
+    if(cmd=="index") return cmdIndex(argc, argv);
+    if(cmd=="query") return cmdQuery(argc, argv);
+    if(cmd=="dedupe") return cmdDedupe(argc, argv);
+    if(cmd=="pattern") return cmdPattern(argc, argv);
+    if(cmd=="select") return cmdSelect(argc, argv);
+    if(cmd=="pack") return cmdPack(argc, argv);
+    if(cmd=="unpack") return cmdUnpack(argc, argv);
+  } catch(const std::exception& e){
+    std::cerr << "error: " << e.what() << "\n";
+    return 1;
+  }
+  return usage();
+}
@@ -2,12 +2,15 @@
 #include <random>
 #include <array>
 
-Zobrist::Zobrist(int N): N(N), table(N*N) {
+Zobrist::Zobrist(int N): N(N), table(N*N), ko(N*N) {
   std::mt19937_64 rng(0x9e3779b97f4a7c15ULL); // deterministic seed for tests
   for(auto &e : table){
     e[0] = rng(); // BLACK
     e[1] = rng(); // WHITE
   }
+  // drawn after the stone keys so stone-only hashes stay unchanged
+  side = rng();
+  for(auto &k : ko) k = rng();
 }
 
 uint64_t Zobrist::hash(const std::vector<Stone>& grid) const {
@@ -10,8 +10,13 @@ class Zobrist {
 public:
   explicit Zobrist(int N);
   uint64_t hash(const std::vector<Stone>& grid) const;
+  // keys for the rest of the situation: WHITE to move, and the current ko point
+  uint64_t sideKey() const { return side; }
+  uint64_t koKey(int pos) const { return ko[pos]; }
 private:
   int N;
   // table[pos][colorIndex] where colorIndex: 0=BLACK,1=WHITE
   std::vector<std::array<uint64_t,2>> table;
+  uint64_t side = 0;
+  std::vector<uint64_t> ko;
 };
\ No newline at end of file
@@ -0,0 +1,91 @@
+#include "gtest/gtest.h"
+#include "ai/batch_evaluator.h"
+#include "ai/mcts.h"
+#include <atomic>
+#include <thread>
+
+namespace {
+// Value identifies the position (number of black stones); policy identifies the move.
+// Counts forward passes so tests can check that requests were batched.
+struct TaggingPV : PolicyValueNet {
+  std::atomic<int> batches{0};
+  std::vector<double> policy(const Board&, const std::vector<Board::Move>& legal) override {
+    std::vector<double> p;
+    for(auto& m : legal) p.push_back(m.pass ? 0.5 : 1.0 + m.x);
+    return p;
+  }
+  double value(const Board& b) override {
+    int n = 0;
+    for(int y=0;y<b.size();++y) for(int x=0;x<b.size();++x) n += b.get(x,y) == BLACK;
+    return n / 100.0;
+  }
+  void evaluateBatch(const std::vector<const Board*>& positions,
+                     const std::vector<const std::vector<Board::Move>*>& legal,
+                     std::vector<Evaluation>& out) override {
+    ++batches;
+    PolicyValueNet::evaluateBatch(positions, legal, out);
+  }
+};
+}
+
+TEST(BatchEvaluator, PostsEachResultToItsCaller) {
+  auto net = std::make_shared<TaggingPV>();
+  BatchEvaluator ev(net, 4, std::chrono::microseconds(2000));
+  std::atomic<int> wrong{0};
+  std::vector<std::thread> threads;
+  for(int t=0;t<4;++t){
+    threads.emplace_back([&, t]{
+      for(int i=0;i<50;++i){
+        Board b(9);
+        int stones = (t * 50 + i) % 40;
+        for(int k=0;k<stones;++k) b.place(k % 9, k / 9, BLACK);
+        auto legal = MCTS::legalMoves(b, WHITE);
+        auto r = ev.evaluate(b, legal);
+        if(r.value != stones / 100.0 || r.policy.size() != legal.size()) ++wrong;
+        else for(size_t j=0;j<legal.size();++j) if(!legal[j].pass && r.policy[j] != 1.0 + legal[j].x) ++wrong;
+      }
+    });
+  }
+  for(auto& th : threads) th.join();
+  EXPECT_EQ(wrong.load(), 0);
+  EXPECT_EQ(ev.positions(), 200u);
+  EXPECT_EQ(ev.batches(), static_cast<uint64_t>(net->batches.load()));
+}
+
+TEST(BatchEvaluator, SearchThreadsShareBatches) {
+  auto net = std::make_shared<TaggingPV>();
+  auto ev = std::make_shared<BatchEvaluator>(net, 8, std::chrono::microseconds(5000));
+  MCTSConfig cfg;
+  MCTS m(cfg);
+  m.setEvaluator(ev);
+  Board b(9);
+  auto mv = m.runParallel(b, BLACK, 400, 8);
+  EXPECT_TRUE(mv.pass || b.get(mv.x, mv.y) == EMPTY);
+  EXPECT_EQ(m.rootVisitCount(), 400);
+  EXPECT_GT(ev->averageBatch(), 1.0);
+}
+
+TEST(BatchEvaluator, EachNodeIsEvaluatedOnce) {
+  // threads reaching a leaf whose evaluation is in flight back off instead of asking again
+  for(int threads : {4, 8}){
+    auto ev = std::make_shared<BatchEvaluator>(std::make_shared<TaggingPV>(), 8, std::chrono::microseconds(2000));
+    MCTS m;
+    m.setEvaluator(ev);
+    Board b(9);
+    m.runParallel(b, BLACK, 400, threads);
+    EXPECT_EQ(m.rootVisitCount(), 400);
+    EXPECT_EQ(ev->positions(), m.treeNodes()) << threads << " threads";
+  }
+}
+
+TEST(BatchEvaluator, DagSearchFinishesOnRepeatedPositions) {
+  // on a tiny board shared nodes are soon reached by paths on which one of their moves
+  // repeats an earlier position; the search still has to spend every iteration
+  auto ev = std::make_shared<BatchEvaluator>(std::make_shared<TaggingPV>(), 1, std::chrono::microseconds(0));
+  MCTSConfig cfg; cfg.dag = true;
+  MCTS m(cfg);
+  m.setEvaluator(ev);
+  Board b(2);
+  m.runParallel(b, BLACK, 3000, 1);
+  EXPECT_EQ(m.rootVisitCount(), 3000);
+}
@@ -0,0 +1,231 @@
+#include "gtest/gtest.h"
+#include "ai/conv_net.h"
+#include "ai/gemm.h"
+#include "ai/mcts.h"
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <random>
+
+namespace {
+std::vector<float> randomMatrix(size_t n, std::mt19937& rng){
+  std::uniform_real_distribution<float> d(-1.0f, 1.0f);
+  std::vector<float> m(n);
+  for(float& v : m) v = d(rng);
+  return m;
+}
+
+// `moves` random placements alternating colours from an empty N x N board
+Board randomPosition(int N, int moves, std::mt19937& rng){
+  Board b(N);
+  Stone s = BLACK;
+  for(int i=0;i<moves;++i){
+    int x = rng() % N, y = rng() % N;
+    if(b.get(x, y) == EMPTY && b.place(x, y, s)) s = s == BLACK ? WHITE : BLACK;
+  }
+  return b;
+}
+
+void writeFloats(std::ofstream& out, std::initializer_list<float> v){
+  for(float f : v) out.write(reinterpret_cast<const char*>(&f), sizeof(f));
+}
+}
+
+TEST(Gemm, MatchesNaiveProduct) {
+  std::mt19937 rng(7);
+  for(auto dims : {std::vector<int>{1,1,1}, {4,16,9}, {5,37,13}, {32,81,288}, {3,200,300}}){
+    int M = dims[0], N = dims[1], K = dims[2];
+    auto A = randomMatrix(M * K, rng), B = randomMatrix(K * N, rng), C = randomMatrix(M * N, rng);
+    sgemm(M, N, K, A.data(), B.data(), C.data());
+    auto acc = C;
+    sgemm(M, N, K, A.data(), B.data(), acc.data(), true);
+    auto ref = C;
+    sgemmScalar(M, N, K, A.data(), B.data(), ref.data());
+    for(int i=0;i<M;++i) for(int j=0;j<N;++j){
+      double want = 0.0;
+      for(int k=0;k<K;++k) want += double(A[i * K + k]) * B[k * N + j];
+      ASSERT_NEAR(C[i * N + j], want, 1e-4 * K) << M << "x" << N << "x" << K;
+      ASSERT_NEAR(ref[i * N + j], want, 1e-4 * K);
+      ASSERT_NEAR(acc[i * N + j], 2 * want, 2e-4 * K);
+    }
+  }
+}
+
+TEST(ConvPVN, ZeroWeightsAreUninformative) {
+  ConvPolicyValueNet net;
+  Board b(9);
+  b.place(4,4,BLACK);
+  auto legal = MCTS::legalMoves(b, WHITE);
+  auto p = net.policy(b, legal);
+  ASSERT_EQ(p.size(), legal.size());
+  for(double v : p) EXPECT_NEAR(v, 1.0 / legal.size(), 1e-9);
+  EXPECT_DOUBLE_EQ(net.value(b), 0.5);
+}
+
+TEST(ConvPVN, ReadsTheDocumentedFileLayout) {
+  // one channel, no blocks: the input filter adds the own-stone plane at the centre tap
+  // and at the right-hand neighbour, and the policy head passes that plane through
+  std::string path = testing::TempDir() + "conv_layout.bin";
+  {
+    std::ofstream out(path, std::ios::binary);
+    out.write("GOCN", 4);
+    for(uint32_t v : {1u, 4u, 1u, 0u, 1u}) out.write(reinterpret_cast<const char*>(&v), sizeof(v));
+    std::vector<float> w(4 * 9, 0.0f);
+    w[1 * 3 + 1] = 1.0f; // own stones, centre
+    w[1 * 3 + 2] = 1.0f; // own stones, x + 1
+    for(float f : w) writeFloats(out, {f});
+    writeFloats(out, {0.0f});        // input.b
+    writeFloats(out, {1.0f, 0.0f});  // policy.w, policy.b
+    writeFloats(out, {0.0f, -5.0f}); // pass.w, pass.b
+    writeFloats(out, {0.0f, 0.0f});  // value1.w, value1.b
+    writeFloats(out, {0.0f, 2.0f});  // value2.w, value2.b
+  }
+  ConvPolicyValueNet net;
+  ASSERT_TRUE(net.load(path));
+  EXPECT_EQ(net.shape().channels, 1);
+  EXPECT_EQ(net.shape().blocks, 0);
+  Board b(5);
+  b.place(3,2,BLACK);
+  std::vector<float> logits, values;
+  net.forward({&b}, {BLACK}, logits, values);
+  ASSERT_EQ(logits.size(), 26u);
+  for(int i=0;i<25;++i) EXPECT_FLOAT_EQ(logits[i], i == 2 * 5 + 3 || i == 2 * 5 + 2 ? 1.0f : 0.0f) << i;
+  EXPECT_FLOAT_EQ(logits[25], -5.0f);
+  EXPECT_NEAR(values[0], 1.0 / (1.0 + std::exp(-2.0)), 1e-6);
+  // the same stones seen by WHITE are the opponent's
+  net.forward({&b}, {WHITE}, logits, values);
+  for(int i=0;i<25;++i) EXPECT_FLOAT_EQ(logits[i], 0.0f);
+  std::remove(path.c_str());
+}
+
+TEST(ConvPVN, SaveLoadRoundTrip) {
+  ConvPolicyValueNet::Shape s; s.channels = 8; s.blocks = 2; s.valueHidden = 6;
+  ConvPolicyValueNet a(s);
+  a.randomize(3);
+  std::string path = testing::TempDir() + "conv_roundtrip.bin";
+  ASSERT_TRUE(a.save(path));
+  auto b = loadConvPV(path);
+  ASSERT_TRUE(b != nullptr);
+  Board pos(9);
+  pos.place(2,2,BLACK); pos.place(6,6,WHITE);
+  auto legal = MCTS::legalMoves(pos, BLACK);
+  EXPECT_EQ(a.policy(pos, legal), b->policy(pos, legal));
+  EXPECT_EQ(a.value(pos), b->value(pos));
+
+  // truncated and foreign files are rejected
+  { std::ofstream out(path, std::ios::binary); out.write("GOCN", 4); }
+  EXPECT_EQ(loadConvPV(path), nullptr);
+  EXPECT_EQ(loadConvPV(testing::TempDir() + "missing.bin"), nullptr);
+  // a header promising far more weights than follow fails before allocating them
+  {
+    std::ofstream out(path, std::ios::binary);
+    out.write("GOCN", 4);
+    for(uint32_t v : {1u, 4u, 1024u, 256u, 4096u}) out.write(reinterpret_cast<const char*>(&v), sizeof(v));
+    for(int i=0;i<64;++i) writeFloats(out, {0.5f});
+  }
+  ConvPolicyValueNet c;
+  EXPECT_FALSE(c.load(path));
+  EXPECT_EQ(loadConvPV(path), nullptr);
+  std::remove(path.c_str());
+}
+
+TEST(ConvPVN, BatchMatchesSinglePositions) {
+  ConvPolicyValueNet net;
+  net.randomize(11);
+  Board a(9), b(9), c(7);
+  a.place(4,4,BLACK);
+  b.place(1,1,BLACK); b.place(2,1,WHITE);
+  c.place(3,3,WHITE);
+  auto la = MCTS::legalMoves(a, WHITE), lb = MCTS::legalMoves(b, BLACK), lc = MCTS::legalMoves(c, BLACK);
+  std::vector<PolicyValueNet::Evaluation> out;
+  net.evaluateBatch({&a, &c, &b}, {&la, &lc, &lb}, out);
+  ASSERT_EQ(out.size(), 3u);
+  const Board* boards[] = {&a, &c, &b};
+  const std::vector<Board::Move>* legal[] = {&la, &lc, &lb};
+  for(int i=0;i<3;++i){
+    auto p = net.policy(*boards[i], *legal[i]);
+    ASSERT_EQ(p.size(), out[i].policy.size());
+    double tot = 0.0;
+    for(size_t k=0;k<p.size();++k){ EXPECT_NEAR(p[k], out[i].policy[k], 1e-5); tot += p[k]; }
+    EXPECT_NEAR(tot, 1.0, 1e-9);
+    EXPECT_GE(out[i].value, 0.0);
+    EXPECT_LE(out[i].value, 1.0);
+  }
+}
+
+TEST(ConvPVN, ValueIsFromBlacksPerspective) {
+  ConvPolicyValueNet net;
+  net.randomize(5);
+  // colour-swapped positions with the other side to move look identical to the network
+  Board b(9), w(9);
+  b.place(3,3,BLACK); b.place(5,5,WHITE); b.place(4,4,BLACK);
+  w.place(3,3,WHITE); w.place(5,5,BLACK); w.place(4,4,WHITE);
+  EXPECT_EQ(b.toMove(), WHITE);
+  EXPECT_EQ(w.toMove(), BLACK);
+  EXPECT_NEAR(net.value(b), 1.0 - net.value(w), 1e-6);
+  EXPECT_NE(net.value(b), 0.5);
+}
+
+TEST(Gemm, Int8KernelMatchesScalar) {
+  std::mt19937 rng(9);
+  for(auto dims : {std::vector<int>{1,1,32}, {4,17,64}, {5,81,288}, {32,130,320}}){
+    int M = dims[0], N = dims[1], K = dims[2];
+    std::vector<int8_t> A(M * K);
+    std::vector<uint8_t> B(N * K);
+    for(auto& a : A) a = static_cast<int8_t>(static_cast<int>(rng() % 255) - 127);
+    for(auto& b : B) b = static_cast<uint8_t>(rng() % 128);
+    std::vector<int32_t> C(M * N), ref(M * N);
+    igemmU8S8(M, N, K, A.data(), B.data(), C.data());
+    igemmU8S8Scalar(M, N, K, A.data(), B.data(), ref.data());
+    EXPECT_EQ(C, ref) << M << "x" << N << "x" << K << " " << igemmKernel();
+  }
+}
+
+TEST(ConvPVN, Int8StaysCloseToFloat) {
+  ConvPolicyValueNet net;
+  net.randomize(21);
+  EXPECT_FALSE(net.setPrecision(ConvPolicyValueNet::Precision::Int8));
+  std::mt19937 rng(4);
+  std::vector<Board> calib, eval;
+  for(int i=0;i<64;++i) calib.push_back(randomPosition(9, rng() % 60, rng));
+  for(int i=0;i<32;++i) eval.push_back(randomPosition(9, rng() % 60, rng));
+  std::vector<const Board*> ptrs;
+  for(auto& b : calib) ptrs.push_back(&b);
+  net.calibrate(ptrs);
+  ASSERT_TRUE(net.calibrated());
+
+  double worstP = 0.0, worstV = 0.0;
+  for(auto& b : eval){
+    auto legal = MCTS::legalMoves(b, b.toMove());
+    net.setPrecision(ConvPolicyValueNet::Precision::Float32);
+    auto pf = net.policy(b, legal);
+    double vf = net.value(b);
+    ASSERT_TRUE(net.setPrecision(ConvPolicyValueNet::Precision::Int8));
+    auto pq = net.policy(b, legal);
+    double vq = net.value(b);
+    for(size_t k=0;k<pf.size();++k) worstP = std::max(worstP, std::fabs(pf[k] - pq[k]));
+    worstV = std::max(worstV, std::fabs(vf - vq));
+  }
+  // the tolerance documented in conv_net.h
+  EXPECT_LT(worstP, 0.01);
+  EXPECT_LT(worstV, 0.01);
+}
+
+TEST(ConvPVN, CalibrationIsSavedWithTheWeights) {
+  ConvPolicyValueNet::Shape s; s.channels = 8; s.blocks = 1; s.valueHidden = 4;
+  ConvPolicyValueNet a(s);
+  a.randomize(8);
+  std::mt19937 rng(1);
+  Board b = randomPosition(9, 30, rng);
+  a.calibrate({&b});
+  ASSERT_TRUE(a.setPrecision(ConvPolicyValueNet::Precision::Int8));
+  std::string path = testing::TempDir() + "conv_calibrated.bin";
+  ASSERT_TRUE(a.save(path));
+  ConvPolicyValueNet c;
+  ASSERT_TRUE(c.load(path));
+  EXPECT_TRUE(c.calibrated());
+  EXPECT_EQ(c.precision(), ConvPolicyValueNet::Precision::Float32);
+  ASSERT_TRUE(c.setPrecision(ConvPolicyValueNet::Precision::Int8));
+  EXPECT_EQ(a.value(b), c.value(b));
+  std::remove(path.c_str());
+}
@@ -0,0 +1,128 @@
+#include "gtest/gtest.h"
+#include "ai/feature_encoder.h"
+#include "ai/conv_net.h"
+#include "ai/mcts.h"
+#include <algorithm>
+#include <random>
+
+namespace {
+const int L = 2; // first liberty-class plane
+
+// Plays random legal moves (with the odd pass) on `b`, reporting each one.
+template <class F>
+void randomGame(Board& b, int moves, unsigned seed, F onMove){
+  std::mt19937 rng(seed);
+  Stone s = BLACK;
+  int N = b.size();
+  for(int i=0;i<moves;++i){
+    Board::Move m{-1, -1, s, true, std::string()};
+    if(rng() % 20 != 0){
+      for(int tries=0;tries<50;++tries){
+        int x = rng() % N, y = rng() % N;
+        if(b.get(x, y) == EMPTY && b.isLegal(x, y, s)){ m = {x, y, s, false, std::string()}; break; }
+      }
+    }
+    if(m.pass) b.pass(s); else b.place(m.x, m.y, s);
+    onMove(b, m);
+    s = s == BLACK ? WHITE : BLACK;
+  }
+}
+
+std::vector<float> planes(const FeatureEncoder& fe, Stone toMove, int sym = 0){
+  std::vector<float> out(FeatureEncoder::kPlanes * fe.size() * fe.size());
+  fe.write(toMove, out.data(), sym);
+  return out;
+}
+
+// `b` under symmetry `sym`
+Board transformed(const Board& b, int sym){
+  int N = b.size();
+  std::vector<Stone> g(N * N, EMPTY);
+  for(int y=0;y<N;++y) for(int x=0;x<N;++x) g[FeatureEncoder::transformPoint(x, y, N, sym)] = b.get(x, y);
+  int ko = b.koPoint();
+  Board t(N);
+  t.setPosition(g, b.toMove(), ko < 0 ? -1 : FeatureEncoder::transformPoint(ko % N, ko / N, N, sym));
+  return t;
+}
+}
+
+TEST(FeatureEncoder, IncrementalUpdatesMatchARebuild) {
+  for(int N : {9, 19}){
+    Board b(N);
+    FeatureEncoder inc;
+    ASSERT_TRUE(inc.reset(b));
+    int step = 0;
+    randomGame(b, N == 9 ? 150 : 300, N, [&](const Board& after, const Board::Move& m){
+      inc.play(after, m);
+      ASSERT_TRUE(inc.matches(after)) << "move " << step;
+      FeatureEncoder fresh;
+      fresh.reset(after);
+      auto a = planes(inc, after.toMove()), f = planes(fresh, after.toMove());
+      int NN = N * N;
+      // every plane agrees with a from-scratch encoding
+      for(int i=0;i<FeatureEncoder::kPlanes*NN;++i) ASSERT_EQ(a[i], f[i]) << "move " << step << " plane " << i / NN;
+      // stone planes from the mover's point of view
+      Stone me = after.toMove();
+      for(int i=0;i<NN;++i){
+        ASSERT_EQ(a[i], after.cells()[i] == me ? 1.0f : 0.0f);
+        ASSERT_EQ(a[NN + i], after.cells()[i] != me && after.cells()[i] != EMPTY ? 1.0f : 0.0f);
+      }
+      ++step;
+    });
+  }
+}
+
+TEST(FeatureEncoder, LibertyClassesAndCaptures) {
+  Board b(5);
+  FeatureEncoder fe;
+  fe.reset(b);
+  auto play = [&](int x, int y, Stone s){ ASSERT_TRUE(b.place(x, y, s)); fe.play(b, {x, y, s, false, std::string()}); };
+  play(0, 0, WHITE);                 // corner stone, 2 liberties
+  play(1, 0, BLACK);                 // white in atari
+  auto p = planes(fe, WHITE);
+  int NN = 25;
+  EXPECT_EQ(p[(L + 0) * NN + 0], 1.0f);      // own, 1 liberty
+  EXPECT_EQ(p[(L + 3 + 1) * NN + 1], 1.0f);  // opponent, 2 liberties
+  play(0, 1, BLACK);                 // captures
+  EXPECT_TRUE(fe.matches(b));
+  p = planes(fe, BLACK);
+  EXPECT_EQ(p[0], 0.0f);
+  EXPECT_EQ(p[(L + 2) * NN + 1], 1.0f);      // black stones now 3+ liberties
+  EXPECT_EQ(p[(L + 2) * NN + 5], 1.0f);
+  EXPECT_EQ(p[(L + 3) * NN + 0] + p[(L + 4) * NN + 0] + p[(L + 5) * NN + 0], 0.0f);
+}
+
+TEST(FeatureEncoder, SymmetricWritesMatchTransformedBoards) {
+  Board b(9);
+  randomGame(b, 40, 3, [](const Board&, const Board::Move&){});
+  FeatureEncoder fe;
+  fe.reset(b);
+  int canon = fe.canonicalSymmetry();
+  auto canonPlanes = planes(fe, b.toMove(), canon);
+  for(int sym=0;sym<8;++sym){
+    Board t = transformed(b, sym);
+    FeatureEncoder ft;
+    ft.reset(t);
+    EXPECT_EQ(planes(fe, b.toMove(), sym), planes(ft, t.toMove())) << sym;
+    EXPECT_EQ(planes(ft, t.toMove(), ft.canonicalSymmetry()), canonPlanes) << sym;
+  }
+}
+
+TEST(FeatureEncoder, DrivesAConvNet) {
+  ConvPolicyValueNet::Shape s;
+  s.channels = 8; s.blocks = 1; s.valueHidden = 4; s.inputPlanes = FeatureEncoder::kPlanes;
+  ConvPolicyValueNet net(s);
+  net.randomize(2);
+  std::string path = testing::TempDir() + "conv_features.bin";
+  ASSERT_TRUE(net.save(path));
+  ConvPolicyValueNet loaded;
+  ASSERT_TRUE(loaded.load(path));
+  EXPECT_EQ(loaded.shape().inputPlanes, FeatureEncoder::kPlanes);
+  Board b(9);
+  b.place(4,4,BLACK); b.place(3,4,WHITE);
+  auto legal = MCTS::legalMoves(b, BLACK);
+  auto p = net.policy(b, legal);
+  EXPECT_EQ(p, loaded.policy(b, legal));
+  EXPECT_NE(*std::max_element(p.begin(), p.end()), *std::min_element(p.begin(), p.end()));
+  std::remove(path.c_str());
+}
@@ -0,0 +1,140 @@
+#include "gtest/gtest.h"
+#include <random>
+#include "conv_net.h"
+#include "game_codec.h"
+#include "sgf.h"
+
+using namespace Corpus;
+
+static void expectSameGame(const SGF::Game& a, const SGF::Game& b){
+  EXPECT_EQ(a.PB, b.PB); EXPECT_EQ(a.PW, b.PW); EXPECT_EQ(a.RE, b.RE);
+  EXPECT_EQ(a.DT, b.DT); EXPECT_EQ(a.BR, b.BR); EXPECT_EQ(a.WR, b.WR);
+  EXPECT_EQ(a.KM, b.KM); EXPECT_EQ(a.SZ, b.SZ);
+  ASSERT_EQ(a.moves.size(), b.moves.size());
+  for(size_t i=0;i<a.moves.size();++i){
+    const auto &x = a.moves[i], &y = b.moves[i];
+    EXPECT_EQ(x.s, y.s) << "move " << i;
+    EXPECT_EQ(x.pass, y.pass) << "move " << i;
+    if(!x.pass){ EXPECT_EQ(x.x, y.x) << "move " << i; EXPECT_EQ(x.y, y.y) << "move " << i; }
+    EXPECT_EQ(x.comment, y.comment) << "move " << i;
+  }
+}
+
+// Self-play-like records: mostly the policy's favourite moves with some noise.
+static SGF::Game generatedGame(unsigned seed, PolicyValueNet& pv){
+  std::mt19937 rng(seed);
+  SGF::Game g;
+  g.SZ = 19; g.KM = 6.5; g.PB = "p" + std::to_string(seed % 7); g.PW = "p" + std::to_string(seed % 5);
+  g.RE = seed % 2 ? "B+R" : "W+3.5"; g.DT = "2024-01-0" + std::to_string(1 + seed % 9);
+  Board b(19);
+  Stone s = BLACK;
+  for(int n=0;n<120;++n){
+    std::vector<Board::Move> legal;
+    for(int y=0;y<19;y++) for(int x=0;x<19;x++) if(b.get(x,y)==EMPTY) legal.push_back({x,y,s,false,std::string()});
+    auto p = pv.policy(b, legal);
+    std::discrete_distribution<size_t> pick(p.begin(), p.end());
+    auto m = legal[pick(rng)];
+    b.place(m.x, m.y, s);
+    g.moves.push_back(m);
+    s = (s == BLACK ? WHITE : BLACK);
+  }
+  return g;
+}
+
+TEST(GameCodecTest, RoundTripsIrregularRecords){
+  SGF::Game g;
+  g.SZ = 9; g.KM = 5.5; g.PB = "Alice"; g.PW = "Bob"; g.RE = "W+R"; g.BR = "3d"; g.WR = "2k"; g.DT = "2020-02-02";
+  g.moves = {
+    {4,4,BLACK,false,"opening"},
+    {2,2,WHITE,false,""},
+    {4,4,WHITE,false,"occupied point"},   // not a candidate: coded raw
+    {6,6,WHITE,false,""},                 // same colour twice
+    {-1,-1,BLACK,true,""},
+    {-1,-1,WHITE,true,"both pass"},
+    {12,3,BLACK,false,""},                // off the board
+  };
+  auto pv = makeSimpleHeuristicPV();
+  std::string blob = encodeGame(g, *pv);
+  ASSERT_FALSE(blob.empty());
+  SGF::Game back;
+  ASSERT_TRUE(decodeGame(blob, *pv, back));
+  expectSameGame(g, back);
+}
+
+TEST(GameCodecTest, ArchiveRoundTripIsSmallerThanSgf){
+  auto pv = makeSimpleHeuristicPV();
+  std::vector<SGF::Game> games;
+  size_t sgfBytes = 0;
+  for(unsigned i=0;i<12;++i){
+    games.push_back(generatedGame(i, *pv));
+    sgfBytes += SGF::write(games.back()).size();
+  }
+  games.push_back(SGF::Game()); // empty record
+
+  std::string archive = compressArchive(games, heuristicModel(), 3);
+  EXPECT_LT(archive.size() * 3, sgfBytes);
+
+  std::vector<SGF::Game> back;
+  ASSERT_TRUE(decompressArchive(archive, heuristicModel(), back, 2));
+  ASSERT_EQ(back.size(), games.size());
+  for(size_t i=0;i<games.size();++i) expectSameGame(games[i], back[i]);
+}
+
+TEST(GameCodecTest, ArchiveSkipsGamesItCannotCode){
+  auto pv = makeSimpleHeuristicPV();
+  std::vector<SGF::Game> games = {generatedGame(1, *pv), generatedGame(2, *pv), generatedGame(3, *pv)};
+  games[1].SZ = 100;
+  EXPECT_TRUE(encodeGame(games[1], *pv).empty());
+
+  std::vector<size_t> skipped;
+  std::string archive = compressArchive(games, heuristicModel(), 2, &skipped);
+  ASSERT_EQ(skipped, std::vector<size_t>{1});
+
+  std::vector<SGF::Game> back;
+  ASSERT_TRUE(decompressArchive(archive, heuristicModel(), back));
+  ASSERT_EQ(back.size(), 2u);
+  expectSameGame(games[0], back[0]);
+  expectSameGame(games[2], back[1]);
+}
+
+TEST(GameCodecTest, RejectsOtherModelsAndCorruptArchives){
+  auto pv = makeSimpleHeuristicPV();
+  std::vector<SGF::Game> games = {generatedGame(42, *pv)};
+  std::string archive = compressArchive(games, heuristicModel(), 1);
+  std::vector<SGF::Game> back;
+
+  CodecModel other = heuristicModel();
+  other.id = 99;
+  EXPECT_FALSE(decompressArchive(archive, other, back));
+  EXPECT_FALSE(decompressArchive(archive.substr(0, archive.size() / 2), heuristicModel(), back));
+  EXPECT_FALSE(decompressArchive("not an archive", heuristicModel(), back));
+  EXPECT_TRUE(decompressArchive(archive, heuristicModel(), back));
+}
+
+TEST(GameCodecTest, NetworkModelRoundTripsAndIsTiedToItsWeights){
+  ConvPolicyValueNet::Shape shape;
+  shape.channels = 8; shape.blocks = 1; shape.valueHidden = 8;
+  ConvPolicyValueNet a(shape), b(shape);
+  a.randomize(1); b.randomize(2);
+  std::string pathA = ::testing::TempDir() + "test_codec_a.gocn", pathB = ::testing::TempDir() + "test_codec_b.gocn";
+  ASSERT_TRUE(a.save(pathA));
+  ASSERT_TRUE(b.save(pathB));
+  CodecModel netA, netB;
+  ASSERT_TRUE(networkModel(pathA, netA));
+  ASSERT_TRUE(networkModel(pathB, netB));
+  EXPECT_NE(netA.version, netB.version);
+  CodecModel missing;
+  EXPECT_FALSE(networkModel(::testing::TempDir() + "no_such_weights.gocn", missing));
+
+  auto pv = makeSimpleHeuristicPV();
+  std::vector<SGF::Game> games = {generatedGame(5, *pv), generatedGame(6, *pv)};
+  std::string archive = compressArchive(games, netA, 2);
+  std::vector<SGF::Game> back;
+  ASSERT_TRUE(decompressArchive(archive, netA, back, 2));
+  ASSERT_EQ(back.size(), 2u);
+  expectSameGame(games[0], back[0]);
+  expectSameGame(games[1], back[1]);
+  // other weights or the heuristic would rank moves differently
+  EXPECT_FALSE(decompressArchive(archive, netB, back));
+  EXPECT_FALSE(decompressArchive(archive, heuristicModel(), back));
+}
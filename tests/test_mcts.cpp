@@ -49,3 +49,236 @@ TEST(MCTSTest, VirtualLossBiasesSelection){
   EXPECT_TRUE(m.revertVirtualLossFromChildIndex(idx0, 5));
 }
 
+TEST(MCTSTest, MovesRootByAnyLegalMove){
+  Board b(9);
+  MCTSConfig cfg; cfg.iterations = 30;
+  MCTS m(cfg);
+  m.run(b, BLACK);
+  Board::Move mv{0,0,BLACK,false,std::string()};
+  EXPECT_TRUE(m.moveToChild(mv));
+  EXPECT_TRUE(b.place(0,0,BLACK));
+  EXPECT_EQ(m.rootHash(), b.zobrist());
+  // occupied point cannot become the root
+  EXPECT_FALSE(m.moveToChild(Board::Move{0,0,WHITE,false,std::string()}));
+}
+
+TEST(MCTSTest, TreeStaysWithinMemoryBudget){
+  Board b(19);
+  MCTSConfig cfg; cfg.memory_budget_mb = 1; cfg.pw_k = 8.0;
+  MCTS m(cfg);
+  auto mv = m.runParallel(b, BLACK, 3000, 2);
+  EXPECT_LE(m.treeBytes(), size_t(1) << 20);
+  EXPECT_GT(m.rootChildrenCount(), 0);
+  if(!mv.pass){ EXPECT_EQ(b.get(mv.x, mv.y), EMPTY); }
+  // tree reuse hands discarded siblings back to the arena
+  EXPECT_TRUE(m.moveToChild(mv));
+}
+
+TEST(MCTSTest, WideRootKeepsEdgeStatistics){
+  Board b(19);
+  MCTSConfig cfg; cfg.pw_k = 1e6; // expand every root move before descending
+  MCTS m(cfg);
+  m.runParallel(b, BLACK, 1000, 1);
+  ASSERT_EQ(m.rootChildrenCount(), 19*19 + 1);
+  int total = 0;
+  for(int i=0;i<m.rootChildrenCount();++i){
+    EXPECT_GE(m.childVisits(i), 1);
+    EXPECT_EQ(m.childVirtualLoss(i), 0);
+    total += m.childVisits(i);
+  }
+  EXPECT_EQ(total, 1000);
+  int e = m.selectRootEdge();
+  EXPECT_GE(e, 0);
+  EXPECT_LT(e, m.rootChildrenCount());
+}
+
+namespace {
+// Puts all policy mass on the first legal move and counts evaluations.
+struct CountingPV : PolicyValueNet {
+  int calls = 0;
+  std::vector<double> policy(const Board&, const std::vector<Board::Move>& legal) override {
+    ++calls;
+    std::vector<double> p(legal.size(), 0.0);
+    p[0] = 1.0;
+    return p;
+  }
+  double value(const Board&) override { return 0.5; }
+};
+}
+
+TEST(MCTSTest, PolicyIsEvaluatedOncePerNode){
+  Board b(9);
+  auto pv = std::make_shared<CountingPV>();
+  MCTS m;
+  m.setPV(pv);
+  m.runParallel(b, BLACK, 300, 1);
+  // one call per node whose edges were generated, never one per selection
+  EXPECT_GT(pv->calls, 0);
+  EXPECT_LE(pv->calls, 301);
+  ASSERT_GT(m.rootChildrenCount(), 0);
+  // the only move with any prior is expanded first and keeps it
+  EXPECT_DOUBLE_EQ(m.childPrior(0), 1.0);
+  for(int i=1;i<m.rootChildrenCount();++i) EXPECT_EQ(m.childPrior(i), 0.0);
+}
+
+namespace {
+// Uniform policy; whoever owns the centre of a 5x5 board wins.
+struct CentrePV : PolicyValueNet {
+  std::vector<double> policy(const Board&, const std::vector<Board::Move>& legal) override {
+    return std::vector<double>(legal.size(), 1.0 / legal.size());
+  }
+  double value(const Board& b) override { Stone c = b.get(2,2); return c == BLACK ? 1.0 : c == WHITE ? 0.0 : 0.5; }
+};
+}
+
+TEST(MCTSTest, PuctValuesMovesForThePlayerToMove){
+  MCTSConfig cfg; cfg.puct = true;
+  for(Stone s : {BLACK, WHITE}){
+    Board b(5);
+    MCTS m(cfg);
+    m.setPV(std::make_shared<CentrePV>());
+    // Q is read from the mover's side: both colours take the centre
+    auto mv = m.runParallel(b, s, 400, 1);
+    EXPECT_FALSE(mv.pass);
+    EXPECT_EQ(mv.x, 2);
+    EXPECT_EQ(mv.y, 2);
+  }
+}
+
+TEST(MCTSTest, PuctExpandsInPriorOrder){
+  Board b(9);
+  MCTSConfig cfg; cfg.puct = true;
+  MCTS m(cfg);
+  auto pv = std::make_shared<CountingPV>();
+  m.setPV(pv);
+  m.runParallel(b, BLACK, 200, 1);
+  ASSERT_GT(m.rootChildrenCount(), 0);
+  EXPECT_DOUBLE_EQ(m.childPrior(0), 1.0);
+  // with a constant value the search follows the policy
+  EXPECT_GT(m.childVisits(0), 150);
+}
+
+TEST(MCTSTest, RootNoiseKeepsPriorsNormalized){
+  Board b(9);
+  MCTSConfig cfg; cfg.puct = true; cfg.dirichlet_epsilon = 0.25;
+  MCTS m(cfg);
+  m.setPV(std::make_shared<CountingPV>());
+  m.runParallel(b, BLACK, 300, 1);
+  ASSERT_GT(m.rootChildrenCount(), 1);
+  // noise moves mass off the policy's only move onto the others
+  EXPECT_LT(m.childPrior(0), 1.0);
+  EXPECT_GE(m.childPrior(0), 0.75 - 1e-6);
+  double other = 0.0;
+  for(int i=1;i<m.rootChildrenCount();++i) other += m.childPrior(i);
+  EXPECT_GT(other, 0.0);
+  EXPECT_LE(m.childPrior(0) + other, 1.0 + 1e-4);
+}
+
+TEST(MCTSTest, EarlyStopBanksUnusedIterations){
+  Board b(9);
+  MCTSConfig cfg; cfg.puct = true; cfg.early_stop = true; cfg.early_stop_interval = 16;
+  MCTS m(cfg);
+  m.setPV(std::make_shared<CountingPV>());
+  auto mv = m.runParallel(b, BLACK, 800, 1);
+  const SearchStats& st = m.lastSearchStats();
+  EXPECT_TRUE(st.stoppedEarly);
+  EXPECT_GT(st.iterationsSaved, 0);
+  EXPECT_EQ(st.iterations + st.iterationsSaved, 800);
+  // the same move a full search settles on
+  MCTSConfig full = cfg; full.early_stop = false;
+  MCTS ref(full);
+  ref.setPV(std::make_shared<CountingPV>());
+  auto refMv = ref.runParallel(b, BLACK, 800, 1);
+  EXPECT_FALSE(ref.lastSearchStats().stoppedEarly);
+  EXPECT_EQ(ref.lastSearchStats().iterations, 800);
+  EXPECT_EQ(mv.x, refMv.x);
+  EXPECT_EQ(mv.y, refMv.y);
+  EXPECT_EQ(mv.pass, refMv.pass);
+}
+
+TEST(MCTSTest, KeepsTheTreeAcrossMoves){
+  Board b(9);
+  MCTS m;
+  auto mv = m.runParallel(b, BLACK, 500, 1);
+  EXPECT_EQ(m.lastSearchStats().inheritedVisits, 0);
+  ASSERT_FALSE(mv.pass);
+  int kept = 0;
+  for(int i=0;i<m.rootChildrenCount();++i){
+    Board::Move c = m.rootMove(i);
+    if(!c.pass && c.x == mv.x && c.y == mv.y) kept = m.childVisits(i);
+  }
+  ASSERT_GT(kept, 0);
+  // the caller only plays the move on its board; the search follows it into the subtree
+  ASSERT_TRUE(b.place(mv.x, mv.y, BLACK));
+  m.runParallel(b, WHITE, 200, 1);
+  EXPECT_EQ(m.lastSearchStats().inheritedVisits, kept);
+  EXPECT_EQ(m.rootVisitCount(), kept + 200);
+  EXPECT_EQ(m.rootHash(), b.zobrist());
+  // an unrelated position starts over
+  Board other(9);
+  ASSERT_TRUE(other.place(0, 0, BLACK));
+  m.runParallel(other, WHITE, 50, 1);
+  EXPECT_EQ(m.lastSearchStats().inheritedVisits, 0);
+}
+
+TEST(MCTSTest, SituationHashSeparatesSideAndKo){
+  Board a(9), b(9);
+  // same stones reached in a different order
+  a.place(2,2,BLACK); a.place(6,6,WHITE); a.place(2,6,BLACK); a.place(6,2,WHITE);
+  b.place(2,6,BLACK); b.place(6,2,WHITE); b.place(2,2,BLACK); b.place(6,6,WHITE);
+  EXPECT_EQ(a.situationHash(BLACK), b.situationHash(BLACK));
+  EXPECT_NE(a.situationHash(BLACK), a.situationHash(WHITE));
+  EXPECT_EQ(a.situationHash(BLACK) ^ a.situationHash(WHITE), b.situationHash(BLACK) ^ b.situationHash(WHITE));
+  // a ko capture: same stones as a position without the ko, different situation
+  std::vector<Stone> g(81, EMPTY);
+  auto at = [&](int x, int y) -> Stone& { return g[y*9+x]; };
+  at(1,0)=BLACK; at(0,1)=BLACK; at(1,2)=BLACK; at(2,1)=WHITE; at(3,0)=WHITE; at(3,2)=WHITE; at(4,1)=WHITE;
+  Board k(9); k.setPosition(g, BLACK, 1*9+2);
+  Board noKo(9); noKo.setPosition(g, BLACK, -1);
+  EXPECT_EQ(k.zobrist(), noKo.zobrist());
+  EXPECT_NE(k.situationHash(BLACK), noKo.situationHash(BLACK));
+}
+
+TEST(MCTSTest, DagSharesTranspositions){
+  Board b(5);
+  MCTSConfig tree; tree.pw_k = 4.0;
+  MCTSConfig dag = tree; dag.dag = true;
+  MCTS t(tree), d(dag);
+  t.runParallel(b, BLACK, 3000, 1);
+  auto mv = d.runParallel(b, BLACK, 3000, 1);
+  if(!mv.pass){ EXPECT_EQ(b.get(mv.x, mv.y), EMPTY); }
+  // transpositions reuse nodes instead of duplicating subtrees
+  EXPECT_LT(d.treeNodes(), t.treeNodes());
+  int total = 0;
+  for(int i=0;i<d.rootChildrenCount();++i) total += d.childVisits(i);
+  EXPECT_EQ(total, 3000);
+  // reusing the kept part of the DAG leaves shared nodes alone
+  ASSERT_TRUE(d.moveToChild(mv));
+  if(mv.pass) b.pass(BLACK); else ASSERT_TRUE(b.place(mv.x, mv.y, BLACK));
+  d.runParallel(b, WHITE, 500, 2);
+  EXPECT_GT(d.lastSearchStats().inheritedVisits, 0);
+  EXPECT_EQ(d.rootVisitCount(), d.lastSearchStats().inheritedVisits + 500);
+}
+
+TEST(MCTSTest, RaveCreditsMovesPlayedLater){
+  Board b(9);
+  MCTSConfig cfg; cfg.rave = true; cfg.playout_depth = 100;
+  MCTS m(cfg);
+  m.setPV(nullptr); // rollouts supply the AMAF moves
+  auto mv = m.runParallel(b, BLACK, 300, 1);
+  if(!mv.pass){ EXPECT_EQ(b.get(mv.x, mv.y), EMPTY); }
+  long visits = 0, amaf = 0;
+  for(int i=0;i<m.rootChildrenCount();++i){
+    EXPECT_EQ(m.childVirtualLoss(i), 0);
+    visits += m.childVisits(i);
+    amaf += m.childAmafVisits(i);
+  }
+  EXPECT_EQ(visits, 300);
+  // a move counts whenever BLACK plays it anywhere below, not only as the first move
+  EXPECT_GT(amaf, 2 * visits);
+  // plain UCT leaves the counters alone
+  MCTS plain;
+  plain.setPV(nullptr);
+  plain.runParallel(b, BLACK, 50, 1);
+  for(int i=0;i<plain.rootChildrenCount();++i) EXPECT_EQ(plain.childAmafVisits(i), 0);
+}
@@ -1,5 +1,9 @@
 #include "gtest/gtest.h"
 #include "ai/mcts.h"
+#include "ai/search_pool.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
 
 TEST(MCTSThreaded, CompletesAndReturnsLegalMove) {
   Board b(5);
@@ -21,3 +25,79 @@ TEST(MCTSThreaded, CompletesAndReturnsLegalMove) {
     EXPECT_EQ(b.get(mv.x,mv.y), EMPTY);
   }
 }
+
+TEST(MCTSThreaded, CountsEveryIterationWithoutLocks) {
+  Board b(9);
+  MCTSConfig cfg;
+  MCTS m(cfg);
+  m.runParallel(b, BLACK, 4000, 8);
+  int total = 0;
+  for (int i = 0; i < m.rootChildrenCount(); ++i) {
+    EXPECT_EQ(m.childVirtualLoss(i), 0);
+    total += m.childVisits(i);
+  }
+  EXPECT_EQ(total, 4000);
+}
+
+TEST(MCTSThreaded, SearchPoolJoinsEveryGeneration) {
+  SearchPool pool;
+  std::atomic<int> calls{0}, indexSum{0};
+  for(int gen=1; gen<=50; ++gen){
+    int n = 1 + gen % 4;
+    pool.run(n, [&](int i){ calls.fetch_add(1); indexSum.fetch_add(i); });
+  }
+  // every call of a generation has returned before run() does
+  int expectCalls = 0, expectSum = 0;
+  for(int gen=1; gen<=50; ++gen){ int n = 1 + gen % 4; expectCalls += n; expectSum += n*(n-1)/2; }
+  EXPECT_EQ(calls.load(), expectCalls);
+  EXPECT_EQ(indexSum.load(), expectSum);
+  EXPECT_EQ(pool.size(), 4);
+  EXPECT_EQ(pool.generations(), 50u);
+}
+
+TEST(MCTSThreaded, ReusesWorkersAcrossSearches) {
+  Board b(9);
+  MCTS m;
+  for(int i=0;i<5;++i){
+    m.runParallel(b, BLACK, 300, 3);
+    EXPECT_EQ(m.lastSearchStats().iterations, 300);
+    // the same root keeps its tree, so the visits accumulate
+    int total = 0;
+    for(int c=0;c<m.rootChildrenCount();++c) total += m.childVisits(c);
+    EXPECT_EQ(total, 300*(i+1));
+  }
+  EXPECT_EQ(m.workerThreads(), 3);
+}
+
+TEST(MCTSThreaded, PonderedVisitsCarryOverToTheNextSearch) {
+  Board b(9);
+  ASSERT_TRUE(b.place(4,4,BLACK));
+  MCTS m;
+  // think on WHITE's reply while the opponent is on the clock
+  m.startPondering(b, WHITE, 2);
+  EXPECT_TRUE(m.pondering());
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  m.stopPondering();
+  EXPECT_FALSE(m.pondering());
+  ASSERT_GT(m.rootChildrenCount(), 0);
+  // the opponent plays the most pondered reply
+  int best = 0;
+  for(int c=1;c<m.rootChildrenCount();++c) if(m.childVisits(c) > m.childVisits(best)) best = c;
+  int pondered = m.childVisits(best);
+  Board::Move reply = m.rootMove(best);
+  ASSERT_TRUE(m.moveToChild(reply));
+  if(reply.pass) b.pass(WHITE); else ASSERT_TRUE(b.place(reply.x, reply.y, WHITE));
+  m.runParallel(b, BLACK, 100, 2);
+  // the root's own visit count now covers the pondered simulations too
+  EXPECT_EQ(m.rootVisitCount(), pondered + 100);
+  EXPECT_EQ(m.lastSearchStats().iterations, 100);
+}
+
+TEST(MCTSThreaded, SearchStopsPondering) {
+  Board b(9);
+  MCTS m;
+  m.startPondering(b, BLACK, 2);
+  auto mv = m.runParallel(b, BLACK, 200, 2);
+  EXPECT_FALSE(m.pondering());
+  if(!mv.pass){ EXPECT_EQ(b.get(mv.x, mv.y), EMPTY); }
+}
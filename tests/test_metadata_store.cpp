@@ -0,0 +1,69 @@
+#include "gtest/gtest.h"
+#include "corpus_replay.h"
+#include "metadata_store.h"
+
+using namespace Corpus;
+
+TEST(MetadataStoreTest, ParsesResultRankAndDate){
+  EXPECT_EQ(resultWinner(packResult("B+R")), Winner::Black);
+  EXPECT_EQ(resultKind(packResult("B+Resign")), ResultKind::Resign);
+  EXPECT_EQ(resultKind(packResult("W+T")), ResultKind::Time);
+  EXPECT_DOUBLE_EQ(resultMargin(packResult("W+3.5")), 3.5);
+  EXPECT_EQ(resultWinner(packResult("Jigo")), Winner::Draw);
+  EXPECT_EQ(resultWinner(packResult("?")), Winner::Unknown);
+  EXPECT_EQ(parseRank("9p"), 18);
+  EXPECT_EQ(parseRank("5d"), 5);
+  EXPECT_EQ(parseRank("1k"), 0);
+  EXPECT_EQ(parseRank("15k"), -14);
+  EXPECT_EQ(parseRank(""), kNoRank);
+  EXPECT_EQ(parseDate("2024-05-01"), 20240501u);
+  EXPECT_EQ(parseDate("1999-10-03,04"), 19991003u);
+  EXPECT_EQ(parseDate("2003"), 20030000u);
+  EXPECT_EQ(parseDate("unknown"), 0u);
+}
+
+TEST(MetadataStoreTest, FiltersColumns){
+  std::vector<std::string> sgfs = {
+    "(;SZ[19]KM[7.5]PB[Alice]BR[6d]PW[Bob]WR[5d]RE[B+R]DT[2021-03-04];B[pd];W[dd])",
+    "(;SZ[19]KM[6.5]PB[Bob]BR[5d]PW[Carol]WR[2k]RE[W+2.5]DT[2019-01-01];B[pd])",
+    "(;SZ[9]KM[7.5]PB[Carol]BR[2k]PW[Alice]WR[6d]RE[W+R]DT[2022-07-10];B[ee];W[cc];B[gg])",
+    "(;SZ[19]KM[7.5]PB[Dave]BR[3d]PW[Alice]WR[7d]RE[B+1.5]DT[2023-12-31])",
+    "broken",
+  };
+  MetadataStoreWriter w;
+  replayCorpus(static_cast<uint32_t>(sgfs.size()), stringSource(sgfs), {&w}, 2);
+  std::string path = ::testing::TempDir() + "test_metadata_store.meta";
+  ASSERT_TRUE(w.write(path));
+  MetadataStore m;
+  ASSERT_TRUE(m.open(path));
+  EXPECT_EQ(m.gameCount(), 5u);
+  EXPECT_EQ(m.playerName(m.playerId("Carol")), "Carol");
+  EXPECT_EQ(m.playerId("Nobody"), UINT32_MAX);
+  EXPECT_EQ(m.moves[2], 3);
+  EXPECT_EQ(m.komi2[0], 15);
+
+  MetadataFilter all;
+  EXPECT_EQ(m.select(all), (std::vector<uint32_t>{0, 1, 2, 3}));
+
+  MetadataFilter strong; // both players 5d+ with komi 7.5
+  strong.minRank = parseRank("5d");
+  strong.komiMin = strong.komiMax = 7.5;
+  EXPECT_EQ(m.select(strong), (std::vector<uint32_t>{0}));
+
+  MetadataFilter alice;
+  alice.player = "Alice";
+  EXPECT_EQ(m.select(alice), (std::vector<uint32_t>{0, 2, 3}));
+  alice.whitePlayer = "Alice";
+  alice.winner = Winner::White;
+  EXPECT_EQ(m.select(alice), (std::vector<uint32_t>{2}));
+
+  MetadataFilter recent19;
+  recent19.size = 19;
+  recent19.dateFrom = 20200101;
+  recent19.minMoves = 1;
+  EXPECT_EQ(m.select(recent19), (std::vector<uint32_t>{0}));
+
+  MetadataFilter unknownPlayer;
+  unknownPlayer.blackPlayer = "Nobody";
+  EXPECT_TRUE(m.select(unknownPlayer).empty());
+}
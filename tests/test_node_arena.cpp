@@ -0,0 +1,60 @@
+#include "gtest/gtest.h"
+#include <cstdint>
+#include <algorithm>
+#include <thread>
+#include "ai/node_arena.h"
+
+TEST(NodeArenaTest, SizeClassesCoverRequests){
+  for(size_t b : {1u, 16u, 17u, 72u, 256u, 257u, 1448u, 2896u, 100000u}){
+    int c = NodeArena::classOf(b);
+    EXPECT_GE(NodeArena::classBytes(c), b);
+    if(c > 0){ EXPECT_LT(NodeArena::classBytes(c - 1), b); }
+  }
+}
+
+TEST(NodeArenaTest, RecyclesBlocksAndResetsInConstantTime){
+  NodeArena arena;
+  NodeArena::Cursor cur(arena);
+  void* a = cur.allocate(72);
+  void* b = cur.allocate(72);
+  ASSERT_NE(a, nullptr); ASSERT_NE(b, nullptr);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(a) % NodeArena::kAlign, 0u);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(b) % NodeArena::kAlign, 0u);
+  arena.recycle(a, 72);
+  EXPECT_EQ(cur.allocate(80), a); // same size class
+
+  for(int i=0;i<10000;++i) ASSERT_NE(cur.allocate(1448), nullptr);
+  size_t reserved = arena.bytesReserved();
+  EXPECT_GT(reserved, 10000u * 1448u);
+  arena.reset();
+  EXPECT_EQ(arena.bytesInUse(), 0u);
+  NodeArena::Cursor again(arena);
+  for(int i=0;i<10000;++i) ASSERT_NE(again.allocate(1448), nullptr);
+  EXPECT_EQ(arena.bytesReserved(), reserved); // chunks were reused
+}
+
+TEST(NodeArenaTest, StopsAtBudget){
+  NodeArena arena(2 * NodeArena::kChunkBytes);
+  NodeArena::Cursor cur(arena);
+  size_t got = 0;
+  while(cur.allocate(4096)) got += 4096;
+  EXPECT_LE(got, 2 * NodeArena::kChunkBytes);
+  EXPECT_GT(got, NodeArena::kChunkBytes);
+  EXPECT_LE(arena.bytesInUse(), arena.budgetBytes());
+}
+
+TEST(NodeArenaTest, CursorsAllocateConcurrently){
+  NodeArena arena;
+  std::vector<std::vector<void*>> got(4);
+  std::vector<std::thread> ts;
+  for(int t=0;t<4;++t) ts.emplace_back([&, t]{
+    NodeArena::Cursor cur(arena);
+    for(int i=0;i<20000;++i) got[t].push_back(cur.allocate(96));
+  });
+  for(auto &t : ts) t.join();
+  std::vector<void*> all;
+  for(auto &g : got) all.insert(all.end(), g.begin(), g.end());
+  std::sort(all.begin(), all.end());
+  EXPECT_EQ(std::adjacent_find(all.begin(), all.end()), all.end());
+  EXPECT_NE(all.front(), nullptr);
+}
@@ -0,0 +1,90 @@
+#include "gtest/gtest.h"
+#include <random>
+#include <unordered_set>
+#include "packed_position.h"
+
+static Board randomGame(int n, int moves, unsigned seed){
+  std::mt19937 rng(seed);
+  Board b(n);
+  Stone s = BLACK;
+  for(int i=0;i<moves;++i){
+    for(int tries=0;tries<20;++tries) if(b.place(rng() % n, rng() % n, s)) break;
+    s = s==BLACK ? WHITE : BLACK;
+  }
+  return b;
+}
+
+TEST(PackedPositionTest, TracksKoAndPrisoners){
+  Board b(5);
+  EXPECT_TRUE(b.place(1,0,BLACK)); EXPECT_TRUE(b.place(2,0,WHITE));
+  EXPECT_TRUE(b.place(0,1,BLACK)); EXPECT_TRUE(b.place(3,1,WHITE));
+  EXPECT_TRUE(b.place(1,2,BLACK)); EXPECT_TRUE(b.place(2,2,WHITE));
+  EXPECT_TRUE(b.pass(BLACK));      EXPECT_TRUE(b.place(1,1,WHITE));
+  EXPECT_EQ(b.koPoint(), -1);
+  EXPECT_TRUE(b.place(2,1,BLACK)); // captures the lone white stone: ko
+  EXPECT_EQ(b.koPoint(), b.idx(1,1));
+  EXPECT_EQ(b.captures(BLACK), 1);
+  EXPECT_EQ(b.toMove(), WHITE);
+
+  PackedPosition p;
+  ASSERT_TRUE(p.pack(b));
+  EXPECT_EQ(p.ko, b.idx(1,1));
+  EXPECT_EQ(p.prisoners[0], 1);
+  Board back;
+  ASSERT_TRUE(p.unpack(back));
+  EXPECT_EQ(back.koPoint(), b.idx(1,1));
+  EXPECT_EQ(back.captures(BLACK), 1);
+  EXPECT_EQ(back.toMove(), WHITE);
+  EXPECT_EQ(back.zobrist(), b.zobrist());
+
+  b.pass(WHITE);
+  EXPECT_EQ(b.koPoint(), -1);
+}
+
+TEST(PackedPositionTest, RoundTripsBoards){
+  for(int n : {5, 9, 13, 19}){
+    for(unsigned seed=0; seed<10; ++seed){
+      Board b = randomGame(n, n * n / 2 + static_cast<int>(seed), seed);
+      PackedPosition p;
+      ASSERT_TRUE(p.pack(b));
+      for(int y=0;y<n;++y) for(int x=0;x<n;++x) ASSERT_EQ(p.at(b.idx(x,y)), b.get(x,y));
+      Board back;
+      ASSERT_TRUE(p.unpack(back));
+      ASSERT_EQ(back.size(), n);
+      EXPECT_EQ(back.cells(), b.cells());
+      EXPECT_EQ(back.zobrist(), b.zobrist());
+      PackedPosition again;
+      ASSERT_TRUE(again.pack(back));
+      EXPECT_EQ(again, p);
+    }
+  }
+  PackedPosition big;
+  EXPECT_FALSE(big.pack(Board(21)));
+}
+
+TEST(PackedPositionTest, BulkConversionsMatchForAnyLength){
+  std::mt19937 rng(7);
+  for(int count : {1, 7, 8, 15, 16, 17, 31, 32, 33, 81, 169, 361, 384}){
+    std::vector<Stone> pts(count);
+    for(auto &s : pts) s = static_cast<Stone>(rng() % 3);
+    uint64_t words[PackedPosition::kWords] = {};
+    packStones(pts.data(), count, words);
+    for(int i=0;i<count;++i) ASSERT_EQ(static_cast<Stone>((words[i >> 5] >> ((i & 31) * 2)) & 3), pts[i]) << count << " " << i;
+    std::vector<Stone> back(count);
+    unpackStones(words, count, back.data());
+    EXPECT_EQ(back, pts);
+  }
+}
+
+TEST(PackedPositionTest, HashesAsSetKey){
+  std::unordered_set<PackedPosition> seen;
+  Board a = randomGame(19, 100, 1), b = randomGame(19, 100, 2);
+  PackedPosition pa, pb, pa2;
+  pa.pack(a); pb.pack(b); pa2.pack(a);
+  seen.insert(pa); seen.insert(pb); seen.insert(pa2);
+  EXPECT_EQ(seen.size(), 2u);
+  EXPECT_EQ(pa.hash(), pa2.hash());
+  EXPECT_NE(pa, pb);
+  pa2.toMove = pa.toMove == BLACK ? WHITE : BLACK;
+  EXPECT_NE(pa, pa2);
+}
@@ -0,0 +1,102 @@
+#include "gtest/gtest.h"
+#include "board.h"
+#include "corpus_replay.h"
+#include "pattern_index.h"
+
+using Corpus::CornerPattern;
+using Corpus::CornerQuery;
+
+TEST(PatternIndexTest, CanonicalFormIsSymmetryAndColorInvariant){
+  Board a(19), b(19), c(19);
+  a.place(3,2,BLACK); a.place(2,4,WHITE);    // top-left
+  b.place(15,16,BLACK); b.place(16,14,WHITE); // same shape rotated into the bottom-right
+  c.place(2,3,WHITE); c.place(4,2,BLACK);     // transposed, colours swapped
+  auto pa = CornerPattern::extract(a, 0).canonical();
+  EXPECT_EQ(pa, CornerPattern::extract(b, 3).canonical());
+  EXPECT_EQ(pa, CornerPattern::extract(c, 0).canonical());
+  EXPECT_FALSE(pa == CornerPattern::extract(a, 1).canonical());
+}
+
+TEST(PatternIndexTest, WildcardSearchAcrossCornersAndColors){
+  std::vector<std::string> sgfs = {
+    "(;SZ[19];B[dd];W[cc])",    // 4-4 black in the top-left, later a white stone inside
+    "(;SZ[19];B[pp])",          // 4-4 black in the bottom-right
+    "(;SZ[19];W[dp])",          // 4-4 white in the bottom-left
+    "(;SZ[19];B[dc])",          // 4-3 black in the top-left
+    "(;SZ[19];B[pc];W[jj])",    // 4-3 black in the top-right, transposed
+    "(;SZ[9];B[ee])",           // 9x9 corners overlap, centre stone at (4,4)
+  };
+  Corpus::PatternIndexWriter w;
+  Corpus::replayCorpus(static_cast<uint32_t>(sgfs.size()), Corpus::stringSource(sgfs), {&w}, 2);
+  std::string path = ::testing::TempDir() + "test_pattern_index.pat";
+  ASSERT_TRUE(w.write(path, 2));
+  Corpus::PatternIndex idx;
+  ASSERT_TRUE(idx.open(path));
+  EXPECT_EQ(idx.gameCount(), 6u);
+
+  // lone 4-4 stone with an empty 5x5 neighbourhood; the rest is wildcard
+  auto star = CornerQuery::fromRows({".....", ".....", ".....", "...X.", "....."});
+  EXPECT_EQ(idx.search(star), (std::vector<uint32_t>{0, 1, 2}));
+
+  // only the 4-3 point is specified
+  auto komoku = CornerQuery::fromRows({"???????", "???????", "???X???"});
+  EXPECT_EQ(idx.search(komoku), (std::vector<uint32_t>{3, 4}));
+
+  // fully empty 7x7 corner: every game starts there
+  auto empty = CornerQuery::fromRows(std::vector<std::string>(7, "......."));
+  Corpus::PatternSearchStats st;
+  EXPECT_EQ(idx.search(empty, &st).size(), 6u);
+  EXPECT_GT(st.candidates, 0u);
+
+  // a shape nobody played
+  auto none = CornerQuery::fromRows({"XO", "OX"});
+  EXPECT_TRUE(idx.search(none).empty());
+}
+
+TEST(PatternIndexTest, LocalCanonicalFormIsSymmetryAndColorInvariant){
+  Board a(19), b(19), c(9);
+  a.place(9,9,BLACK); a.place(10,9,WHITE); a.place(10,8,BLACK);
+  b.place(4,4,WHITE); b.place(4,5,BLACK); b.place(5,5,WHITE); // rotated, colours swapped
+  c.place(0,0,BLACK);
+  auto pa = Corpus::LocalPattern::extract(a, 10, 8).canonical();
+  EXPECT_EQ(pa, Corpus::LocalPattern::extract(b, 5, 5).canonical());
+  EXPECT_EQ(pa.hash(), Corpus::LocalPattern::extract(b, 5, 5).canonical().hash());
+  auto corner = Corpus::LocalPattern::extract(c, 0, 0);
+  EXPECT_EQ(corner.edge, 0x318fffu); // rows 0-1 and columns 0-1
+  EXPECT_EQ(corner.canonical(), Corpus::LocalPattern::extract(c, 0, 0).transformed(3).canonical());
+}
+
+TEST(PatternIndexTest, LocalSearchFindsShapesAnywhere){
+  std::vector<std::string> sgfs = {
+    "(;SZ[19];B[jj];W[kj];B[ki])",       // hane: black at ki, black diagonal, white below
+    "(;SZ[19];B[ee];W[ef];B[ff])",       // same shape rotated elsewhere
+    "(;SZ[19];W[pp];B[qp];W[qo])",       // colours swapped
+    "(;SZ[19];B[jj];W[kk];B[ki])",       // no white stone next to the move
+    "(;SZ[9];B[aa])",                    // lone corner stone
+    "(;SZ[19];B[jj];W[kj];W[lk];B[ki])", // hane with an extra stone in the window
+  };
+  Corpus::PatternIndexWriter w;
+  Corpus::replayCorpus(static_cast<uint32_t>(sgfs.size()), Corpus::stringSource(sgfs), {&w}, 2);
+  std::string path = ::testing::TempDir() + "test_pattern_local.pat";
+  ASSERT_TRUE(w.write(path, 2));
+  Corpus::PatternIndex idx;
+  ASSERT_TRUE(idx.open(path));
+  EXPECT_GT(idx.localCount(), 0u);
+
+  auto hane = Corpus::LocalQuery::fromRows({"?????", "?????", "??X??", "?XO??"});
+  EXPECT_FALSE(hane.exact());
+  EXPECT_EQ(idx.search(hane), (std::vector<uint32_t>{0, 1, 2, 5}));
+
+  // fully specified windows go through the hash table
+  auto exact = Corpus::LocalQuery::fromRows({".....", ".....", "..X..", ".XO..", "....."});
+  ASSERT_TRUE(exact.exact());
+  Corpus::PatternSearchStats st;
+  EXPECT_EQ(idx.search(exact, &st), (std::vector<uint32_t>{0, 1, 2}));
+  EXPECT_EQ(st.candidates, 3u);
+
+  auto corner = Corpus::LocalQuery::fromRows({"#####", "#####", "##X..", "##...", "##..."});
+  EXPECT_EQ(idx.search(corner), (std::vector<uint32_t>{4}));
+  auto edge = Corpus::LocalQuery::fromRows({"?????", "?????", "#?X??"});
+  EXPECT_EQ(idx.search(edge), (std::vector<uint32_t>{4}));
+  EXPECT_TRUE(idx.search(Corpus::LocalQuery::fromRows({"?????", "?????", "?OXO?"})).empty());
+}
@@ -0,0 +1,136 @@
+#include "gtest/gtest.h"
+#include "ai/playout.h"
+#include "ai/mcts.h"
+#include "rules.h"
+#include <set>
+
+TEST(PlayoutTest, XoshiroIsDeterministicAndInRange){
+  Xoshiro256 a(42), b(42), c(43);
+  bool differs = false;
+  for(int i=0;i<1000;++i){
+    uint64_t x = a.next();
+    EXPECT_EQ(x, b.next());
+    if(x != c.next()) differs = true;
+  }
+  EXPECT_TRUE(differs);
+  std::set<uint32_t> seen;
+  for(int i=0;i<1000;++i){
+    uint32_t v = a.below(7);
+    ASSERT_LT(v, 7u);
+    seen.insert(v);
+  }
+  EXPECT_EQ(seen.size(), 7u);
+}
+
+TEST(PlayoutTest, AreaScoreCountsStonesAndSurroundedRegions){
+  // black wall on column 2, white on column 3 of a 5x5 board
+  Board b(5);
+  for(int y=0;y<5;++y){ b.place(2, y, BLACK); b.place(3, y, WHITE); }
+  PlayoutEngine e;
+  ASSERT_TRUE(e.reset(b));
+  EXPECT_EQ(e.areaScore(), 15 - 10);
+  EXPECT_EQ(e.at(2, 0), BLACK);
+  EXPECT_EQ(e.at(4, 4), EMPTY);
+  EXPECT_FALSE(e.reset(Board(21)));
+}
+
+TEST(PlayoutTest, MovesReplayOnBoard){
+  // The engine's moves must be legal on Board and leave the same position, captures included
+  for(auto sampling : {PlayoutEngine::Sampling::Weighted, PlayoutEngine::Sampling::Uniform}) for(int N : {5, 9, 13}){
+    for(uint64_t seed=1; seed<=10; ++seed){
+      Board b(N);
+      PlayoutEngine e;
+      ASSERT_TRUE(e.reset(b, sampling));
+      Xoshiro256 rng(seed);
+      double z = e.run(BLACK, rng, 2 * N * N);
+      EXPECT_TRUE(z == 0.0 || z == 1.0);
+      ASSERT_GT(e.movesPlayed(), 0);
+      for(int i=0;i<e.movesPlayed();++i){
+        int p = e.playedPoint(i);
+        if(b.place(p % N, p / N, e.playedColour(i))) continue;
+        // the engine plays simple ko: a repeat of an earlier position is legal without history
+        Board fresh(N);
+        fresh.setPosition(b.cells(), e.playedColour(i), b.koPoint());
+        ASSERT_TRUE(fresh.place(p % N, p / N, e.playedColour(i))) << "N " << N << " seed " << seed << " move " << i;
+        b = fresh;
+      }
+      for(int y=0;y<N;++y) for(int x=0;x<N;++x) ASSERT_EQ(e.at(x, y), b.get(x, y));
+    }
+  }
+}
+
+TEST(PlayoutTest, RunsToTheEndWithoutFillingEyes){
+  // With no move cap the game ends in two passes, leaving every empty point an eye or a
+  // point neither side may play; the result agrees with the engine's own count.
+  for(auto sampling : {PlayoutEngine::Sampling::Weighted, PlayoutEngine::Sampling::Uniform}){
+    Board b(9);
+    PlayoutEngine e;
+    ASSERT_TRUE(e.reset(b, sampling));
+    Xoshiro256 rng(7);
+    double z = e.run(BLACK, rng, 100000, 6.5);
+    EXPECT_EQ(z, e.areaScore() > 6.5 ? 1.0 : 0.0);
+    int empty = 0;
+    for(int y=0;y<9;++y) for(int x=0;x<9;++x) if(e.at(x, y) == EMPTY) ++empty;
+    EXPECT_GT(empty, 0);
+    EXPECT_LT(empty, 30);
+  }
+}
+
+TEST(PlayoutTest, WeightedSamplingFollowsThePriorHeuristic){
+  // first moves on an empty board: weights 160 at the centre and 69 in a corner; a
+  // stone next to a point adds 32
+  auto firstMoves = [](PlayoutEngine::Sampling sampling, const Board& b, int x, int y){
+    PlayoutEngine e;
+    Xoshiro256 rng(11);
+    int hits = 0;
+    for(int i=0;i<50000;++i){
+      e.reset(b, sampling);
+      e.run(BLACK, rng, 1);
+      hits += e.at(x, y) == BLACK;
+    }
+    return hits;
+  };
+  Board empty(9);
+  int centre = firstMoves(PlayoutEngine::Sampling::Weighted, empty, 4, 4);
+  int corner = firstMoves(PlayoutEngine::Sampling::Weighted, empty, 0, 0);
+  EXPECT_GT(centre * 10, corner * 19);
+  EXPECT_LT(centre * 10, corner * 28);
+  int uniformCentre = firstMoves(PlayoutEngine::Sampling::Uniform, empty, 4, 4);
+  int uniformCorner = firstMoves(PlayoutEngine::Sampling::Uniform, empty, 0, 0);
+  EXPECT_GT(uniformCentre * 10, uniformCorner * 7);
+  EXPECT_GT(uniformCorner * 10, uniformCentre * 7);
+  // a white stone at the 1-1 point: the corner goes from 69 to 101
+  Board near(9);
+  near.place(1, 1, WHITE);
+  int nearCorner = firstMoves(PlayoutEngine::Sampling::Weighted, near, 0, 0);
+  EXPECT_GT(nearCorner * 10, corner * 12);
+}
+
+TEST(PlayoutTest, SearchUsesEngineForRollouts){
+  MCTSConfig cfg;
+  cfg.rave = true;
+  MCTS m(cfg);
+  m.setPV(nullptr);
+  Board b(9);
+  std::mt19937_64 rng(3);
+  std::vector<NodeMove> played;
+  double z = m.rollout(b, BLACK, rng, &played);
+  EXPECT_TRUE(z == 0.0 || z == 1.0);
+  ASSERT_FALSE(played.empty());
+  EXPECT_EQ(played[0].color, BLACK);
+  for(const auto& mv : played){ EXPECT_EQ(mv.pass, 0); EXPECT_GE(mv.point, 0); EXPECT_LT(mv.point, 81); }
+}
+
+TEST(PlayoutTest, DefaultSearchValuesLeavesOnEngine){
+  // no network configured: every simulation is a PlayoutEngine rollout
+  MCTS m;
+  Board b(9);
+  m.runParallel(b, BLACK, 200, 2);
+  EXPECT_EQ(m.lastSearchStats().playouts, 200);
+  EXPECT_EQ(m.lastSearchStats().iterations, 200);
+  // a network takes over valuing leaves
+  MCTS withNet;
+  withNet.setPV(makeSimpleHeuristicPV());
+  withNet.runParallel(b, BLACK, 50, 1);
+  EXPECT_EQ(withNet.lastSearchStats().playouts, 0);
+}
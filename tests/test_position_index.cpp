@@ -0,0 +1,106 @@
+#include "gtest/gtest.h"
+#include <fstream>
+#include "board.h"
+#include "sgf.h"
+#include "corpus_replay.h"
+#include "position_index.h"
+
+TEST(PositionIndexTest, FindsGamesReachingPosition){
+  std::vector<std::string> sgfs = {
+    "(;GM[1]FF[4]SZ[9]KM[7];B[ee];W[cc];B[gg])",
+    "(;GM[1]FF[4]SZ[9]KM[7];B[ee];W[gc];B[cg])",
+    "(;GM[1]FF[4]SZ[9]KM[7];B[ee];W[cc];B[gg])", // duplicate of game 0
+    "(;GM[1]FF[4]SZ[9]KM[7];B[gg];W[cc];B[ee])", // transposes into game 0 at move 3
+    "not an sgf SZ[x]",
+  };
+  std::vector<std::string> names = {"g0", "g1", "g2", "g3", "bad"};
+  Corpus::PositionIndexWriter w(names);
+  auto st = Corpus::replayCorpus(static_cast<uint32_t>(sgfs.size()), Corpus::stringSource(sgfs), {&w}, 3);
+  EXPECT_EQ(st.games, 4u);
+  EXPECT_EQ(st.failed, 1u);
+  std::string path = ::testing::TempDir() + "test_position_index.pos";
+  ASSERT_TRUE(w.write(path));
+
+  Corpus::PositionIndex idx;
+  ASSERT_TRUE(idx.open(path));
+  EXPECT_EQ(idx.gameCount(), 5u);
+  EXPECT_EQ(idx.gameName(3), "g3");
+
+  Board b(9);
+  b.place(4,4,BLACK); b.place(2,2,WHITE); b.place(6,6,BLACK);
+  auto hits = idx.lookup(b);
+  ASSERT_EQ(hits.size(), 3u);
+  EXPECT_EQ(hits[0].game, 0u); EXPECT_EQ(hits[0].move, 3u);
+  EXPECT_EQ(hits[1].game, 2u);
+  EXPECT_EQ(hits[2].game, 3u); EXPECT_EQ(hits[2].move, 3u);
+
+  // after the first move games 0-2 share a position
+  Board one(9);
+  one.place(4,4,BLACK);
+  auto r = idx.lookup(one.zobrist());
+  EXPECT_EQ(r.second - r.first, 3);
+
+  // a position nobody reached
+  Board none(9);
+  none.place(0,0,BLACK);
+  EXPECT_TRUE(idx.lookup(none).empty());
+}
+
+TEST(PositionIndexTest, DedupesIdenticalRecords){
+  std::vector<std::string> sgfs = {
+    "(;SZ[9]PB[a];B[ee];W[cc])",
+    "(;SZ[9]PB[b];B[ee];W[cc]C[same moves, different metadata])",
+    "(;SZ[13];B[ee];W[cc])", // same moves on another board size
+    "(;SZ[9];B[ee])",
+  };
+  Corpus::PositionIndexWriter w({});
+  Corpus::replayCorpus(static_cast<uint32_t>(sgfs.size()), Corpus::stringSource(sgfs), {&w}, 2);
+  std::string path = ::testing::TempDir() + "test_position_dedupe.pos";
+  ASSERT_TRUE(w.write(path));
+  Corpus::PositionIndex idx;
+  ASSERT_TRUE(idx.open(path));
+  EXPECT_FALSE(idx.isDuplicate(0));
+  EXPECT_TRUE(idx.isDuplicate(1));
+  EXPECT_EQ(idx.canonicalGame(1), 0u);
+  EXPECT_FALSE(idx.isDuplicate(2));
+  EXPECT_EQ(idx.uniqueGames(), (std::vector<uint32_t>{0, 2, 3}));
+}
+
+TEST(PositionIndexTest, RejectsEntryCountThatOverflows){
+  std::vector<std::string> sgfs = {"(;SZ[9];B[ee];W[cc])"};
+  Corpus::PositionIndexWriter w({"g0"});
+  Corpus::replayCorpus(1, Corpus::stringSource(sgfs), {&w}, 1);
+  std::string path = ::testing::TempDir() + "test_position_overflow.pos";
+  ASSERT_TRUE(w.write(path));
+  {
+    Corpus::PositionIndex idx;
+    ASSERT_TRUE(idx.open(path));
+  }
+  // entryCount sits after magic, version and gameCount; adding 2^64 / sizeof(PositionHit)
+  // leaves entryCount * sizeof(PositionHit) unchanged modulo 2^64
+  std::fstream f(path, std::ios::binary | std::ios::in | std::ios::out);
+  uint64_t count = 0;
+  f.seekg(16);
+  f.read(reinterpret_cast<char*>(&count), sizeof(count));
+  count += (uint64_t(1) << 63) / (sizeof(Corpus::PositionHit) / 2);
+  f.seekp(16);
+  f.write(reinterpret_cast<const char*>(&count), sizeof(count));
+  f.close();
+  Corpus::PositionIndex idx;
+  EXPECT_FALSE(idx.open(path));
+}
+
+TEST(PositionIndexTest, ReplayMatchesSgfParse){
+  std::string s = "(;GM[1]FF[4]SZ[5]KM[6.5];B[aa];W[bb];B[];W[cc])";
+  Board viaParse(5);
+  double komi = 0;
+  ASSERT_TRUE(SGF::parse(s, viaParse, komi));
+  SGF::Game g;
+  ASSERT_TRUE(SGF::parseGame(s, g));
+  EXPECT_EQ(g.SZ, 5);
+  Board viaReplay(g.SZ);
+  size_t calls = 0;
+  SGF::replay(g.moves, viaReplay, [&](const Board&, size_t n){ EXPECT_EQ(n, ++calls); });
+  EXPECT_EQ(calls, 4u);
+  EXPECT_EQ(viaReplay.zobrist(), viaParse.zobrist());
+}
@@ -0,0 +1,156 @@
+#include "gtest/gtest.h"
+#include "ai/pvn_cache.h"
+#include "ai/mcts.h"
+#include <atomic>
+#include <thread>
+
+namespace {
+// Policy tags every point with its own index; value counts black stones. Counts calls
+// so tests can tell hits from misses.
+struct PointPV : PolicyValueNet {
+  std::atomic<int> policyCalls{0}, valueCalls{0}, batched{0};
+  std::vector<double> policy(const Board& b, const std::vector<Board::Move>& legal) override {
+    ++policyCalls;
+    std::vector<double> p;
+    for(auto& m : legal) p.push_back(m.pass ? 0.5 : 1.0 + m.y * b.size() + m.x);
+    return p;
+  }
+  double value(const Board& b) override {
+    ++valueCalls;
+    int n = 0;
+    for(Stone s : b.cells()) n += s == BLACK;
+    return n / 100.0;
+  }
+  void evaluateBatch(const std::vector<const Board*>& positions,
+                     const std::vector<const std::vector<Board::Move>*>& legal,
+                     std::vector<Evaluation>& out) override {
+    batched += static_cast<int>(positions.size());
+    PolicyValueNet::evaluateBatch(positions, legal, out);
+  }
+};
+}
+
+TEST(CachedPVN, RepeatedPositionsHitTheCache) {
+  auto net = std::make_shared<PointPV>();
+  CachedPolicyValueNet cache(net, 1);
+  Board b(9);
+  b.place(2,3,BLACK);
+  auto legal = MCTS::legalMoves(b, WHITE);
+  auto p1 = cache.policy(b, legal);
+  auto p2 = cache.policy(b, legal);
+  EXPECT_EQ(p1, p2);
+  EXPECT_DOUBLE_EQ(cache.value(b), 0.01);
+  EXPECT_DOUBLE_EQ(cache.value(b), 0.01);
+  EXPECT_EQ(net->policyCalls.load(), 1);
+  EXPECT_EQ(net->valueCalls.load(), 1);
+  EXPECT_EQ(cache.hits(), 2u);
+  EXPECT_EQ(cache.misses(), 2u);
+  // the same stones with the other side to move are a different situation
+  cache.policy(b, MCTS::legalMoves(b, BLACK));
+  EXPECT_EQ(net->policyCalls.load(), 2);
+  cache.clear();
+  cache.value(b);
+  EXPECT_EQ(net->valueCalls.load(), 2);
+}
+
+TEST(CachedPVN, SymmetricPositionsShareAnEntry) {
+  auto net = std::make_shared<PointPV>();
+  CachedPolicyValueNet cache(net, 1, true);
+  const int N = 9;
+  Board a(N), m(N);
+  a.place(1,2,BLACK); a.place(3,0,WHITE);
+  // `a` transposed
+  m.place(2,1,BLACK); m.place(0,3,WHITE);
+  auto la = MCTS::legalMoves(a, BLACK);
+  auto pa = cache.policy(a, la);
+  auto lm = MCTS::legalMoves(m, BLACK);
+  auto pm = cache.policy(m, lm);
+  EXPECT_EQ(net->policyCalls.load(), 1);
+  ASSERT_EQ(pm.size(), lm.size());
+  // each move gets the prior of its mirror image in `a`
+  for(size_t i=0;i<lm.size();++i){
+    double want = lm[i].pass ? 0.5 : 1.0 + lm[i].x * N + lm[i].y;
+    EXPECT_DOUBLE_EQ(pm[i], want);
+  }
+  EXPECT_DOUBLE_EQ(cache.value(m), cache.value(a));
+  EXPECT_EQ(net->valueCalls.load(), 1);
+}
+
+TEST(CachedPVN, BatchesForwardOnlyMisses) {
+  auto net = std::make_shared<PointPV>();
+  CachedPolicyValueNet cache(net, 1);
+  Board b1(9), b2(9);
+  b2.place(4,4,BLACK);
+  auto l1 = MCTS::legalMoves(b1, BLACK), l2 = MCTS::legalMoves(b2, WHITE);
+  cache.value(b1); cache.policy(b1, l1);
+  std::vector<PolicyValueNet::Evaluation> out;
+  cache.evaluateBatch({&b1, &b2}, {&l1, &l2}, out);
+  EXPECT_EQ(net->batched.load(), 1);
+  ASSERT_EQ(out.size(), 2u);
+  EXPECT_DOUBLE_EQ(out[1].value, 0.01);
+  EXPECT_EQ(out[0].policy.size(), l1.size());
+}
+
+TEST(CachedPVN, ConcurrentCallersSeeConsistentResults) {
+  auto net = std::make_shared<PointPV>();
+  // a tiny table, so threads keep replacing each other's entries
+  CachedPolicyValueNet cache(net, 0, true);
+  std::atomic<int> wrong{0};
+  std::vector<std::thread> threads;
+  for(int t=0;t<4;++t){
+    threads.emplace_back([&, t]{
+      for(int i=0;i<200;++i){
+        Board b(5);
+        int stones = (t + i) % 6;
+        for(int k=0;k<stones;++k) b.place(k % 5, k / 5, BLACK);
+        if(cache.value(b) != stones / 100.0) ++wrong;
+        auto legal = MCTS::legalMoves(b, WHITE);
+        if(cache.policy(b, legal).size() != legal.size()) ++wrong;
+      }
+    });
+  }
+  for(auto& th : threads) th.join();
+  EXPECT_EQ(wrong.load(), 0);
+  EXPECT_EQ(cache.hits() + cache.misses(), 1600u);
+}
+
+TEST(CachedPVN, SharedAcrossSearches) {
+  auto net = std::make_shared<PointPV>();
+  auto cache = std::make_shared<CachedPolicyValueNet>(net, 8);
+  Board b(7);
+  MCTSConfig cfg;
+  MCTS first(cfg);
+  first.setPV(cache);
+  first.runParallel(b, BLACK, 300, 1);
+  int called = net->valueCalls.load();
+  uint64_t hits = cache->hits(), lookups = cache->hits() + cache->misses();
+  // a second search of the same position finds most of its leaves already evaluated
+  MCTS second(cfg);
+  second.setPV(cache);
+  second.runParallel(b, BLACK, 300, 1);
+  double rate = double(cache->hits() - hits) / double(cache->hits() + cache->misses() - lookups);
+  EXPECT_LT(net->valueCalls.load() - called, called / 2);
+  EXPECT_GT(rate, 0.5);
+}
+
+TEST(CachedPVN, PoliciesLiveInFixedSlots) {
+  auto net = std::make_shared<PointPV>();
+  CachedPolicyValueNet cache(net, 1, false, 9);
+  // the whole table, policies included, is allocated up front within the budget
+  EXPECT_LE(cache.bytes(), size_t(1) << 20);
+  EXPECT_GT(cache.bytes(), size_t(1) << 19);
+  EXPECT_GT(cache.capacity(), CachedPolicyValueNet(net, 1).capacity());
+  Board small(9), large(13);
+  small.place(4,4,BLACK); large.place(4,4,BLACK);
+  auto ls = MCTS::legalMoves(small, WHITE), ll = MCTS::legalMoves(large, WHITE);
+  cache.policy(small, ls);
+  EXPECT_EQ(cache.policy(small, ls), net->policy(small, ls));
+  EXPECT_EQ(net->policyCalls.load(), 2);
+  // a 13x13 policy does not fit a 9x9 slot: evaluated every time, values still cached
+  EXPECT_EQ(cache.policy(large, ll).size(), ll.size());
+  cache.policy(large, ll);
+  EXPECT_EQ(net->policyCalls.load(), 4);
+  cache.value(large);
+  cache.value(large);
+  EXPECT_EQ(net->valueCalls.load(), 1);
+}
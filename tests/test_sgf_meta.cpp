@@ -25,3 +25,19 @@ TEST(SGFMetaTest, MetadataAndComments){
   EXPECT_EQ(g2.PB, g.PB);
   EXPECT_EQ(g2.moves[0].comment, g.moves[0].comment);
 }
+
+TEST(SGFMetaTest, DateAndRanksRoundtrip){
+  std::string s = "(;GM[1]FF[4]SZ[19]KM[6.5]PB[A]BR[3d]PW[B]WR[1k]DT[2024-05-01];B[pd])";
+  SGF::Game g;
+  ASSERT_TRUE(SGF::parseGame(s, g));
+  EXPECT_EQ(g.SZ, 19);
+  EXPECT_EQ(g.DT, "2024-05-01");
+  EXPECT_EQ(g.BR, "3d");
+  EXPECT_EQ(g.WR, "1k");
+  SGF::Game g2;
+  ASSERT_TRUE(SGF::parseGame(SGF::write(g), g2));
+  EXPECT_EQ(g2.DT, g.DT);
+  EXPECT_EQ(g2.BR, g.BR);
+  EXPECT_EQ(g2.WR, g.WR);
+  EXPECT_EQ(g2.SZ, 19);
+}
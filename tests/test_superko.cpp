@@ -1,5 +1,6 @@
 #include "gtest/gtest.h"
 #include "board.h"
+#include <algorithm>
 
 TEST(SuperkoTest, PreventRepeatState) {
   Board b(5);
@@ -44,3 +45,33 @@ TEST(SuperkoTest, PreventRepeatState) {
   // Now current state is B (empty at 0,0). Attempting to place BLACK at (0,0) would recreate previous A (which is in history), so should be rejected by superko
   EXPECT_FALSE(b3.place(0,0,BLACK));
 }
+
+TEST(SuperkoTest, RestoredBoardChecksSharedHistory) {
+  Board played(5);
+  ASSERT_TRUE(played.place(2,2,BLACK));
+  ASSERT_TRUE(played.place(1,1,WHITE));
+  std::vector<uint64_t> seen = played.history();
+  std::sort(seen.begin(), seen.end());
+
+  // back to the empty board, with the game's positions shared rather than copied
+  Board root(5), scratch(9);
+  scratch.restore(root, &seen);
+  EXPECT_EQ(scratch.size(), 5);
+  EXPECT_EQ(scratch.zobrist(), root.zobrist());
+  EXPECT_TRUE(scratch.moves().empty());
+  EXPECT_FALSE(scratch.isLegal(2,2,BLACK));
+  EXPECT_FALSE(scratch.place(2,2,BLACK));
+  EXPECT_TRUE(scratch.place(3,3,BLACK));
+
+  // positions played after the restore count too
+  scratch.restore(played, &seen);
+  EXPECT_EQ(scratch.get(2,2), BLACK);
+  EXPECT_EQ(scratch.toMove(), BLACK);
+  EXPECT_TRUE(scratch.place(0,0,BLACK));
+  EXPECT_TRUE(scratch.place(4,4,WHITE));
+  EXPECT_EQ(scratch.moves().size(), 2u);
+  EXPECT_EQ(scratch.history().size(), 3u);
+
+  scratch.restore(root, nullptr);
+  EXPECT_TRUE(scratch.place(2,2,BLACK));
+}
@@ -0,0 +1,106 @@
+#include "gtest/gtest.h"
+#include "board.h"
+#include "ai/mcts.h"
+#include "ai/time_manager.h"
+#include <chrono>
+
+TEST(TimeManagerTest, SuddenDeathSpreadsMainTime){
+  TimeManager tm(TimeControl::suddenDeath(600.0));
+  auto early = tm.budget(0, 19);
+  EXPECT_GT(early.target, 1.0);
+  EXPECT_LT(early.target, 600.0 / 50);
+  EXPECT_GE(early.maximum, early.target);
+  EXPECT_LE(early.maximum, 0.25 * 600.0);
+  // fewer moves left later in the game: more time per move
+  EXPECT_GT(tm.budget(200, 19).target, early.target);
+  tm.moveDone(10.0);
+  EXPECT_DOUBLE_EQ(tm.timeLeft(), 590.0);
+  EXPECT_FALSE(tm.inOvertime());
+}
+
+TEST(TimeManagerTest, ByoYomiNeverRisksAPeriod){
+  TimeManager tm(TimeControl::byoYomi(1.0, 30.0, 3));
+  EXPECT_GT(tm.budget(10, 19).target, 10.0); // the period is available on every move
+  tm.moveDone(2.0); // main time runs out mid-move
+  EXPECT_TRUE(tm.inOvertime());
+  EXPECT_EQ(tm.countLeft(), 3);
+  auto b = tm.budget(10, 19);
+  EXPECT_LT(b.maximum, 30.0);
+  EXPECT_GT(b.target, 10.0);
+  tm.moveDone(45.0); // overran one period
+  EXPECT_EQ(tm.countLeft(), 2);
+  EXPECT_DOUBLE_EQ(tm.timeLeft(), 30.0);
+}
+
+TEST(TimeManagerTest, CanadianSharesTheBlockBetweenStones){
+  TimeManager tm(TimeControl::canadian(0.0, 100.0, 10));
+  ASSERT_TRUE(tm.inOvertime());
+  auto b = tm.budget(50, 19);
+  EXPECT_NEAR(b.target, 10.0, 0.5);
+  EXPECT_LE(b.maximum, 100.0);
+  for(int i=0;i<9;++i) tm.moveDone(5.0);
+  EXPECT_EQ(tm.countLeft(), 1);
+  EXPECT_DOUBLE_EQ(tm.timeLeft(), 55.0);
+  // the last stone may use what is left, minus the lag
+  EXPECT_NEAR(tm.budget(60, 19).maximum, 55.0 - tm.lag, 1e-9);
+  tm.moveDone(50.0);
+  EXPECT_EQ(tm.countLeft(), 10);
+  EXPECT_DOUBLE_EQ(tm.timeLeft(), 100.0);
+}
+
+TEST(TimeManagerTest, RunForStopsAtTheDeadline){
+  using Clock = std::chrono::steady_clock;
+  Board b(9);
+  MCTS m;
+  auto start = Clock::now();
+  auto mv = m.runFor(b, BLACK, start + std::chrono::milliseconds(100), 2);
+  double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+  EXPECT_GE(elapsed, 0.1);
+  EXPECT_LT(elapsed, 0.5);
+  EXPECT_GT(m.rootChildrenCount(), 0);
+  if(!mv.pass){ EXPECT_EQ(b.get(mv.x, mv.y), EMPTY); }
+}
+
+TEST(TimeManagerTest, RunTimedStaysWithinTheBudget){
+  using Clock = std::chrono::steady_clock;
+  Board b(9);
+  TimeManager tm(TimeControl::suddenDeath(5.0));
+  auto budget = tm.budget(0, 9);
+  MCTS m;
+  auto start = Clock::now();
+  m.runTimed(b, BLACK, tm, 0, 1);
+  double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+  EXPECT_GE(elapsed, budget.target);
+  EXPECT_LT(elapsed, budget.maximum + 0.2);
+  tm.moveDone(elapsed);
+  EXPECT_LT(tm.timeLeft(), 5.0);
+}
+
+namespace {
+// All policy mass on the first legal move, constant value: the search never doubts it.
+struct FirstMovePV : PolicyValueNet {
+  std::vector<double> policy(const Board&, const std::vector<Board::Move>& legal) override {
+    std::vector<double> p(legal.size(), 0.0);
+    p[0] = 1.0;
+    return p;
+  }
+  double value(const Board&) override { return 0.5; }
+};
+}
+
+TEST(TimeManagerTest, EarlyStopLeavesTimeOnTheClock){
+  Board b(9);
+  // a target of about 0.6 s: enough scheduler slices to reach the decision on a loaded machine
+  TimeManager tm(TimeControl::suddenDeath(20.0));
+  auto budget = tm.budget(0, 9);
+  MCTSConfig cfg; cfg.puct = true; cfg.early_stop = true; cfg.early_stop_interval = 8;
+  MCTS m(cfg);
+  m.setPV(std::make_shared<FirstMovePV>());
+  m.runTimed(b, BLACK, tm, 0, 1);
+  const SearchStats& st = m.lastSearchStats();
+  EXPECT_GT(st.iterations, 0);
+  EXPECT_TRUE(st.stoppedEarly);
+  EXPECT_GT(st.iterationsSaved, 0);
+  EXPECT_GT(st.secondsSaved, 0.0);
+  EXPECT_LT(st.secondsSaved, budget.target);
+}
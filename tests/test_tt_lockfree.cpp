@@ -0,0 +1,68 @@
+#include "gtest/gtest.h"
+#include "ai/tt_lockfree.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+void* fakePtr(uint64_t i){ return reinterpret_cast<void*>(uintptr_t(0x10000 + i * 16)); }
+}
+
+TEST(LockFreeTTTest, InsertGetErase){
+  LockFreeTT tt(1);
+  EXPECT_EQ(tt.bytes(), size_t(1) << 20);
+  EXPECT_EQ(tt.get(42), nullptr);
+  tt.insert(42, fakePtr(1));
+  EXPECT_EQ(tt.get(42), fakePtr(1));
+  tt.insert(42, fakePtr(2)); // same key overwrites in place
+  EXPECT_EQ(tt.get(42), fakePtr(2));
+  tt.erase(42);
+  EXPECT_EQ(tt.get(42), nullptr);
+}
+
+TEST(LockFreeTTTest, ClearAgesEveryEntry){
+  LockFreeTT tt(1);
+  for(uint64_t k=1;k<=1000;++k) tt.insert(k * 0x9E3779B97F4A7C15ULL, fakePtr(k));
+  // more clears than the age field can count
+  for(int round=0; round<300; ++round){
+    tt.clear();
+    for(uint64_t k=1;k<=1000;++k) ASSERT_EQ(tt.get(k * 0x9E3779B97F4A7C15ULL), nullptr);
+    tt.insert(7, fakePtr(round));
+    ASSERT_EQ(tt.get(7), fakePtr(round));
+  }
+}
+
+TEST(LockFreeTTTest, FullBucketKeepsHighPriorityEntries){
+  LockFreeTT tt(0); // a single bucket of four slots
+  ASSERT_EQ(tt.capacity(), 4u);
+  for(uint64_t k=1;k<=4;++k) tt.insert(k, fakePtr(k), 100 + k);
+  // a deeper (lower priority) node does not displace them
+  tt.insert(99, fakePtr(99), 10);
+  EXPECT_EQ(tt.get(99), nullptr);
+  for(uint64_t k=1;k<=4;++k) EXPECT_EQ(tt.get(k), fakePtr(k));
+  // a shallower one replaces the least important entry
+  tt.insert(100, fakePtr(100), 200);
+  EXPECT_EQ(tt.get(100), fakePtr(100));
+  EXPECT_EQ(tt.get(1), nullptr);
+  EXPECT_EQ(tt.get(4), fakePtr(4));
+}
+
+TEST(LockFreeTTTest, ConcurrentReadersNeverSeeMixedEntries){
+  LockFreeTT tt(1);
+  std::atomic<bool> bad{false};
+  std::vector<std::thread> threads;
+  for(int t=0;t<4;++t){
+    threads.emplace_back([&, t]{
+      uint64_t x = 0x12345 + t;
+      for(int i=0;i<200000;++i){
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        uint64_t k = (x >> 20) % 50000 + 1;
+        // the value a key maps to is a function of the key, so any hit can be checked
+        if(i & 1) tt.insert(k, fakePtr(k), unsigned(k & 255));
+        else { void* p = tt.get(k); if(p && p != fakePtr(k)) bad = true; }
+      }
+    });
+  }
+  for(auto& th : threads) th.join();
+  EXPECT_FALSE(bad.load());
+}